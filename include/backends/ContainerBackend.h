@@ -1,44 +1,182 @@
 #pragma once
 
 #include "ExecutionBackend.h"
+#include "core/LayerCache.h"
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QProcess>
+#include <functional>
+
+class QTimer;
 
 namespace gwt {
 namespace backends {
 
+class ContainerPool;
+class EngineClient;
+class OverlayWorkspace;
+class ShellSession;
+
 /**
  * @brief Container-based execution backend (using Docker or Podman)
+ *
+ * The run steps of a job share one shell session started with
+ * `exec -i <container> sh`, so a step costs a write to its input rather
+ * than a new runtime client process. When the engine's API socket is
+ * reachable, containers and the session are handled through EngineClient
+ * and no runtime CLI process is started at all. The repository is mounted as a
+ * copy-on-write OverlayWorkspace at /github/workspace.
  */
 class ContainerBackend : public ExecutionBackend {
     Q_OBJECT
 
 public:
     explicit ContainerBackend(QObject* parent = nullptr);
+
+    /**
+     * @param pool Pool to take a started container from, or nullptr to always start one
+     */
+    explicit ContainerBackend(ContainerPool* pool, QObject* parent = nullptr);
     ~ContainerBackend() override;
 
-    bool executeStep(const core::WorkflowStep& step,
-                    const QVariantMap& context) override;
+    void executeStep(const core::WorkflowStep& step,
+                     const QVariantMap& context) override;
 
-    bool prepareEnvironment(const QString& runsOn) override;
+    void prepareEnvironment(const QString& runsOn) override;
 
     void cleanup() override;
 
+    void cancel() override;
+
+    /**
+     * @brief Map GitHub runner spec to container image
+     */
+    static QString mapRunsOnToImage(const QString& runsOn);
+
+    /**
+     * @brief Commit the container after slow leading steps and restore them in later runs
+     * @param budgetBytes Disk budget of all cached layers, 0 to disable the cache
+     *
+     * Only steps that leave the workspace and the session environment
+     * untouched are cached, as neither is part of a committed image.
+     */
+    void setLayerCacheBudget(qint64 budgetBytes);
+
 private:
     static constexpr int STEP_TIMEOUT_MS = 300000;  // 5 minutes
     static constexpr int PREPARE_TIMEOUT_MS = 60000; // 1 minute
     static constexpr int CLEANUP_TIMEOUT_MS = 30000; // 30 seconds
+    static constexpr int COMMIT_TIMEOUT_MS = 300000; // 5 minutes
+    static constexpr qint64 MIN_COMMIT_STEP_MS = 10000; // Quicker steps are cheaper to rerun
     
     QString m_containerId;
+    QString m_containerName;
     QString m_containerRuntime;  // "docker" or "podman"
+    QPointer<QProcess> m_activeProcess;
+    QPointer<ContainerPool> m_pool;
+    QPointer<EngineClient> m_engine;       // nullptr to use the runtime's CLI
+    QPointer<QIODevice> m_shellDevice;
+    QPointer<ShellSession> m_shell;
+    QPointer<OverlayWorkspace> m_workspace;
+    QTimer* m_stepTimer;
+    bool m_pooled;                // The container came from m_pool
+    bool m_cancelled;
+    bool m_creating;              // The engine is creating the container, or it is being inspected
+    bool m_shellStarting;         // The engine is attaching the shell session
     
+    qint64 m_layerCacheBudget;
+    core::LayerCache m_layerCache;
+    QStringList m_layerKeys;      // Prefix keys of the job's steps
+    QString m_baseImage;
+    int m_restoredSteps;          // Steps covered by the image the container started from
+    int m_stepIndex;
+    bool m_layerCaching;          // The steps so far can still be committed
+    bool m_committing;            // A commit is running and its result is wanted
+    QString m_commitTag;          // Image the runtime's `commit` is creating
+    qint64 m_uncommittedMs;       // Step time since the last commit or restore
+    QElapsedTimer m_stepClock;
+
     /**
-     * @brief Detect available container runtime
+     * @brief Start a container of an image, with the workspace if one is mounted
      */
-    bool detectRuntime();
-    
+    void startContainer(const QString& image);
+
     /**
-     * @brief Map GitHub runner spec to container image
+     * @brief Account the running container's cgroup, then report the environment as prepared
+     */
+    void finishPreparation();
+
+    /**
+     * @brief Give up on the cached image the container failed to start from
+     * @return true if the container is being started from the base image instead
+     */
+    bool dropRestoredLayer();
+
+    /**
+     * @brief Check if the steps so far should be committed before the next one
+     */
+    bool shouldCommitLayer();
+
+    /**
+     * @brief Commit the container as the layer of a prefix, then complete the step
+     */
+    void commitLayer(const QString& key);
+
+    /**
+     * @brief Record a committed layer, evict old ones and complete the step
+     */
+    void finishCommit(const QString& key, qint64 sizeBytes, const QString& errorMessage);
+
+    /**
+     * @brief Remove the image of an evicted layer, then forget the layer
+     */
+    void removeLayer(const QString& key);
+
+    /**
+     * @brief Remove a container without waiting for it
+     */
+    void removeContainerLater(const QString& containerName);
+
+    /**
+     * @brief Unmount the workspace in the background once no container uses it
+     */
+    void discardWorkspace();
+
+    /**
+     * @brief Start the shell session of the container unless it is running
+     * @param onReady Called once with an empty string when the session can take a step, or the error
+     */
+    void openShellSession(std::function<void(const QString& errorMessage)> onReady);
+
+    /**
+     * @brief Run the shell session on the input and merged output of a `sh` in the container
+     */
+    void attachShellSession(QIODevice* device);
+
+    /**
+     * @brief Fail the running step of a session whose shell went away
+     */
+    void endShellSession();
+
+    /**
+     * @brief Stop the shell session; a step in flight reports nothing
+     */
+    void discardShellSession();
+
+    /**
+     * @brief Report the outcome of the step that ran in the shell session
+     */
+    void finishShellStep(int exitCode);
+
+    /**
+     * @brief Run the container runtime without blocking the event loop
+     * @param args Runtime arguments
+     * @param timeoutMs Kill the process after this many milliseconds
+     * @param onFinished Called once with the process and whether it exited in time;
+     *                   a runtime that failed to start has not finished either
      */
-    QString mapRunsOnToImage(const QString& runsOn) const;
+    void runRuntime(const QStringList& args, int timeoutMs,
+                    std::function<void(QProcess& process, bool finished)> onFinished);
 };
 
 } // namespace backends
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "core/ResourceBudget.h"
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+
+namespace gwt {
+namespace backends {
+
+class EngineClient;
+class OverlayWorkspace;
+
+/**
+ * @brief Keeps started containers ready so that jobs skip the cold start
+ *
+ * Containers are grouped by image, resource limits and workspace. Each
+ * group is kept at the pool size: handing a container out starts a
+ * replacement in the background, and returned containers are removed with
+ * their workspace, never reused, so every job gets a clean filesystem.
+ */
+class ContainerPool : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @param size Number of idle containers to keep per image and limits
+     */
+    explicit ContainerPool(int size, QObject* parent = nullptr);
+
+    /**
+     * @brief Remove the idle containers without waiting for the runtime
+     */
+    ~ContainerPool() override;
+
+    /**
+     * @brief Get the number of idle containers kept per image and limits
+     */
+    int size() const;
+
+    /**
+     * @brief Start containers in the background until the group is full
+     * @param image Container image
+     * @param limits CPU and memory limits the containers are started with
+     * @param workspace Directory each container gets a copy-on-write view of, or empty
+     */
+    void warm(const QString& image, const core::ResourceReservation& limits,
+              const QString& workspace = QString());
+
+    /**
+     * @brief Take an idle container and start its replacement
+     * @param image Container image
+     * @param limits CPU and memory limits the job needs
+     * @param workspace Directory the job works in, or empty
+     * @return Name of a running container, or an empty string if none is idle
+     */
+    QString acquire(const QString& image, const core::ResourceReservation& limits,
+                    const QString& workspace = QString());
+
+    /**
+     * @brief Hand back a container taken with acquire()
+     * @param containerName The container, which is removed in the background with its workspace
+     */
+    void release(const QString& containerName);
+
+    /**
+     * @brief Get the workspace mounted into a container of the pool
+     * @return The workspace, or nullptr if the container has none
+     */
+    OverlayWorkspace* workspace(const QString& containerName) const;
+
+    /**
+     * @brief Get the runtime arguments that start a container
+     * @param containerName Name given to the container
+     * @param image Container image
+     * @param limits CPU and memory limits; 0 fields are left unlimited
+     * @param workspaceDir Host directory mounted at WORKSPACE_PATH, or empty
+     */
+    static QStringList runArguments(const QString& containerName,
+                                    const QString& image,
+                                    const core::ResourceReservation& limits,
+                                    const QString& workspaceDir = QString());
+
+    static constexpr const char* WORKSPACE_PATH = "/github/workspace";
+
+signals:
+    void error(const QString& errorMessage);
+
+private:
+    static constexpr int START_TIMEOUT_MS = 60000; // 1 minute
+
+    /**
+     * @brief Containers of one image and limits
+     */
+    struct Group {
+        QString image;                      // What warm() was last asked for
+        core::ResourceReservation limits;
+        QString workspace;
+        QStringList idle;
+        int starting = 0;
+        int failures = 0;                   // Failed starts since the last started container
+        qint64 retryAtMs = 0;               // No refills before this time since the epoch
+    };
+
+    static constexpr int RETRY_MS = 5000;         // 5 seconds after the first failed start
+    static constexpr int MAX_RETRY_SHIFT = 6;     // Doubling up to 320 seconds
+
+    int m_size;
+    QString m_containerRuntime;
+    QPointer<EngineClient> m_engine;   // nullptr to use the runtime's CLI
+    QMap<QString, Group> m_groups;
+    QStringList m_starting;
+    QMap<QString, OverlayWorkspace*> m_workspaces;  // By container name
+
+    /**
+     * @brief Get the key of the group of an image, limits and workspace
+     */
+    static QString groupKey(const QString& image, const core::ResourceReservation& limits,
+                            const QString& workspace);
+
+    /**
+     * @brief Start one container for a group without blocking
+     */
+    void startContainer(const QString& key, const QString& image,
+                        const core::ResourceReservation& limits, const QString& workspace);
+
+    /**
+     * @brief Start the container once its workspace, if any, is mounted
+     */
+    void runContainer(const QString& key, const QString& image,
+                      const core::ResourceReservation& limits,
+                      const QString& containerName, const QString& workspaceDir);
+
+    /**
+     * @brief Make a started container idle, or back off refilling the group
+     */
+    void finishStart(const QString& key, const QString& containerName, bool started,
+                     const QString& errorMessage);
+
+    /**
+     * @brief Stop refilling a group for a while after a failed start
+     */
+    void retryLater(const QString& key, const QString& errorMessage);
+
+    /**
+     * @brief Remove a container and its workspace without waiting for the runtime
+     */
+    void removeContainer(const QString& containerName);
+};
+
+} // namespace backends
+} // namespace gwt
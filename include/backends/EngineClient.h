@@ -0,0 +1,195 @@
+#pragma once
+
+#include "core/ResourceBudget.h"
+#include <QByteArray>
+#include <QJsonDocument>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+class QJsonObject;
+class QLocalSocket;
+
+namespace gwt {
+namespace backends {
+
+class EngineStream;
+
+/**
+ * @brief Response of the container engine to one API request
+ */
+struct EngineReply {
+    int status = 0;                 // HTTP status, 0 if the engine was not reached
+    QByteArray body;
+    QString transportError;
+
+    bool isSuccess() const;
+    QJsonDocument json() const;
+
+    /**
+     * @brief Get the message of an error response, or the transport error
+     */
+    QString errorMessage() const;
+};
+
+/**
+ * @brief Client of the Docker-compatible engine API on a Unix socket
+ *
+ * Talks HTTP/1.1 to the Docker daemon or the Podman service directly,
+ * instead of starting a CLI process per operation. Connections are kept
+ * alive and reused; requests in flight at the same time each get their
+ * own. An exec attach takes over its connection as an EngineStream.
+ */
+class EngineClient : public QObject {
+    Q_OBJECT
+
+public:
+    using ReplyHandler = std::function<void(const EngineReply& reply)>;
+    using StartHandler = std::function<void(const QString& containerId, const QString& errorMessage)>;
+    using ErrorHandler = std::function<void(const QString& errorMessage)>;
+    using AttachHandler = std::function<void(EngineStream* stream, const QString& errorMessage)>;
+
+    /**
+     * @param socketPath Path of the engine's API socket
+     */
+    explicit EngineClient(const QString& socketPath, QObject* parent = nullptr);
+    ~EngineClient() override;
+
+    /**
+     * @brief Get the client shared by the backends of this process
+     * @return The client, or nullptr if the preferred runtime has no API socket we can use
+     *
+     * Must be called from the main thread.
+     */
+    static EngineClient* instance();
+
+    /**
+     * @brief Find the API socket of a container runtime
+     * @param containerRuntime "docker" or "podman"
+     * @return Socket path, or an empty string if there is none or the engine is remote
+     */
+    static QString findSocket(const QString& containerRuntime);
+
+    /**
+     * @brief Get the path of the engine's API socket
+     */
+    QString socketPath() const;
+
+    /**
+     * @brief Send a request
+     * @param method HTTP method
+     * @param path Path and query, with query values percent-encoded
+     * @param body JSON body, or a null document for none
+     * @param timeoutMs Fail the request after this many milliseconds
+     * @param onReply Called once, always from the event loop
+     */
+    void request(const QByteArray& method, const QString& path, const QJsonDocument& body,
+                 int timeoutMs, ReplyHandler onReply);
+
+    /**
+     * @brief Create and start a container, pulling its image if it is missing
+     * @param workspaceDir Host directory mounted at ContainerPool::WORKSPACE_PATH, or empty
+     * @param onStarted Called once with the container id, or an empty id and the error
+     *
+     * Starts the same container as the CLI with ContainerPool::runArguments().
+     */
+    void runContainer(const QString& containerName, const QString& image,
+                      const core::ResourceReservation& limits, const QString& workspaceDir,
+                      int timeoutMs, StartHandler onStarted);
+
+    /**
+     * @brief Remove a container and whatever runs in it
+     * @param containerId Id or name of the container
+     * @param onRemoved Called once with an empty string on success, or the error
+     */
+    void removeContainer(const QString& containerId, int timeoutMs, ErrorHandler onRemoved = nullptr);
+
+    /**
+     * @brief Get the host process id of a running container's init process
+     * @param onPid Called once with the pid, or 0 and the error
+     */
+    void containerPid(const QString& containerId, int timeoutMs,
+                      std::function<void(qint64 pid, const QString& errorMessage)> onPid);
+
+    /**
+     * @brief Commit the filesystem of a container into a tagged image
+     * @param tag Image reference, e.g. gwt-layer:abc
+     * @param onCommitted Called once with the size the container added to its image, or -1 and the error
+     */
+    void commitContainer(const QString& containerId, const QString& tag, int timeoutMs,
+                         std::function<void(qint64 sizeBytes, const QString& errorMessage)> onCommitted);
+
+    /**
+     * @brief Remove an image reference
+     * @param onRemoved Called once with an empty string on success, or the error
+     */
+    void removeImage(const QString& image, int timeoutMs, ErrorHandler onRemoved = nullptr);
+
+    /**
+     * @brief Run a command in a container with its stdin and output attached
+     * @param onAttached Called once with the stream, owned by the caller, or nullptr and the error
+     */
+    void execAttached(const QString& containerId, const QStringList& command,
+                      int timeoutMs, AttachHandler onAttached);
+
+private:
+    struct Connection;
+    using ResponseHandler = std::function<void(const EngineReply& reply, QLocalSocket* hijacked,
+                                               const QByteArray& pending)>;
+
+    static constexpr int MAX_IDLE_CONNECTIONS = 8;
+    static constexpr int PULL_TIMEOUT_MS = 1800000;     // 30 minutes
+
+    QString m_socketPath;
+    QList<Connection*> m_connections;
+    QList<Connection*> m_idle;
+
+    /**
+     * @brief Send a request on an idle connection, or on a new one
+     * @param upgrade Ask the engine to hijack the connection for a stream
+     */
+    void send(const QByteArray& request, bool upgrade, int timeoutMs, ResponseHandler onResponse);
+
+    /**
+     * @brief Write a request to a connection and wait for its response
+     */
+    void dispatch(Connection* connection, const QByteArray& request, bool upgrade,
+                  int timeoutMs, bool retry, ResponseHandler onResponse);
+
+    /**
+     * @brief Open a new connection to the engine
+     */
+    Connection* openConnection();
+
+    /**
+     * @brief Read what arrived on a connection and complete its response
+     */
+    void readResponse(Connection* connection);
+
+    /**
+     * @brief Fail the request of a connection that broke, or drop an idle one
+     */
+    void handleBrokenConnection(Connection* connection, const QString& message);
+
+    /**
+     * @brief Close a connection and forget it
+     */
+    void closeConnection(Connection* connection);
+
+    /**
+     * @brief Create a container, pulling its image once if the engine does not have it
+     */
+    void createContainer(const QString& containerName, const QString& image,
+                         const QJsonObject& config, int timeoutMs, bool pulled, StartHandler onStarted);
+
+    /**
+     * @brief Pull an image
+     * @param onPulled Called once with an empty string on success, or the error
+     */
+    void pullImage(const QString& image, ErrorHandler onPulled);
+};
+
+} // namespace backends
+} // namespace gwt
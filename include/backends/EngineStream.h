@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QPointer>
+
+class QLocalSocket;
+
+namespace gwt {
+namespace backends {
+
+/**
+ * @brief Input and output of an exec attached through the engine API
+ *
+ * Wraps the connection the engine hijacked for the attach. Writes go to
+ * the process's stdin unchanged; its stdout and stderr arrive multiplexed
+ * in frames, which are unpacked into one merged stream for reading.
+ * readChannelFinished() is emitted when the engine closes the connection,
+ * i.e. when the process has exited.
+ */
+class EngineStream : public QIODevice {
+    Q_OBJECT
+
+public:
+    /**
+     * @param socket Hijacked connection; ownership is taken
+     * @param pending Bytes already read past the response headers
+     */
+    EngineStream(QLocalSocket* socket, const QByteArray& pending, QObject* parent = nullptr);
+    ~EngineStream() override;
+
+    bool isSequential() const override;
+    qint64 bytesAvailable() const override;
+
+    /**
+     * @brief Drop the connection, which closes the stdin of the process
+     */
+    void close() override;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    static constexpr int FRAME_HEADER_SIZE = 8;
+
+    QPointer<QLocalSocket> m_socket;
+    QByteArray m_frames;            // Raw frames not complete yet
+    QByteArray m_output;            // Unpacked output not read yet
+
+    /**
+     * @brief Unpack the complete frames received so far
+     */
+    void unpackFrames(const QByteArray& data);
+};
+
+} // namespace backends
+} // namespace gwt
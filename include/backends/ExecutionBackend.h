@@ -1,5 +1,7 @@
 #pragma once
 
+#include "core/CgroupMonitor.h"
+#include "core/ResourceBudget.h"
 #include "core/WorkflowParser.h"
 #include <QObject>
 #include <QString>
@@ -7,8 +9,21 @@
 namespace gwt {
 namespace backends {
 
+/**
+ * @brief Kind of local environment the jobs of a run execute in
+ */
+enum class BackendType {
+    Container,      // Docker or Podman container per job
+    Qemu,           // Virtual machine per job
+    Namespace       // Host process in its own user, mount and PID namespaces
+};
+
 /**
  * @brief Base class for execution backends
+ *
+ * All operations are asynchronous: they start work and return immediately.
+ * Each call is answered by exactly one completion signal, which is always
+ * delivered from the event loop and never from inside the call itself.
  */
 class ExecutionBackend : public QObject {
     Q_OBJECT
@@ -18,29 +33,119 @@ public:
     ~ExecutionBackend() override;
 
     /**
-     * @brief Execute a job step
+     * @brief Start executing a job step
      * @param step The step to execute
      * @param context Execution context (env vars, working dir, etc.)
-     * @return true if successful
+     *
+     * Completion is reported through stepCompleted().
      */
-    virtual bool executeStep(const core::WorkflowStep& step,
-                            const QVariantMap& context) = 0;
+    virtual void executeStep(const core::WorkflowStep& step,
+                             const QVariantMap& context) = 0;
 
     /**
-     * @brief Prepare the execution environment
+     * @brief Start preparing the execution environment
      * @param runsOn The runner specification (ubuntu-latest, etc.)
-     * @return true if successful
+     *
+     * Completion is reported through environmentPrepared().
      */
-    virtual bool prepareEnvironment(const QString& runsOn) = 0;
+    virtual void prepareEnvironment(const QString& runsOn) = 0;
 
     /**
-     * @brief Cleanup the execution environment
+     * @brief Start tearing down the execution environment
+     *
+     * Completion is reported through cleanupFinished().
      */
     virtual void cleanup() = 0;
 
+    /**
+     * @brief Abort the operation in progress
+     *
+     * The pending completion signal is still delivered and reports failure.
+     * Call cleanup() afterwards to tear down the environment.
+     */
+    virtual void cancel();
+
+    /**
+     * @brief Set the CPU and memory limits of the next environment
+     * @param limits Limits to enforce; 0 fields are left unlimited
+     *
+     * Must be called before prepareEnvironment().
+     */
+    void setResourceLimits(const core::ResourceReservation& limits);
+
+    /**
+     * @brief Set the host directory the next environment works in
+     * @param hostPath Repository to expose to the job, or empty for none
+     *
+     * Must be called before prepareEnvironment(). Backends that cannot
+     * share host directories ignore it.
+     */
+    void setWorkspace(const QString& hostPath);
+
+    /**
+     * @brief Set the job the next environment runs
+     * @param job The (matrix-expanded) job whose steps follow in order
+     *
+     * Must be called before prepareEnvironment(). Backends may use it to
+     * restore state saved by earlier runs of the same steps.
+     */
+    void setJob(const core::WorkflowJob& job);
+
+    /**
+     * @brief Set the content hash of the workspace the next environment works in
+     * @param hash Hash of the repository paths the job uses, or empty if unknown
+     *
+     * Must be called before prepareEnvironment(). Backends that restore
+     * saved state mix it into their keys, so that state saved before a
+     * change to the repository is not restored after it.
+     */
+    void setWorkspaceHash(const QString& hash);
+
+    /**
+     * @brief Get the resources the environment used since the previous call
+     * @return Usage accounted by the environment's cgroup v2, invalid if it has none
+     *
+     * Call it after each completion signal to account the operation that
+     * just finished; the environment's cgroup is gone after cleanup.
+     */
+    virtual core::ResourceUsage takeResourceUsage();
+
 signals:
     void output(const QString& text);
     void error(const QString& errorMessage);
+    void environmentPrepared(bool success);
+    void stepCompleted(bool success);
+    void cleanupFinished();
+
+protected:
+    /**
+     * @brief Emit environmentPrepared() from the event loop
+     */
+    void completePreparationLater(bool success);
+
+    /**
+     * @brief Emit stepCompleted() from the event loop
+     */
+    void completeStepLater(bool success);
+
+    /**
+     * @brief Emit cleanupFinished() from the event loop
+     */
+    void completeCleanupLater();
+
+    /**
+     * @brief Account the environment's resource usage to a cgroup v2 from now on
+     * @param cgroupPath Directory of the cgroup all processes of the environment run in
+     */
+    void setCgroup(const QString& cgroupPath);
+
+    core::ResourceReservation m_resourceLimits;
+    QString m_workspacePath;
+    QString m_workspaceHash;
+    core::WorkflowJob m_job;
+
+private:
+    core::CgroupMonitor* m_cgroupMonitor;   // Created by setCgroup()
 };
 
 } // namespace backends
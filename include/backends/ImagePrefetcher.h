@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <functional>
+
+class QProcess;
+
+namespace gwt {
+namespace backends {
+
+/**
+ * @brief Pulls container images in the background, all at the same time
+ *
+ * Images already present are left alone. Jobs do not wait for the
+ * prefetcher: a job whose image is still being pulled starts its
+ * container anyway, and the runtime joins the download in progress.
+ */
+class ImagePrefetcher : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ImagePrefetcher(QObject* parent = nullptr);
+
+    /**
+     * @brief Kill the checks and pulls in flight without waiting for them
+     */
+    ~ImagePrefetcher() override;
+
+    /**
+     * @brief Pull the images that are missing locally
+     * @param images Images to make available; ones being pulled already are skipped
+     */
+    void prefetch(const QStringList& images);
+
+    /**
+     * @brief Check if any image is still being checked or pulled
+     */
+    bool isBusy() const;
+
+signals:
+    /**
+     * @brief A status line of the pull of an image
+     */
+    void progress(const QString& image, const QString& status);
+
+    /**
+     * @brief An image is available, or could not be pulled
+     */
+    void imageReady(const QString& image, bool success);
+
+private:
+    static constexpr int INSPECT_TIMEOUT_MS = 30000;    // 30 seconds
+    static constexpr int PULL_TIMEOUT_MS = 1800000;     // 30 minutes
+
+    QString m_containerRuntime;
+    QSet<QString> m_inFlight;
+    QMap<QString, QByteArray> m_partialLines;
+
+    /**
+     * @brief Check whether an image is present and pull it if not
+     */
+    void fetch(const QString& image);
+
+    /**
+     * @brief Pull an image, reporting its status lines
+     */
+    void pull(const QString& image);
+
+    /**
+     * @brief Start the container runtime with a timeout
+     * @param onFinished Called once with whether the process exited successfully in time
+     */
+    QProcess* runRuntime(const QStringList& args, int timeoutMs,
+                         std::function<void(bool success)> onFinished);
+};
+
+} // namespace backends
+} // namespace gwt
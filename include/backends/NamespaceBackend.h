@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ExecutionBackend.h"
+#include <QByteArray>
+#include <QPointer>
+#include <QProcess>
+#include <functional>
+
+class QTimer;
+
+namespace gwt {
+namespace backends {
+
+class ShellSession;
+
+/**
+ * @brief Runs steps on the host in Linux user, mount and PID namespaces
+ *
+ * The runner image is unpacked once into a root filesystem under the cache
+ * directory. Each job then only costs an `unshare`: inside its namespaces a
+ * kernel overlay over that root filesystem (and one over the repository at
+ * /github/workspace) is mounted, and the steps run in a ShellSession
+ * chrooted into it. The mounts live and die with the namespace.
+ *
+ * Where the user's systemd can start transient scopes, each job gets one,
+ * so its CPU and memory limits are enforced and its usage is accounted.
+ * The network is shared with the host and the job's root is the calling
+ * user, so this backend is meant for trusted workflows.
+ */
+class NamespaceBackend : public ExecutionBackend {
+    Q_OBJECT
+
+public:
+    explicit NamespaceBackend(QObject* parent = nullptr);
+    ~NamespaceBackend() override;
+
+    void executeStep(const core::WorkflowStep& step,
+                     const QVariantMap& context) override;
+
+    void prepareEnvironment(const QString& runsOn) override;
+
+    void cleanup() override;
+
+    void cancel() override;
+
+    /**
+     * @brief Get the directory an image's root filesystem is unpacked to
+     */
+    static QString rootfsDir(const QString& image);
+
+private:
+    static constexpr int STEP_TIMEOUT_MS = 300000;   // 5 minutes
+    static constexpr int UNPACK_TIMEOUT_MS = 600000; // 10 minutes, including the pull
+    static constexpr int START_TIMEOUT_MS = 10000;   // 10 seconds
+
+    QString m_jobDir;             // Holds the overlay layers of the job
+    QString m_readyToken;         // Printed once the mounts are in place
+    QByteArray m_startOutput;
+    QPointer<QProcess> m_unpackProcess;
+    QPointer<QProcess> m_shellProcess;
+    QPointer<ShellSession> m_shell;
+    QTimer* m_stepTimer;
+    QTimer* m_startTimer;
+    bool m_scoped;                // Runs in its own systemd scope and cgroup
+    bool m_cancelled;
+
+    /**
+     * @brief Unpack the root filesystem of an image unless it already is
+     * @param onUnpacked Called once with an empty string on success, or the error
+     */
+    void unpackRootfs(const QString& image, std::function<void(const QString& errorMessage)> onUnpacked);
+
+    /**
+     * @brief Enter the namespaces and start the shell of the job
+     *
+     * Completion is reported through environmentPrepared().
+     */
+    void startShell(const QString& rootfs);
+
+    /**
+     * @brief Collect the output of the namespace setup until the ready token
+     */
+    void readStartOutput();
+
+    /**
+     * @brief Report a shell that exited before or while running a step
+     */
+    void endShellSession();
+
+    /**
+     * @brief Kill the namespace; a step in flight reports nothing
+     */
+    void discardShellSession();
+
+    /**
+     * @brief Report the outcome of the step that ran in the shell session
+     */
+    void finishShellStep(int exitCode);
+
+    /**
+     * @brief Delete the overlay layers of the job in the background
+     */
+    void removeJobDir();
+};
+
+} // namespace backends
+} // namespace gwt
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+
+namespace gwt {
+namespace backends {
+
+/**
+ * @brief Copy-on-write view of a directory for one job
+ *
+ * The directory is the read-only lower layer of an overlay whose upper
+ * layer starts empty: mounting costs the same for any repository size,
+ * parallel jobs never see each other's changes, and discarding drops the
+ * upper layer. Root uses the kernel overlay filesystem, everyone else
+ * fuse-overlayfs.
+ */
+class OverlayWorkspace : public QObject {
+    Q_OBJECT
+
+public:
+    explicit OverlayWorkspace(QObject* parent = nullptr);
+
+    /**
+     * @brief Discard the workspace without waiting for it
+     */
+    ~OverlayWorkspace() override;
+
+    /**
+     * @brief Start mounting the overlay
+     * @param lowerDir Directory the workspace starts from; must not change while mounted
+     *
+     * Completion is reported through mounted(), always from the event loop.
+     */
+    void mount(const QString& lowerDir);
+
+    /**
+     * @brief Get the directory where the overlay is mounted
+     */
+    QString mergedDir() const;
+
+    /**
+     * @brief Check if the overlay is mounted
+     */
+    bool isMounted() const;
+
+    /**
+     * @brief Check if anything was written to the workspace since it was mounted
+     */
+    bool hasChanges() const;
+
+    /**
+     * @brief Unmount the overlay and delete its upper layer in the background
+     * @param removeFirst Command to run before, e.g. removing the container using it
+     */
+    void discard(const QStringList& removeFirst = QStringList());
+
+signals:
+    void mounted(bool success);
+    void error(const QString& errorMessage);
+
+private:
+    static constexpr int MOUNT_TIMEOUT_MS = 30000; // 30 seconds
+
+    QString m_root;                 // Holds upper/, work/ and merged/
+    QStringList m_unmountCommand;
+    bool m_mounted;
+
+    /**
+     * @brief Report a mount that could not be started
+     */
+    void failLater(const QString& message);
+};
+
+} // namespace backends
+} // namespace gwt
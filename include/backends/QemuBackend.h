@@ -1,50 +1,129 @@
 #pragma once
 
 #include "ExecutionBackend.h"
+#include "VirtualMachine.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QPointer>
+
+class QTimer;
 
 namespace gwt {
 namespace backends {
 
+class ShellSession;
+class VmPool;
+
 /**
  * @brief QEMU VM-based execution backend for higher fidelity
+ *
+ * Each job runs in its own VirtualMachine on a thin qcow2 overlay, with KVM
+ * when /dev/kvm is usable and TCG otherwise. Instead of booting, the guest
+ * is restored from a VmSnapshotStore snapshot of the same image taken once
+ * it had booted and gone idle, so a job costs a restore rather than a boot.
+ * Guests that cannot be snapshotted are booted. With a VmPool, the job
+ * takes a guest the pool started ahead of time instead.
+ *
+ * Steps run in a ShellSession over a virtio-serial port instead of SSH: the
+ * guest only needs a shell reading from and writing to
+ * /dev/virtio-ports/org.gwt.agent, and no network has to come up first. The
+ * repository is shared read-only over 9p and mounted copy-on-write at
+ * /github/workspace inside the guest.
  */
 class QemuBackend : public ExecutionBackend {
     Q_OBJECT
 
 public:
     explicit QemuBackend(QObject* parent = nullptr);
+
+    /**
+     * @param pool Pool to take a started guest from, or nullptr to always start one
+     */
+    explicit QemuBackend(VmPool* pool, QObject* parent = nullptr);
     ~QemuBackend() override;
 
-    bool executeStep(const core::WorkflowStep& step,
-                    const QVariantMap& context) override;
+    void executeStep(const core::WorkflowStep& step,
+                     const QVariantMap& context) override;
 
-    bool prepareEnvironment(const QString& runsOn) override;
+    void prepareEnvironment(const QString& runsOn) override;
 
     void cleanup() override;
 
+    void cancel() override;
+
+    /**
+     * @brief Get the directory the base images are looked up in
+     */
+    static QString imageDirectory();
+
+    /**
+     * @brief Get the guest a job runs in
+     * @param runsOn runs-on label of the job
+     * @param limits CPUs and memory of the guest; 0 fields get the defaults
+     * @param workspace Directory shared with the guest, or empty
+     */
+    static VirtualMachine::Config guestConfig(const QString& runsOn,
+                                              const core::ResourceReservation& limits,
+                                              const QString& workspace);
+
 private:
-    QString m_vmId;
+    static constexpr int STEP_TIMEOUT_MS = 300000;   // 5 minutes
+    static constexpr int SETUP_TIMEOUT_MS = 30000;   // 30 seconds
+
     QString m_qemuPath;
-    
+    QString m_readyToken;         // Printed by the agent once the workspace is mounted
+    QByteArray m_setupOutput;
+    QPointer<VmPool> m_pool;
+    QPointer<VirtualMachine> m_vm;
+    QPointer<ShellSession> m_shell;
+    QTimer* m_stepTimer;
+    QTimer* m_setupTimer;
+    QElapsedTimer m_startClock;
+    bool m_pooled;                // The guest came from m_pool
+    bool m_scoped;                // Runs in its own systemd scope and cgroup
+    bool m_cancelled;
+
     /**
      * @brief Find QEMU executable
      */
     bool detectQemu();
-    
+
     /**
      * @brief Map GitHub runner spec to VM image
      */
-    QString mapRunsOnToVMImage(const QString& runsOn) const;
-    
+    static QString mapRunsOnToVMImage(const QString& runsOn);
+
+    /**
+     * @brief Take the job's guest from the pool, or start it from the image's snapshot
+     *
+     * Completion is reported through environmentPrepared().
+     */
+    void startVM(const VirtualMachine::Config& config);
+
+    /**
+     * @brief Mount the workspace and set the clock in a guest whose agent answered
+     */
+    void setupGuest();
+
     /**
-     * @brief Start the VM
+     * @brief Collect the agent's output until the setup's ready token
      */
-    bool startVM(const QString& imagePath);
-    
+    void readSetupOutput();
+
+    /**
+     * @brief Report a guest that went away during setup or while running a step
+     */
+    void endAgentSession();
+
     /**
-     * @brief Stop the VM
+     * @brief Stop the VM; a step in flight reports nothing
      */
     void stopVM();
+
+    /**
+     * @brief Report the outcome of the step that ran in the shell session
+     */
+    void finishShellStep(int exitCode);
 };
 
 } // namespace backends
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ExecutionBackend.h"
+#include <QJsonObject>
+#include <QPointer>
+
+namespace gwt {
+namespace core {
+class WorkerCoordinator;
+class WorkerLease;
+}
+
+namespace backends {
+
+/**
+ * @brief Runs a job on a `gwt worker` process through the coordinator
+ *
+ * prepareEnvironment() waits for a free worker slot, after which every call
+ * is forwarded to the worker's local backend and its events are relayed
+ * back. If the worker goes away the operation in progress fails.
+ */
+class RemoteBackend : public ExecutionBackend {
+    Q_OBJECT
+
+public:
+    /**
+     * @param coordinator Coordinator to lease a worker slot from
+     * @param backendType Backend the worker runs the job with
+     */
+    RemoteBackend(core::WorkerCoordinator* coordinator, BackendType backendType, QObject* parent = nullptr);
+    ~RemoteBackend() override;
+
+    void executeStep(const core::WorkflowStep& step,
+                     const QVariantMap& context) override;
+
+    void prepareEnvironment(const QString& runsOn) override;
+
+    void cleanup() override;
+
+    void cancel() override;
+
+    /**
+     * @brief Get the usage the worker reported since the previous call
+     */
+    core::ResourceUsage takeResourceUsage() override;
+
+private:
+    enum class Pending { None, Prepare, Step, Cleanup };
+
+    QPointer<core::WorkerCoordinator> m_coordinator;
+    core::WorkerLease* m_lease;
+    BackendType m_backendType;
+    core::ResourceUsage m_usage;    // Reported by the worker, not yet taken
+    QString m_runsOn;
+    Pending m_pending;
+
+    /**
+     * @brief Relay a message from the worker
+     */
+    void handleMessage(const QJsonObject& message);
+
+    /**
+     * @brief Fail the operation in progress after the lease was lost
+     */
+    void failPending();
+};
+
+} // namespace backends
+} // namespace gwt
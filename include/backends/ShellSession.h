@@ -0,0 +1,84 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+class QIODevice;
+
+namespace gwt {
+namespace backends {
+
+/**
+ * @brief Runs steps one after another in a long-lived POSIX shell
+ *
+ * Commands are written to the shell's input and their output is read back
+ * from the same device, so one shell process serves every step of a job.
+ * After each step the shell prints a marker line with a per-session token
+ * and the exit status, which separates the steps in the output stream.
+ * The marker also tells whether the step appended to $GITHUB_ENV.
+ *
+ * Each step runs in a subshell, so `exit` or `cd` in a step cannot break the
+ * session. Lines of the form NAME=value appended to $GITHUB_ENV are exported
+ * in the session and reach all later steps.
+ */
+class ShellSession : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @param device Input and merged output of a running `sh`; not owned
+     */
+    explicit ShellSession(QIODevice* device, QObject* parent = nullptr);
+    ~ShellSession() override;
+
+    /**
+     * @brief Check if a step is running
+     */
+    bool isBusy() const;
+
+    /**
+     * @brief Check if the last finished step appended to $GITHUB_ENV
+     *
+     * Such a step changed the session, not just the filesystem.
+     */
+    bool exportedEnvironment() const;
+
+    /**
+     * @brief Start a step
+     * @param shell Shell that interprets the script (sh, bash, ...)
+     * @param script Script of the step
+     * @param workingDirectory Directory to run in, empty for the session's
+     *
+     * Output is reported through output(), completion through finished().
+     */
+    void run(const QString& shell, const QString& script, const QString& workingDirectory);
+
+    /**
+     * @brief Quote a string for a POSIX shell
+     */
+    static QString quote(const QString& text);
+
+signals:
+    void output(const QString& text);
+    void finished(int exitCode);
+
+private:
+    static constexpr int MAX_LINE_BYTES = 64 * 1024;  // Longer lines are passed on in pieces
+
+    QPointer<QIODevice> m_device;
+    QString m_token;
+    QByteArray m_buffer;
+    bool m_busy;
+    bool m_started;
+    bool m_exportedEnvironment;
+    bool m_heldBlankLine;     // May be the line break written before the marker
+
+    /**
+     * @brief Split received output into lines and detect the end marker
+     */
+    void readOutput();
+};
+
+} // namespace backends
+} // namespace gwt
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "ExecutionBackend.h"
+#include <QRandomGenerator>
+
+class QTimer;
+
+namespace gwt {
+namespace backends {
+
+/**
+ * @brief Timing model of a SimulatedBackend
+ */
+struct SimulationProfile {
+    enum class Distribution {
+        Fixed,          // Always the mean
+        Uniform,        // Uniform in [0, 2 * mean]
+        Exponential,    // Exponential with the given mean
+        LogNormal       // Log-normal with the given mean and sigma 1 (long tail)
+    };
+
+    Distribution distribution = Distribution::Fixed;
+    double meanStepMs = 0;
+    double prepareMs = 0;
+    double cleanupMs = 0;
+    double failureRate = 0;         // Probability that a step fails
+    int outputLinesPerStep = 0;
+    bool spin = false;              // Busy-wait instead of sleeping
+};
+
+/**
+ * @brief Backend that only pretends to run steps
+ *
+ * Each step takes a duration drawn from the profile's distribution, either
+ * waiting on a timer or spinning on the CPU. No process is started, which
+ * makes it possible to measure the scheduler on its own.
+ */
+class SimulatedBackend : public ExecutionBackend {
+    Q_OBJECT
+
+public:
+    /**
+     * @param profile Timing model
+     * @param seed Seed of the duration and failure draws
+     */
+    SimulatedBackend(const SimulationProfile& profile, quint32 seed, QObject* parent = nullptr);
+    ~SimulatedBackend() override;
+
+    void executeStep(const core::WorkflowStep& step,
+                     const QVariantMap& context) override;
+
+    void prepareEnvironment(const QString& runsOn) override;
+
+    void cleanup() override;
+
+    void cancel() override;
+
+    /**
+     * @brief Get the CPU time all instances have spent spinning
+     * @return Nanoseconds since process start
+     */
+    static qint64 totalSpinNs();
+
+private:
+    enum class Pending { None, Prepare, Step, Cleanup };
+
+    SimulationProfile m_profile;
+    QRandomGenerator m_random;
+    QTimer* m_timer;
+    Pending m_pending;
+    bool m_pendingSuccess;
+
+    /**
+     * @brief Draw a step duration from the profile
+     */
+    double sampleStepMs();
+
+    /**
+     * @brief Complete an operation after a simulated duration
+     */
+    void simulate(Pending operation, double durationMs, bool success);
+
+    /**
+     * @brief Emit the completion signal of the pending operation
+     */
+    void complete(bool success);
+};
+
+} // namespace backends
+} // namespace gwt
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QProcess>
+#include <QStringList>
+#include <functional>
+
+class QIODevice;
+class QLocalSocket;
+class QTimer;
+
+namespace gwt {
+namespace backends {
+
+/**
+ * @brief One QEMU guest on a thin qcow2 overlay, with a shell on a virtio-serial port
+ *
+ * The guest either boots from its base image or resumes from the image's
+ * VmSnapshotStore snapshot, falling back to a boot if the snapshot cannot
+ * be saved or restored. Snapshots hold a paused guest, so a restored one
+ * is continued over QMP once its state has arrived. Either way it is ready once the shell on the agent
+ * port answers; from then on agent() belongs to the user of the VM.
+ * The VM's directory holds the overlay disk, the sockets and the guest's
+ * console log, and is removed with the VM.
+ */
+class VirtualMachine : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief What a guest is started from and with
+     */
+    struct Config {
+        QString backingDisk;        // Base image the guest's overlay is created on
+        bool fromSnapshot = false;  // Restore the image's VmSnapshotStore snapshot instead of booting
+        int cpus = 2;
+        qint64 memoryMiB = 2048;
+        bool kvm = false;
+        QString workspace;          // Directory shared over 9p, empty to share an empty one
+        bool scoped = false;        // Start QEMU in a transient systemd user scope
+    };
+
+    explicit VirtualMachine(QObject* parent = nullptr);
+
+    /**
+     * @brief Kill the guest and remove its directory without waiting for QEMU
+     */
+    ~VirtualMachine() override;
+
+    /**
+     * @brief Create the overlay disk and start QEMU
+     *
+     * Reports ready() or failed() from the event loop.
+     */
+    void start(const Config& config);
+
+    /**
+     * @brief Check if the agent answered
+     */
+    bool isReady() const;
+
+    /**
+     * @brief Check if the guest was restored from a snapshot rather than booted
+     */
+    bool isRestored() const;
+
+    /**
+     * @brief Save the paused guest's memory and device state to a file
+     *
+     * The guest stays paused and its disk is flushed. Reports stateSaved();
+     * the file may appear only when QEMU has exited.
+     */
+    void saveState(const QString& stateFile);
+
+    /**
+     * @brief Let QEMU exit cleanly, keeping the overlay disk consistent; reports stopped()
+     */
+    void shutdown();
+
+    /**
+     * @brief Get the agent shell's input and merged output, nullptr before ready()
+     */
+    QIODevice* agent() const;
+
+    /**
+     * @brief Get the pid of QEMU, or of systemd-run in its place
+     */
+    qint64 processId() const;
+
+    /**
+     * @brief Get the directory of the VM
+     */
+    QString directory() const;
+
+    /**
+     * @brief Get the time from start() to ready() in milliseconds
+     */
+    qint64 startupMs() const;
+
+    static constexpr const char* AGENT_PORT = "org.gwt.agent";
+    static constexpr const char* WORKSPACE_TAG = "gwt-workspace";
+
+signals:
+    void output(const QString& text);
+    void ready();
+    void failed(const QString& errorMessage);   // Instead of ready()
+    void stopped();                             // QEMU or the agent went away after ready()
+    void stateSaved(const QString& errorMessage);
+
+private:
+    static constexpr int OVERLAY_TIMEOUT_MS = 30000;     // 30 seconds
+    static constexpr int BOOT_TIMEOUT_MS = 120000;       // 2 minutes with KVM
+    static constexpr int TCG_BOOT_TIMEOUT_MS = 600000;   // 10 minutes when emulating
+    static constexpr int SAVE_TIMEOUT_MS = 300000;       // 5 minutes
+    static constexpr int AGENT_POLL_MS = 100;
+    static constexpr int MIGRATION_POLL_MS = 100;
+
+    Config m_config;
+    QString m_snapshotDir;        // Snapshot being restored, empty when booting
+    QString m_dir;
+    QString m_readyToken;
+    QByteArray m_agentOutput;
+    QPointer<QProcess> m_overlayProcess;
+    QPointer<QProcess> m_process;
+    QPointer<QLocalSocket> m_agent;
+    QPointer<QLocalSocket> m_qmp;
+    QByteArray m_qmpOutput;
+    QList<std::function<void(const QJsonObject& response)>> m_qmpCallbacks;
+    QTimer* m_bootTimer;
+    QTimer* m_agentPollTimer;
+    QTimer* m_saveTimer;
+    QElapsedTimer m_startClock;
+    qint64 m_startupMs;
+    bool m_ready;
+    bool m_saving;
+
+    /**
+     * @brief Create the overlay on the snapshot's disk or the base image
+     */
+    void createOverlay();
+
+    /**
+     * @brief Start QEMU on the overlay disk
+     */
+    void launch();
+
+    /**
+     * @brief Get the QEMU arguments of the VM
+     */
+    QStringList arguments() const;
+
+    /**
+     * @brief Try to connect to the agent socket until QEMU has created it
+     */
+    void connectAgent();
+
+    /**
+     * @brief Collect the agent's output until the ready token
+     */
+    void readAgentOutput();
+
+    /**
+     * @brief Report QEMU or the agent going away
+     */
+    void handleExit();
+
+    /**
+     * @brief Stop the VM and boot it instead, or report why it never became ready
+     */
+    void fail(const QString& errorMessage);
+
+    /**
+     * @brief Kill QEMU without waiting for it
+     */
+    void kill();
+
+    /**
+     * @brief Continue a restored guest once its saved state has arrived
+     *
+     * The guest was saved paused, and QEMU resumes it in the run state it
+     * was saved in. A failure is handled like a failed boot.
+     */
+    void resumeRestored();
+
+    /**
+     * @brief Poll the incoming migration and send cont once it completed
+     */
+    void pollIncoming();
+
+    /**
+     * @brief Connect to QEMU's machine protocol, waiting for QEMU to create the socket
+     * @param onConnected Called once the capabilities negotiation is sent
+     * @param onError Called if the connection fails or breaks
+     */
+    void openMonitor(std::function<void()> onConnected,
+                     std::function<void(const QString& errorMessage)> onError);
+
+    /**
+     * @brief Disconnect from the machine protocol, dropping unanswered commands
+     */
+    void closeMonitor();
+
+    /**
+     * @brief Send a command to QEMU's machine protocol
+     * @param onResponse Called with the response, which holds "return" or "error"
+     */
+    void qmp(const QString& command, const QJsonObject& arguments,
+             std::function<void(const QJsonObject& response)> onResponse);
+
+    /**
+     * @brief Dispatch the complete lines received from the machine protocol
+     */
+    void readQmpOutput();
+
+    /**
+     * @brief Poll the migration to the state file until it ends
+     */
+    void pollMigration();
+
+    /**
+     * @brief Report the end of saveState() once
+     */
+    void finishSave(const QString& errorMessage);
+};
+
+} // namespace backends
+} // namespace gwt
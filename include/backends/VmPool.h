@@ -0,0 +1,110 @@
+#pragma once
+
+#include "VirtualMachine.h"
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+
+namespace gwt {
+namespace backends {
+
+/**
+ * @brief Keeps guests started so that QEMU jobs skip the boot or restore
+ *
+ * Guests are grouped by image, CPUs, memory and workspace, since the 9p
+ * share of the workspace is fixed when QEMU starts. Each group is kept at
+ * the pool size: handing a guest out starts a replacement in the
+ * background. A job may also take a guest that is still starting, which
+ * beats starting its own. Guests are never handed out twice.
+ */
+class VmPool : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Hits, misses and waiting of the jobs that asked the pool for a guest
+     */
+    struct Stats {
+        int hits = 0;           // Got a started guest
+        int partialHits = 0;    // Got a guest that was still starting
+        int misses = 0;         // Started their own guest
+        qint64 waitMs = 0;      // Time the jobs waited for their guests, in total
+    };
+
+    /**
+     * @param size Number of started guests to keep per image, limits and workspace
+     */
+    explicit VmPool(int size, QObject* parent = nullptr);
+
+    /**
+     * @brief Kill the idle guests without waiting for QEMU
+     */
+    ~VmPool() override;
+
+    /**
+     * @brief Get the number of started guests kept per group
+     */
+    int size() const;
+
+    /**
+     * @brief Start guests in the background until the group is full
+     */
+    void warm(const VirtualMachine::Config& config);
+
+    /**
+     * @brief Take a guest, preferring a ready one, and start its replacement
+     * @param config Guest the job needs
+     * @param parent New owner of the guest
+     * @return A ready or starting guest, or nullptr if the group has none
+     */
+    VirtualMachine* acquire(const VirtualMachine::Config& config, QObject* parent);
+
+    /**
+     * @brief Account the time a job waited for its guest, pooled or not
+     */
+    void recordWait(qint64 waitMs);
+
+    /**
+     * @brief Get the statistics since the pool was created
+     */
+    Stats stats() const;
+
+signals:
+    void error(const QString& errorMessage);
+
+private:
+    /**
+     * @brief Guests of one image, limits and workspace
+     */
+    struct Group {
+        QList<QPointer<VirtualMachine>> vms;  // Ready and starting
+        int failures = 0;                     // Failed starts since the last ready guest
+        qint64 retryAtMs = 0;                 // No refills before this time since the epoch
+    };
+
+    static constexpr int RETRY_MS = 5000;         // 5 seconds after the first failed start
+    static constexpr int MAX_RETRY_SHIFT = 6;     // Doubling up to 320 seconds
+
+    int m_size;
+    QMap<QString, Group> m_groups;
+    Stats m_stats;
+
+    /**
+     * @brief Get the key of the group of a guest
+     */
+    static QString groupKey(const VirtualMachine::Config& config);
+
+    /**
+     * @brief Start one guest for a group without blocking
+     */
+    void startVM(const QString& key, const VirtualMachine::Config& config);
+
+    /**
+     * @brief Forget a guest that failed or stopped while in the pool
+     */
+    void dropVM(const QString& key, VirtualMachine* vm);
+};
+
+} // namespace backends
+} // namespace gwt
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "VirtualMachine.h"
+#include <QList>
+#include <QMap>
+#include <QPointer>
+#include <QString>
+#include <functional>
+
+namespace gwt {
+namespace backends {
+
+/**
+ * @brief Keeps a snapshot of a booted, idle guest per base image and VM size
+ *
+ * A snapshot is the disk of a guest that booted until its agent answered,
+ * plus the guest's saved memory and device state. Restoring one skips the
+ * boot: the guest resumes with the agent shell already waiting for input.
+ * A migration stream only restores into a VM with the same CPUs, memory
+ * and accelerator, so those are part of the key, as is the base image's
+ * modification time, which makes a rebuilt image invalidate its snapshots.
+ *
+ * Snapshots live in `vm-snapshots/` under the cache directory and are
+ * shared by all processes; each is saved once, concurrent requests for the
+ * same one wait for it.
+ */
+class VmSnapshotStore {
+public:
+    /**
+     * @brief Called with the snapshot directory, or an empty one and the error
+     */
+    using Callback = std::function<void(const QString& snapshotDir, const QString& errorMessage)>;
+
+    static VmSnapshotStore& instance();
+
+    /**
+     * @brief Get the snapshot of a guest, booting and saving it first if there is none
+     * @param config Guest to snapshot; its backingDisk is the base image
+     * @param context The callback is dropped once this object is gone
+     * @param onReady Called once from the event loop
+     */
+    void acquire(const VirtualMachine::Config& config, QObject* context, Callback onReady);
+
+    /**
+     * @brief Delete a snapshot that could not be restored
+     */
+    void discard(const QString& snapshotDir);
+
+    /**
+     * @brief Get the directory of the snapshot of a guest
+     */
+    static QString snapshotDir(const VirtualMachine::Config& config);
+
+    /**
+     * @brief Check if a snapshot directory holds a disk and a saved state
+     */
+    static bool isComplete(const QString& snapshotDir);
+
+    static constexpr const char* DISK_FILE = "disk.qcow2";
+    static constexpr const char* STATE_FILE = "memory.state";
+
+private:
+    VmSnapshotStore() = default;
+
+    struct Waiter {
+        QPointer<QObject> context;
+        Callback onReady;
+    };
+
+    QMap<QString, QList<Waiter>> m_pending;   // By snapshot directory
+    QMap<QString, QString> m_failed;          // Error by snapshot directory; not retried in this process
+
+    /**
+     * @brief Boot a guest and save it as the snapshot
+     */
+    void save(const QString& snapshotDir, const VirtualMachine::Config& config);
+
+    /**
+     * @brief Answer everyone waiting for a snapshot
+     */
+    void finish(const QString& snapshotDir, const QString& errorMessage);
+};
+
+} // namespace backends
+} // namespace gwt
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "core/WorkflowParser.h"
+#include <QString>
+#include <QStringList>
+
+namespace gwt {
+namespace bench {
+
+/**
+ * @brief Builds synthetic workflows with characteristic DAG shapes
+ *
+ * Every job runs on ubuntu-latest and has the same number of trivial run
+ * steps, so only the shape of the graph differs between scenarios.
+ */
+class WorkflowGenerator {
+public:
+    /**
+     * @param stepsPerJob Number of steps in every job
+     * @param seed Seed for the random DAG
+     */
+    explicit WorkflowGenerator(int stepsPerJob = 3, quint32 seed = 1);
+
+    /**
+     * @brief Get the names accepted by generate()
+     */
+    static QStringList scenarios();
+
+    /**
+     * @brief Generate a workflow of a named shape
+     * @param scenario One of scenarios()
+     * @param size Approximate number of jobs
+     */
+    core::Workflow generate(const QString& scenario, int size) const;
+
+    /**
+     * @brief One root, width independent jobs needing it and one sink needing all of them
+     */
+    core::Workflow fanOut(int width) const;
+
+    /**
+     * @brief A single chain of jobs, each needing the previous one
+     */
+    core::Workflow chain(int depth) const;
+
+    /**
+     * @brief Random DAG where each job needs up to maxNeeds earlier jobs
+     */
+    core::Workflow randomDag(int jobs, int maxNeeds = 3) const;
+
+    /**
+     * @brief One matrix job over three axes with about variants combinations, plus a dependent job
+     */
+    core::Workflow matrix(int variants) const;
+
+private:
+    core::Workflow makeWorkflow(const QString& name) const;
+    core::WorkflowJob makeJob(const QString& id, const QStringList& needs) const;
+    static QString jobId(int index);
+
+    int m_stepsPerJob;
+    quint32 m_seed;
+};
+
+} // namespace bench
+} // namespace gwt
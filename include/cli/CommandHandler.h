@@ -37,6 +37,8 @@ private:
     int handleClone(const QStringList& args);
     int handleList(const QStringList& args);
     int handleRun(const QStringList& args);
+    int handleRunAll(const QStringList& args);
+    int handleWorker(const QStringList& args);
     int handleWorkflows(const QStringList& args);
     int handleDoctor(const QStringList& args);
 };
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+class QTimer;
+
+namespace gwt {
+namespace core {
+
+/**
+ * @brief Resources a job or step used, as accounted by cgroup v2
+ */
+struct ResourceUsage {
+    bool valid = false;             // false if the environment had no known cgroup
+    double cpuSeconds = 0;
+    qint64 peakMemoryBytes = 0;
+    qint64 ioReadBytes = 0;
+    qint64 ioWriteBytes = 0;
+    double cpuStallSeconds = 0;     // Time some task waited for a CPU (PSI "some")
+    double memoryStallSeconds = 0;  // Time some task waited for memory, e.g. reclaim or swap-in
+    double ioStallSeconds = 0;      // Time some task waited for IO
+
+    /**
+     * @brief Add the usage of another interval
+     *
+     * Counters add up, the peak memory is the larger one.
+     */
+    void accumulate(const ResourceUsage& other);
+
+    /**
+     * @brief Describe the usage in one line
+     */
+    QString summary() const;
+};
+
+/**
+ * @brief Accounts the resources used in a cgroup v2 between two points in time
+ *
+ * CPU time, IO bytes and pressure stall times are counters of the cgroup,
+ * so the usage of an interval is their difference. Peak memory is sampled
+ * from memory.current while the cgroup is watched; when memory.peak rose
+ * during an interval, its exact value is used instead.
+ */
+class CgroupMonitor : public QObject {
+    Q_OBJECT
+
+public:
+    explicit CgroupMonitor(QObject* parent = nullptr);
+    ~CgroupMonitor() override;
+
+    /**
+     * @brief Start watching a cgroup; usage counts from now
+     * @param cgroupPath Directory of the cgroup under /sys/fs/cgroup
+     */
+    void start(const QString& cgroupPath);
+
+    /**
+     * @brief Get the directory of the watched cgroup, empty if none
+     */
+    QString cgroupPath() const;
+
+    /**
+     * @brief Get the usage since start() or the previous call
+     * @return The usage, invalid if no cgroup is watched or it is gone
+     */
+    ResourceUsage take();
+
+    /**
+     * @brief Get the cgroup v2 directory a process runs in
+     * @return Directory under /sys/fs/cgroup, or empty if the process or cgroup v2 is not there
+     */
+    static QString cgroupOfProcess(qint64 pid);
+
+    static constexpr int SAMPLE_INTERVAL_MS = 500;
+
+private:
+    /**
+     * @brief Cumulative counters of the cgroup at one point in time
+     */
+    struct Counters {
+        bool valid = false;
+        qint64 cpuUsec = 0;
+        qint64 ioReadBytes = 0;
+        qint64 ioWriteBytes = 0;
+        qint64 cpuStallUsec = 0;
+        qint64 memoryStallUsec = 0;
+        qint64 ioStallUsec = 0;
+        qint64 memoryPeak = 0;      // 0 if the kernel has no memory.peak
+    };
+
+    QString m_path;
+    QTimer* m_sampleTimer;
+    Counters m_last;
+    qint64 m_sampledPeak;           // Largest memory.current since the last take()
+
+    Counters readCounters() const;
+
+    /**
+     * @brief Fold the current memory use into the sampled peak
+     */
+    void sampleMemory();
+
+    /**
+     * @brief Read a single-number file of the cgroup, 0 if missing
+     */
+    qint64 readValue(const QString& fileName) const;
+
+    /**
+     * @brief Read the "some" total of a pressure file of the cgroup, in microseconds
+     */
+    qint64 readStallUsec(const QString& fileName) const;
+};
+
+} // namespace core
+} // namespace gwt
@@ -1,18 +1,45 @@
 #pragma once
 
+#include "CgroupMonitor.h"
+#include "JobGraph.h"
 #include "WorkflowParser.h"
+#include "backends/ExecutionBackend.h"
+#include <QElapsedTimer>
 #include <QObject>
+#include <QPointer>
+#include <QMap>
+#include <QSet>
+#include <functional>
+#include <map>
 #include <memory>
+#include <queue>
+#include <vector>
 
 namespace gwt {
 namespace backends {
-class ExecutionBackend;
+class ContainerPool;
+class ImagePrefetcher;
+class VmPool;
 }
 
 namespace core {
 
+class JobHistory;
+class JobResultCache;
+class LocalConfig;
+class RepoSnapshot;
+class ResourceBudget;
+class WorkerCoordinator;
+class RunJournal;
+struct JobResult;
+struct ResourceReservation;
+
 /**
  * @brief Executes workflow jobs and manages their lifecycle
+ *
+ * Execution is driven entirely by the Qt event loop: jobs advance from one
+ * state to the next as their backends report completion, so a single thread
+ * can drive many concurrent jobs without blocking.
  */
 class JobExecutor : public QObject {
     Q_OBJECT
@@ -25,18 +52,126 @@ public:
      * @brief Execute a complete workflow
      * @param workflow The workflow to execute
      * @param triggerEvent The event that triggered the workflow
-     * @param useQemu Use QEMU backend instead of container backend
+     * @param backendType Environment the jobs run in, locally or on the workers
      * @return true if execution started successfully
+     *
+     * Returns immediately; the outcome is reported through executionFinished().
      */
     bool executeWorkflow(const Workflow& workflow, 
                         const QString& triggerEvent,
-                        bool useQemu = false);
+                        backends::BackendType backendType = backends::BackendType::Container);
 
     /**
      * @brief Stop execution of current workflow
+     *
+     * No further jobs are started, the steps in flight are killed and all
+     * live environments are torn down concurrently. Returns immediately;
+     * executionStopped() and executionFinished() follow once the last
+     * environment is gone.
      */
     void stopExecution();
 
+    /**
+     * @brief Set the maximum number of jobs that run at the same time
+     * @param jobs Job count (values below 1 are clamped to 1)
+     */
+    void setMaxParallelJobs(int jobs);
+
+    /**
+     * @brief Get the maximum number of jobs that run at the same time
+     * @return Job count, defaults to the number of CPU cores
+     */
+    int maxParallelJobs() const;
+
+    /**
+     * @brief Share a global job and memory budget with other executors
+     * @param budget The budget, or nullptr for a private budget sized to this host
+     *
+     * The budget is not owned and must outlive the execution.
+     */
+    void setResourceBudget(ResourceBudget* budget);
+
+    using BackendFactory = std::function<std::unique_ptr<backends::ExecutionBackend>()>;
+
+    /**
+     * @brief Override how the backend of each job is created
+     * @param factory Called once per started job; empty to restore the default
+     *
+     * Takes precedence over the backend type and the worker coordinator.
+     */
+    void setBackendFactory(BackendFactory factory);
+
+    /**
+     * @brief Share a pool of warm containers with other executors
+     * @param pool The pool, or nullptr for a private pool sized by the local config
+     *
+     * The pool is not owned and must outlive the execution. It is used by
+     * container jobs only; a pool of size 0 disables pooling.
+     */
+    void setContainerPool(backends::ContainerPool* pool);
+
+    /**
+     * @brief Share an image prefetcher with other executors
+     * @param prefetcher The prefetcher, or nullptr for a private one
+     *
+     * The prefetcher is not owned and must outlive the execution. Its
+     * progress is not forwarded as imageProgress(); connect to it instead.
+     */
+    void setImagePrefetcher(backends::ImagePrefetcher* prefetcher);
+
+    /**
+     * @brief Share a pool of started VMs with other executors
+     * @param pool The pool, or nullptr for a private pool sized by the local config
+     *
+     * The pool is not owned and must outlive the execution. It is used by
+     * QEMU jobs only; a pool of size 0 disables pooling.
+     */
+    void setVmPool(backends::VmPool* pool);
+
+    /**
+     * @brief Get the pool QEMU jobs take their VMs from
+     * @return The shared or private pool, or nullptr if jobs start their own VMs
+     */
+    backends::VmPool* vmPool() const;
+
+    /**
+     * @brief Run jobs on `gwt worker` processes instead of this machine
+     * @param coordinator Coordinator the workers connect to, or nullptr to run locally
+     *
+     * The coordinator is not owned and must outlive the execution. CPU and
+     * memory reservations are then enforced by the workers, not by this host.
+     */
+    void setWorkerCoordinator(WorkerCoordinator* coordinator);
+
+    /**
+     * @brief Set the local repository the workflow runs against
+     * @param repoPath Local path to the repository
+     */
+    void setRepositoryPath(const QString& repoPath);
+
+    /**
+     * @brief Skip jobs whose inputs are unchanged since a successful run
+     * @param incremental true to replay recorded results for unchanged jobs
+     *
+     * Requires a repository path, whose working tree is part of the inputs.
+     */
+    void setIncremental(bool incremental);
+
+    /**
+     * @brief Resume an earlier run in the next executeWorkflow() call
+     * @param runId Id of the run to resume
+     *
+     * Jobs that succeeded in that run are not started again; their recorded
+     * output is replayed. Failed and unfinished jobs run as usual.
+     */
+    void setResumeRunId(const QString& runId);
+
+    /**
+     * @brief Get the id of the current or last run
+     * @return Run id under which the run journal is written
+     */
+    QString runId() const;
+
     /**
      * @brief Check if execution is currently running
      * @return true if running
@@ -49,17 +184,210 @@ signals:
     void stepStarted(const QString& jobId, const QString& stepName);
     void stepFinished(const QString& jobId, const QString& stepName, bool success);
     void stepOutput(const QString& jobId, const QString& stepName, const QString& output);
+    void imageProgress(const QString& image, const QString& status);
+
+    /**
+     * @brief Resources a step used, for environments with a known cgroup
+     */
+    void stepResources(const QString& jobId, const QString& stepName, const gwt::core::ResourceUsage& usage);
+
+    /**
+     * @brief Resources a job used in total, emitted right before jobFinished()
+     */
+    void jobResources(const QString& jobId, const gwt::core::ResourceUsage& usage);
     void executionFinished(bool success);
+    void executionStopped(qint64 elapsedMs);
     void error(const QString& errorMessage);
 
 private:
+    struct JobRun;
+
+    /**
+     * @brief Variants of one matrix job and their strategy settings
+     */
+    struct MatrixGroup {
+        QStringList variants;
+        int maxParallel = 0;        // 0 means unlimited
+        bool failFast = true;
+        bool cancelled = false;
+        int running = 0;
+        std::vector<int> parked;    // Ready variants waiting for max-parallel
+    };
+
+    /**
+     * @brief Entry of the ready queue, ordered by priority and then FIFO
+     */
+    struct ReadyJob {
+        double priority;
+        quint64 sequence;
+        int index;
+
+        bool operator<(const ReadyJob& other) const {
+            if (priority != other.priority) {
+                return priority < other.priority;
+            }
+            return sequence > other.sequence;
+        }
+    };
+
     bool m_running;
-    std::unique_ptr<backends::ExecutionBackend> m_backend;
+    bool m_stopRequested;
+    bool m_success;
+    backends::BackendType m_backendType;
+    bool m_incremental;
+    bool m_useResultCache;
+    int m_maxParallelJobs;
+    QString m_repositoryPath;
+    QPointer<ResourceBudget> m_budget;
+    std::unique_ptr<ResourceBudget> m_hostBudget;
+    QPointer<WorkerCoordinator> m_coordinator;
+    QPointer<backends::ContainerPool> m_pool;
+    std::unique_ptr<backends::ContainerPool> m_ownPool;
+    QPointer<backends::VmPool> m_vmPool;
+    std::unique_ptr<backends::VmPool> m_ownVmPool;
+    QPointer<backends::ImagePrefetcher> m_prefetcher;
+    std::unique_ptr<backends::ImagePrefetcher> m_ownPrefetcher;
+    BackendFactory m_backendFactory;
+    std::unique_ptr<LocalConfig> m_config;
+    QElapsedTimer m_stopTimer;
+
+    Workflow m_workflow;
+    JobGraph m_graph;
+    std::vector<double> m_priorities;   // By job index
+    std::priority_queue<ReadyJob> m_readyQueue;
+    quint64 m_readySequence;
+    QMap<QString, MatrixGroup> m_matrixGroups;
+    QMap<QString, QString> m_groupOf;   // variant id -> matrix job id
+    QMap<QString, QString> m_jobKeys;
+    std::unique_ptr<JobHistory> m_history;
+    std::unique_ptr<JobResultCache> m_resultCache;
+    std::unique_ptr<RepoSnapshot> m_snapshot;
+    std::unique_ptr<RunJournal> m_journal;
+    QString m_resumeRunId;
+    QSet<QString> m_resumedJobs;
+    std::map<QString, std::unique_ptr<JobRun>> m_activeJobs;
     
     /**
-     * @brief Execute a single job
+     * @brief Create a fresh backend instance for one job
+     */
+    std::unique_ptr<backends::ExecutionBackend> createBackend() const;
+
+    /**
+     * @brief Get the shared container pool, or the private one if none is set
+     * @return The pool, or nullptr if jobs do not run in pooled containers
+     */
+    backends::ContainerPool* activeContainerPool() const;
+
+    /**
+     * @brief Start pulling the images of all container jobs, without waiting for them
+     */
+    void prefetchImages();
+
+    /**
+     * @brief Pre-start containers for the images and limits of the workflow's jobs
+     */
+    void warmContainerPool();
+
+    /**
+     * @brief Start VMs for the images and limits of the workflow's jobs
+     */
+    void warmVmPool();
+
+    /**
+     * @brief Start ready jobs while job slots are free
+     */
+    void scheduleJobs();
+
+    /**
+     * @brief Expand matrix jobs into variants and rewire needs to them
+     */
+    void expandMatrixJobs(const Workflow& workflow);
+
+    /**
+     * @brief Add a job whose needs are met to the ready queue
+     */
+    void enqueueJob(int index);
+
+    /**
+     * @brief Remove the highest-ranked ready job whose matrix group has room
+     * @return The job index, or -1 if no ready job may start
+     *
+     * Jobs of a group at its max-parallel limit are parked in the group
+     * until one of its running variants completes.
+     */
+    int takeNextJob();
+
+    /**
+     * @brief Cancel the queued and running siblings of a failed variant
+     */
+    void cancelMatrixSiblings(const QString& groupId);
+
+    /**
+     * @brief Kill the step in flight of a running job so it fails right away
+     */
+    void cancelRun(JobRun& run);
+
+    /**
+     * @brief Get the tree hashes of the repository paths a job works in
+     * @return "path:hash" entries, or an empty list if the working tree was not hashed
+     */
+    QStringList workspaceTreeHashes(const WorkflowJob& job) const;
+
+    /**
+     * @brief Check if container jobs of this executor commit cached layers
+     */
+    bool usesLayerCache() const;
+
+    /**
+     * @brief Compute the memoization key of a job whose upstream jobs are done
+     */
+    QString computeJobKey(const WorkflowJob& job) const;
+
+    /**
+     * @brief Replay the recorded result of a job if its inputs are unchanged
+     * @return true if the job was satisfied from the result cache
+     */
+    bool replayCachedJob(const QString& jobId);
+
+    /**
+     * @brief Complete a job from a recorded result instead of running it
+     */
+    void replayJobResult(const QString& jobId, const JobResult& result, const QString& reason);
+
+    /**
+     * @brief Start a single job on its own backend
+     */
+    void startJob(const QString& jobId, const ResourceReservation& reservation);
+
+    /**
+     * @brief Get the shared budget, or the private one if none is set
+     */
+    ResourceBudget* activeBudget() const;
+
+    /**
+     * @brief Advance a job to its next step, or finish it after the last one
+     */
+    void runNextStep(JobRun& run);
+
+    /**
+     * @brief Record the job outcome and tear down its environment
+     */
+    void finishJob(JobRun& run, bool success);
+
+    /**
+     * @brief Release a job whose environment is gone and unblock its dependents
+     */
+    void completeJob(const QString& jobId);
+
+    /**
+     * @brief Mark a job as processed and queue or skip its dependents
+     */
+    void resolveJob(const QString& jobId, bool success);
+
+    /**
+     * @brief Report the workflow outcome once no job is left
      */
-    bool executeJob(const WorkflowJob& job);
+    void finishExecution();
 };
 
 } // namespace core
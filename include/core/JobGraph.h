@@ -0,0 +1,117 @@
+#pragma once
+
+#include "WorkflowParser.h"
+#include <QBitArray>
+#include <QHash>
+#include <QStringList>
+#include <vector>
+
+namespace gwt {
+namespace core {
+
+/**
+ * @brief Job dependency graph compiled to integer indices
+ *
+ * Dependents are kept in one flat array with per-job offsets, and each job
+ * counts the needs that are still unresolved. Resolving a job therefore
+ * touches only its direct dependents, so a whole run costs O(V + E).
+ */
+class JobGraph {
+public:
+    /**
+     * @brief Contiguous range of job indices
+     */
+    struct IndexRange {
+        const int* first = nullptr;
+        const int* last = nullptr;
+
+        const int* begin() const { return first; }
+        const int* end() const { return last; }
+        int size() const { return static_cast<int>(last - first); }
+    };
+
+    JobGraph();
+    ~JobGraph();
+
+    /**
+     * @brief Compile the graph of a set of jobs and reset the run state
+     * @param jobs Jobs keyed by id; needs naming unknown jobs are never met
+     */
+    void build(const QMap<QString, WorkflowJob>& jobs);
+
+    /**
+     * @brief Get the number of jobs
+     */
+    int size() const;
+
+    /**
+     * @brief Get the index of a job
+     * @return The index, or -1 if the job is unknown
+     */
+    int indexOf(const QString& jobId) const;
+
+    /**
+     * @brief Get the id of a job
+     */
+    const QString& jobId(int index) const;
+
+    /**
+     * @brief Get the jobs that need a job
+     */
+    IndexRange dependents(int index) const;
+
+    /**
+     * @brief Get the jobs without needs
+     */
+    std::vector<int> roots() const;
+
+    /**
+     * @brief Order jobs so that every job comes after its needs
+     * @return Indices in topological order; jobs on or behind a cycle are left out
+     */
+    std::vector<int> topologicalOrder() const;
+
+    /**
+     * @brief Mark a job as finished and release its dependents
+     * @param index The job
+     * @param success Whether the job succeeded
+     * @param ready Receives dependents whose needs are all met now
+     * @param skipped Receives dependents that can no longer run because a
+     *        need failed, transitively; they are resolved as failed
+     *
+     * Jobs that are already resolved are left alone.
+     */
+    void resolve(int index, bool success, std::vector<int>& ready, std::vector<int>& skipped);
+
+    /**
+     * @brief Check if a job has been resolved
+     */
+    bool isResolved(int index) const;
+
+    /**
+     * @brief Check if a job was resolved as failed
+     */
+    bool isFailed(int index) const;
+
+    /**
+     * @brief Get the number of resolved jobs
+     */
+    int resolvedCount() const;
+
+private:
+    QStringList m_ids;
+    QHash<QString, int> m_indices;
+    std::vector<int> m_dependentOffsets;    // size() + 1 entries into m_dependents
+    std::vector<int> m_dependents;
+    std::vector<int> m_needCounts;
+
+    // Run state
+    std::vector<int> m_unresolvedNeeds;
+    QBitArray m_resolved;
+    QBitArray m_failed;
+    QBitArray m_needFailed;
+    int m_resolvedCount;
+};
+
+} // namespace core
+} // namespace gwt
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QString>
+#include <QMap>
+
+namespace gwt {
+namespace core {
+
+/**
+ * @brief Records past job durations per workflow for scheduling decisions
+ *
+ * Durations are kept as an exponential moving average per job id and stored
+ * under the cache directory, one file per workflow.
+ */
+class JobHistory {
+public:
+    JobHistory();
+    ~JobHistory();
+
+    /**
+     * @brief Load recorded durations for a workflow
+     * @param workflowFile Path of the workflow file the history belongs to
+     * @return true if a history file was found and read
+     */
+    bool load(const QString& workflowFile);
+
+    /**
+     * @brief Persist recorded durations for the loaded workflow
+     * @return true if successful
+     */
+    bool save() const;
+
+    /**
+     * @brief Get the average duration of a job
+     * @param jobId The job id
+     * @return Duration in milliseconds, or -1 if the job has no history
+     */
+    qint64 averageDuration(const QString& jobId) const;
+
+    /**
+     * @brief Record the duration of a finished job
+     * @param jobId The job id
+     * @param durationMs Wall time of the job in milliseconds
+     */
+    void recordDuration(const QString& jobId, qint64 durationMs);
+
+private:
+    QString getHistoryPath(const QString& workflowFile) const;
+
+    QString m_historyPath;
+    QMap<QString, qint64> m_durations;
+};
+
+} // namespace core
+} // namespace gwt
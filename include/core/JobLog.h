@@ -0,0 +1,77 @@
+#pragma once
+
+#include "JobResultCache.h"
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <deque>
+
+namespace gwt {
+namespace core {
+
+/**
+ * @brief Output of one job, written to disk in full and kept in memory as a tail
+ *
+ * Every chunk goes to a log file under the run's directory in the cache.
+ * Only the most recent chunks, up to a fixed number of characters, stay in
+ * memory, so a job that prints gigabytes costs disk space but not memory.
+ */
+class JobLog {
+public:
+    /**
+     * @param maxBufferedChars Size of the in-memory tail in characters
+     */
+    explicit JobLog(qint64 maxBufferedChars = DEFAULT_BUFFER_CHARS);
+    ~JobLog();
+
+    /**
+     * @brief Get the location of the log of a job
+     * @param runId The run id
+     * @param jobId The job id
+     */
+    static QString logPath(const QString& runId, const QString& jobId);
+
+    /**
+     * @brief Open the log file, truncating an earlier log of the same job
+     * @param filePath Location of the file
+     * @return true if successful; the in-memory tail is kept either way
+     */
+    bool open(const QString& filePath);
+
+    /**
+     * @brief Get the location of the log file
+     * @return The path, or an empty string if no file is open
+     */
+    QString filePath() const;
+
+    /**
+     * @brief Record a chunk of output
+     * @param stepName Step that printed it, empty for output outside of any step
+     * @param text The output
+     */
+    void append(const QString& stepName, const QString& text);
+
+    /**
+     * @brief Get the retained tail of the output
+     * @return Most recent chunks, preceded by a note if older ones were dropped
+     */
+    QList<JobLogEntry> entries() const;
+
+    /**
+     * @brief Write buffered output to disk and close the file
+     */
+    void close();
+
+    static constexpr qint64 DEFAULT_BUFFER_CHARS = 128 * 1024;
+
+private:
+    qint64 m_maxBufferedChars;
+    qint64 m_bufferedChars;
+    qint64 m_droppedChars;
+    std::deque<JobLogEntry> m_entries;
+    QString m_lastStep;
+    QFile m_file;
+};
+
+} // namespace core
+} // namespace gwt
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "WorkflowParser.h"
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+namespace gwt {
+namespace core {
+
+/**
+ * @brief One chunk of output recorded while a job ran
+ */
+struct JobLogEntry {
+    QString stepName;               // Empty for output outside of any step
+    QString text;
+};
+
+/**
+ * @brief Recorded outcome of a successful job
+ *
+ * Job outputs are not part of it: steps cannot set outputs yet, so the
+ * `outputs:` of a job are unevaluated templates with nothing to replay.
+ */
+struct JobResult {
+    QStringList stepNames;          // Steps in the order they ran
+    QList<JobLogEntry> log;         // Output recorded while the job ran
+};
+
+/**
+ * @brief Memoizes successful job results keyed by a hash of their inputs
+ *
+ * Results are stored under the cache directory. A key covers the job
+ * definition, the backend it runs on, the content of the repository paths the job works in and the
+ * keys of its upstream jobs, so a change anywhere upstream invalidates every
+ * downstream result.
+ *
+ * Results unused for MAX_AGE_DAYS are dropped, and the least recently used
+ * ones beyond MAX_TOTAL_BYTES, when the cache first stores a result.
+ */
+class JobResultCache {
+public:
+    JobResultCache();
+    ~JobResultCache();
+
+    /**
+     * @brief Compute the input key of a job
+     * @param job The (matrix-expanded) job
+     * @param backend Name of the backend the job runs on
+     * @param workflowEnv Global environment of the workflow
+     * @param treeHashes Content hashes of the repository paths the job uses
+     * @param upstreamKeys Keys of the jobs listed in needs
+     * @return Hex-encoded SHA-256 key
+     */
+    QString computeKey(const WorkflowJob& job,
+                       const QString& backend,
+                       const QVariantMap& workflowEnv,
+                       const QStringList& treeHashes,
+                       const QStringList& upstreamKeys) const;
+
+    /**
+     * @brief Look up a recorded result
+     * @param key Input key of the job
+     * @param result Filled with the recorded result on a hit
+     * @return true on a cache hit
+     */
+    bool lookup(const QString& key, JobResult& result) const;
+
+    /**
+     * @brief Record the result of a successful job
+     * @param key Input key of the job
+     * @param result The result to record
+     * @return true if successful
+     */
+    bool store(const QString& key, const JobResult& result);
+
+    /**
+     * @brief Remove results that are too old or beyond the size cap
+     */
+    void prune() const;
+
+    /**
+     * @brief Get the repository paths a job depends on
+     * @param job The job
+     * @return Paths relative to the repository root ("" for the whole repository)
+     */
+    static QStringList relevantPaths(const WorkflowJob& job);
+
+private:
+    static constexpr int MAX_AGE_DAYS = 30;
+    static constexpr qint64 MAX_TOTAL_BYTES = 256LL << 20; // 256 MiB
+
+    bool m_pruned;
+
+    QString getResultDir() const;
+    QString getResultPath(const QString& key) const;
+};
+
+} // namespace core
+} // namespace gwt
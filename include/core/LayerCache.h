@@ -0,0 +1,90 @@
+#pragma once
+
+#include "WorkflowParser.h"
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+class QJsonObject;
+
+namespace gwt {
+namespace core {
+
+/**
+ * @brief Index of container images committed after a prefix of a job's steps
+ *
+ * A prefix key chains the base image, the job environment, the content of
+ * the workspace and the definition of every step in the prefix, like the
+ * cache of a container build. The index lives under the cache directory and records the size of
+ * each committed layer and when it was last used, so the least recently
+ * used layers can be evicted to stay within a disk budget. The images
+ * themselves are committed and removed by the container backend.
+ */
+class LayerCache {
+public:
+    LayerCache();
+    ~LayerCache();
+
+    /**
+     * @brief Compute the key of every step prefix of a job
+     * @param baseImage Image the job starts from
+     * @param job The (matrix-expanded) job
+     * @param workspaceHash Content hash of the repository paths the job uses
+     * @return Hex-encoded SHA-256 keys; element i covers steps 0..i
+     */
+    static QStringList prefixKeys(const QString& baseImage, const WorkflowJob& job,
+                                  const QString& workspaceHash);
+
+    /**
+     * @brief Get the image tag a prefix is committed under
+     */
+    static QString imageTag(const QString& key);
+
+    /**
+     * @brief Find the longest cached prefix and mark it as used
+     * @param keys Prefix keys from prefixKeys()
+     * @return Number of steps covered, 0 on a miss
+     */
+    int lookup(const QStringList& keys) const;
+
+    /**
+     * @brief Check if a prefix is cached
+     */
+    bool contains(const QString& key) const;
+
+    /**
+     * @brief Record a committed prefix
+     * @param sizeBytes Size of the layer the commit added
+     */
+    bool record(const QString& key, qint64 sizeBytes) const;
+
+    /**
+     * @brief Forget a prefix whose image is gone
+     */
+    bool remove(const QString& key) const;
+
+    /**
+     * @brief Pick the least recently used prefixes to drop until the rest fits the budget
+     * @param budgetBytes Disk budget of all cached layers
+     * @return Keys of the prefixes whose images the caller removes
+     *
+     * The prefixes stay in the index, and count against the budget, until
+     * the caller has removed their images and calls remove(). An image
+     * still used by a container is picked again by the next eviction.
+     */
+    QStringList evict(qint64 budgetBytes) const;
+
+private:
+    static QString getIndexPath();
+
+    /**
+     * @brief Read, change and write the index under a lock shared with other processes
+     * @param update Changes the layers object; returns false to leave the file as it is
+     */
+    bool updateIndex(const std::function<bool(QJsonObject& layers)>& update) const;
+
+    QJsonObject readIndex() const;
+};
+
+} // namespace core
+} // namespace gwt
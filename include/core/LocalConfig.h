@@ -0,0 +1,101 @@
+#pragma once
+
+#include "ResourceBudget.h"
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+namespace gwt {
+namespace core {
+
+/**
+ * @brief User settings read from config.yml in the configuration directory
+ *
+ * Example:
+ * @code
+ * host:                    # budget shared by all running jobs
+ *   cpus: 8
+ *   memory: 12G
+ * resources:
+ *   runners:               # per runs-on label
+ *     ubuntu-latest: { cpus: 2, memory: 4G }
+ *   jobs:                  # per job id, wins over the runner setting
+ *     integration: { cpus: 4, memory: 8G }
+ * pool:
+ *   containers: 2          # idle containers kept per image (0 disables the pool)
+ * layer_cache:
+ *   budget: 20G            # disk used by cached step prefixes (0 disables the cache)
+ * @endcode
+ */
+class LocalConfig {
+public:
+    LocalConfig();
+    ~LocalConfig();
+
+    /**
+     * @brief Load a configuration file
+     * @param filePath Path to the file; empty for the default location
+     * @return true if the file was missing or read successfully
+     */
+    bool load(const QString& filePath = QString());
+
+    /**
+     * @brief Get errors from the last load() call
+     */
+    QStringList getErrors() const;
+
+    /**
+     * @brief Get the default location of the configuration file
+     */
+    static QString defaultPath();
+
+    /**
+     * @brief Get the resources the running jobs may reserve in total
+     * @return Host capacity, with any configured host values applied
+     */
+    ResourceReservation hostCapacity() const;
+
+    /**
+     * @brief Get the reservation of a job
+     * @param jobId Id of the job (the matrix job id for matrix variants)
+     * @param runsOn runs-on label of the job
+     * @return Configured job or runner reservation, else the built-in default for the label
+     */
+    ResourceReservation jobResources(const QString& jobId, const QString& runsOn) const;
+
+    /**
+     * @brief Get the number of warm containers to keep per image
+     * @return Pool size, 0 if no pool is configured
+     */
+    int containerPoolSize() const;
+
+    /**
+     * @brief Get the number of started VMs to keep per image
+     * @return Pool size, 0 if no VM pool is configured
+     */
+    int vmPoolSize() const;
+
+    /**
+     * @brief Get the disk budget of the step-prefix layer cache
+     * @return Size in bytes, 0 if the cache is disabled
+     */
+    qint64 layerCacheBudget() const;
+
+    /**
+     * @brief Parse a memory size such as 512M or 16G
+     * @return Size in bytes, or -1 if the text is not a size
+     */
+    static qint64 parseMemorySize(const QString& text);
+
+private:
+    ResourceReservation m_host;
+    QMap<QString, ResourceReservation> m_runnerResources;
+    QMap<QString, ResourceReservation> m_jobResources;
+    int m_containerPoolSize;
+    int m_vmPoolSize;
+    qint64 m_layerCacheBudget;
+    QStringList m_errors;
+};
+
+} // namespace core
+} // namespace gwt
@@ -2,6 +2,9 @@
 
 #include <QVariantMap>
 #include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
 
 namespace gwt {
 namespace core {
@@ -30,7 +33,21 @@ public:
      */
     bool hasMatrix(const WorkflowJob& job) const;
 
+    /**
+     * @brief Expand every matrix job of a workflow into its variants
+     * @param jobs Jobs by id, as parsed
+     * @param variantsOf Filled with the variant ids of each matrix job, if given
+     * @return Jobs by id; needs that named a matrix job name all of its variants
+     */
+    QMap<QString, WorkflowJob> expandJobs(const QMap<QString, WorkflowJob>& jobs,
+                                          QMap<QString, QStringList>* variantsOf = nullptr) const;
+
 private:
+    /**
+     * @brief Replace ${{ matrix.<key> }} expressions with the given values
+     */
+    QString substituteMatrixValues(const QString& text, const QVariantMap& values) const;
+
     /**
      * @brief Generate all combinations from matrix variables
      */
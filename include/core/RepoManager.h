@@ -24,7 +24,9 @@ public:
      * @brief Clone a repository to the local storage
      * @param repoUrl The repository URL (e.g., https://github.com/owner/repo)
      * @param branch Optional branch to clone (default: main/master)
-     * @return true if successful
+     * @return true if the clone was started
+     *
+     * Returns immediately; the outcome is reported through cloneFinished().
      */
     bool cloneRepository(const QString& repoUrl, const QString& branch = QString());
 
@@ -61,6 +63,8 @@ signals:
     void error(const QString& errorMessage);
 
 private:
+    static constexpr int CLONE_TIMEOUT_MS = 300000; // 5 minutes
+
     StorageProvider& m_storage;
 };
 
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QObject>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+namespace gwt {
+namespace core {
+
+/**
+ * @brief Captures content hashes of a repository working tree
+ *
+ * The snapshot covers tracked, modified and untracked (non-ignored) files.
+ * It is written through a temporary Git index and a scratch object
+ * directory, so the repository's own index, working tree and object
+ * database are left untouched.
+ */
+class RepoSnapshot : public QObject {
+    Q_OBJECT
+
+public:
+    explicit RepoSnapshot(QObject* parent = nullptr);
+    ~RepoSnapshot() override;
+
+    /**
+     * @brief Start capturing the working tree of a repository
+     * @param repoPath Local path to the repository
+     *
+     * Completion is reported through finished().
+     */
+    void capture(const QString& repoPath);
+
+    /**
+     * @brief Get the tree hash of a directory in the captured working tree
+     * @param relativePath Directory relative to the repository root ("" for the root)
+     * @return Git tree hash, or an empty string if the directory does not exist
+     */
+    QString treeHash(const QString& relativePath) const;
+
+signals:
+    void finished(bool success);
+    void error(const QString& errorMessage);
+
+private:
+    static constexpr int GIT_TIMEOUT_MS = 120000; // 2 minutes
+
+    QString m_repoPath;
+    QString m_indexPath;
+    QString m_objectsPath;          // Scratch objects; the repository's are an alternate
+    QString m_alternatePath;
+    QString m_rootTree;
+    QMap<QString, QString> m_trees;
+
+    /**
+     * @brief Run git in the repository against the temporary index and objects
+     */
+    void runGit(const QStringList& args,
+                std::function<void(bool success, const QByteArray& output)> onFinished);
+
+    /**
+     * @brief Remove the temporary index and objects
+     */
+    void removeScratch();
+
+    /**
+     * @brief Remove the temporary index and objects and report the result
+     */
+    void finish(bool success);
+};
+
+} // namespace core
+} // namespace gwt
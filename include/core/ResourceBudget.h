@@ -0,0 +1,97 @@
+#pragma once
+
+#include <QObject>
+
+namespace gwt {
+namespace core {
+
+/**
+ * @brief CPU and memory set aside for one job
+ */
+struct ResourceReservation {
+    double cpus = 0;                // 0 means no CPU reservation
+    qint64 memoryBytes = 0;         // 0 means no memory reservation
+};
+
+/**
+ * @brief Global limit on concurrently running jobs and their resources
+ *
+ * One budget can be shared by several JobExecutor instances, so workflows
+ * that run side by side draw from the same pool instead of each assuming
+ * the whole machine. Executors acquire a job's reservation before starting
+ * it and release it once the job's environment is gone.
+ */
+class ResourceBudget : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Create a budget
+     * @param maxJobs Maximum number of jobs running at the same time
+     * @param capacity Total CPUs and memory the jobs may reserve (0 for unlimited)
+     */
+    explicit ResourceBudget(int maxJobs,
+                            const ResourceReservation& capacity = ResourceReservation(),
+                            QObject* parent = nullptr);
+    ~ResourceBudget() override;
+
+    /**
+     * @brief Reserve a job slot and resources if all of them are available
+     * @param reservation Resources the job needs
+     * @return true if the reservation was made
+     *
+     * A job asking for more than the whole capacity is admitted once
+     * nothing else is reserved, so it cannot wait forever.
+     */
+    bool tryAcquire(const ResourceReservation& reservation);
+
+    /**
+     * @brief Return a reservation made with tryAcquire()
+     * @param reservation Resources the job had asked for
+     */
+    void release(const ResourceReservation& reservation);
+
+    /**
+     * @brief Get the maximum number of concurrently running jobs
+     */
+    int maxJobs() const;
+
+    /**
+     * @brief Get the total capacity (0 fields are unlimited)
+     */
+    ResourceReservation capacity() const;
+
+    /**
+     * @brief Get the number of jobs holding a reservation
+     */
+    int runningJobs() const;
+
+    /**
+     * @brief Get the resources currently reserved
+     */
+    ResourceReservation reserved() const;
+
+    /**
+     * @brief Get the capacity of this machine
+     * @return Logical CPUs and physical memory (0 where it cannot be determined)
+     */
+    static ResourceReservation hostCapacity();
+
+signals:
+    /**
+     * @brief Emitted from the event loop after capacity was returned
+     */
+    void released();
+
+private:
+    ResourceReservation effective(const ResourceReservation& reservation) const;
+
+    int m_maxJobs;
+    ResourceReservation m_capacity;
+    ResourceReservation m_reserved;
+    int m_runningJobs;
+    bool m_releasePending;
+};
+
+} // namespace core
+} // namespace gwt
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "JobResultCache.h"
+#include <QFile>
+#include <QMap>
+#include <QString>
+
+class QJsonObject;
+
+namespace gwt {
+namespace core {
+
+/**
+ * @brief Append-only record of the job and step transitions of a run
+ *
+ * Each run writes one JSON record per line to a journal under the cache
+ * directory. Records are flushed as they are written, so the journal of a
+ * run that was killed still tells which jobs had already succeeded.
+ */
+class RunJournal {
+public:
+    RunJournal();
+    ~RunJournal();
+
+    /**
+     * @brief Generate an id for a new run
+     * @return Sortable id made of the start time and a random suffix
+     */
+    static QString createRunId();
+
+    /**
+     * @brief Read the journal of an earlier run
+     * @param runId The run id
+     * @return true if the journal exists and starts with a run record
+     */
+    bool load(const QString& runId);
+
+    /**
+     * @brief Open the journal of a run for appending, creating it if needed
+     * @param runId The run id
+     * @return true if successful
+     */
+    bool open(const QString& runId);
+
+    /**
+     * @brief Get the id of the loaded or opened run
+     */
+    QString runId() const;
+
+    /**
+     * @brief Get the workflow file recorded by the loaded journal
+     */
+    QString workflowFile() const;
+
+    /**
+     * @brief Get the repository path recorded by the loaded journal
+     */
+    QString repositoryPath() const;
+
+    /**
+     * @brief Get the trigger event recorded by the loaded journal
+     */
+    QString triggerEvent() const;
+
+    /**
+     * @brief Get the results of the jobs the loaded journal saw succeed
+     * @return Results keyed by job id
+     */
+    QMap<QString, JobResult> succeededJobs() const;
+
+    /**
+     * @brief Record the start (or resumption) of the run
+     */
+    void recordRunStarted(const QString& workflowFile,
+                          const QString& repoPath,
+                          const QString& triggerEvent);
+
+    /**
+     * @brief Record that a job started on a backend
+     */
+    void recordJobStarted(const QString& jobId);
+
+    /**
+     * @brief Record that a step of a job started
+     */
+    void recordStepStarted(const QString& jobId, const QString& stepName);
+
+    /**
+     * @brief Record the outcome of a step
+     */
+    void recordStepFinished(const QString& jobId, const QString& stepName, bool success);
+
+    /**
+     * @brief Record the outcome of a job
+     * @param result Outputs and steps of a successful job, reused on resume
+     */
+    void recordJobFinished(const QString& jobId, bool success, const JobResult& result = JobResult());
+
+    /**
+     * @brief Record the overall outcome of the run
+     */
+    void recordRunFinished(bool success);
+
+private:
+    QString getJournalPath(const QString& runId) const;
+    void append(QJsonObject record);
+
+    QString m_runId;
+    QString m_workflowFile;
+    QString m_repositoryPath;
+    QString m_triggerEvent;
+    QMap<QString, JobResult> m_succeeded;
+    QFile m_file;
+};
+
+} // namespace core
+} // namespace gwt
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <QDateTime>
+#include <QString>
+
+class QJsonObject;
+
+namespace gwt {
+namespace core {
+
+/**
+ * @brief What was found out about one external tool
+ */
+struct ToolInfo {
+    bool available = false;
+    QString version;
+    bool rootless = false;          // Container runtimes only
+};
+
+/**
+ * @brief Container runtimes, QEMU, fuse-overlayfs and kernel features available on this host
+ *
+ * The tools are probed concurrently, once per process. Results are kept
+ * for a few minutes in a file under the cache directory, so consecutive
+ * invocations and every backend of a run share one set of probes.
+ */
+class RuntimeCapabilities {
+public:
+    RuntimeCapabilities();
+    ~RuntimeCapabilities();
+
+    /**
+     * @brief Get the capabilities of this host
+     * @return Results of the cache file if it is fresh, otherwise of a new probe
+     *
+     * Probes at most once per process; safe to call from any thread.
+     */
+    static const RuntimeCapabilities& instance();
+
+    /**
+     * @brief Probe every tool now, ignoring the cache, and refresh the cache file
+     */
+    static RuntimeCapabilities probe();
+
+    /**
+     * @brief Get the preferred container runtime
+     * @return "docker" or "podman", or an empty string if neither works
+     */
+    QString containerRuntime() const;
+
+    ToolInfo docker() const;
+    ToolInfo podman() const;
+    ToolInfo qemu() const;
+    ToolInfo fuseOverlayfs() const;
+
+    /**
+     * @brief Check if the unified cgroup v2 hierarchy is mounted
+     */
+    bool hasCgroupV2() const;
+
+    /**
+     * @brief Check if /dev/kvm can be used for hardware-accelerated VMs
+     */
+    bool hasKvm() const;
+
+    /**
+     * @brief Check if unprivileged user namespaces can mount overlays and procfs
+     */
+    bool hasUserNamespaces() const;
+
+    /**
+     * @brief Check if `systemd-run --user --scope` can put processes into their own cgroup
+     */
+    bool hasUserScopes() const;
+
+    /**
+     * @brief Get the time the tools were probed
+     */
+    QDateTime probedAt() const;
+
+    /**
+     * @brief Check if the results were read from the cache file
+     */
+    bool isFromCache() const;
+
+    static constexpr int CACHE_TTL_SECONDS = 600;   // 10 minutes
+    static constexpr int PROBE_TIMEOUT_MS = 5000;
+
+private:
+    ToolInfo m_docker;
+    ToolInfo m_podman;
+    ToolInfo m_qemu;
+    ToolInfo m_fuseOverlayfs;
+    bool m_cgroupV2;
+    bool m_kvm;
+    bool m_userNamespaces;
+    bool m_userScopes;
+    QDateTime m_probedAt;
+    bool m_fromCache;
+
+    static QString getCachePath();
+
+    /**
+     * @brief Read the cache file if it is fresh and was written for the same PATH
+     */
+    bool load();
+
+    /**
+     * @brief Write the results to the cache file
+     */
+    bool save() const;
+
+    static QJsonObject toolToJson(const ToolInfo& tool);
+    static ToolInfo toolFromJson(const QJsonObject& object);
+};
+
+} // namespace core
+} // namespace gwt
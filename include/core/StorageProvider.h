@@ -12,6 +12,7 @@ namespace core {
  * Windows: %APPDATA%\GithubWorkflowTool\repos\
  * Linux: $XDG_DATA_HOME/githubworkflowtool/repos/ or ~/.local/share/githubworkflowtool/repos/
  * Cache: $XDG_CACHE_HOME/githubworkflowtool/ or ~/.cache/githubworkflowtool/
+ * Config: $XDG_CONFIG_HOME/githubworkflowtool/ or ~/.config/githubworkflowtool/
  */
 class StorageProvider {
 public:
@@ -32,6 +33,12 @@ public:
      */
     QString getCacheRoot() const;
 
+    /**
+     * @brief Get the directory holding user configuration
+     * @return Path to configuration directory (not created automatically)
+     */
+    QString getConfigRoot() const;
+
     /**
      * @brief Get the directory for a specific repository
      * @param repoUrl The repository URL
@@ -60,6 +67,7 @@ private:
 
     QString m_repoRoot;
     QString m_cacheRoot;
+    QString m_configRoot;
 };
 
 } // namespace core
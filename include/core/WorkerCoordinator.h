@@ -0,0 +1,129 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+class QLocalServer;
+class QLocalSocket;
+
+namespace gwt {
+namespace core {
+
+class MessageChannel;
+class WorkerCoordinator;
+
+/**
+ * @brief A job slot on a `gwt worker`, held for the lifetime of one job
+ *
+ * A lease starts out pending and is granted once a worker has a free slot.
+ * Messages are exchanged with the worker until the lease is released or
+ * the worker goes away.
+ */
+class WorkerLease : public QObject {
+    Q_OBJECT
+
+public:
+    ~WorkerLease() override;
+
+    /**
+     * @brief Get the id that tags the messages of this lease
+     */
+    qint64 id() const;
+
+    /**
+     * @brief Check if a worker slot has been assigned
+     */
+    bool isGranted() const;
+
+    /**
+     * @brief Get the name the worker registered with
+     */
+    QString workerName() const;
+
+    /**
+     * @brief Send a message to the worker; the lease id is added
+     */
+    void send(QJsonObject message);
+
+    /**
+     * @brief Give the slot back, or stop waiting for one
+     */
+    void release();
+
+signals:
+    void granted();
+    void messageReceived(const QJsonObject& message);
+    void lost();
+
+private:
+    friend class WorkerCoordinator;
+    WorkerLease(WorkerCoordinator* coordinator, qint64 id, QObject* parent);
+
+    QPointer<WorkerCoordinator> m_coordinator;
+    qint64 m_id;
+    QLocalSocket* m_worker;
+    bool m_released;
+};
+
+/**
+ * @brief Hands out job slots on `gwt worker` processes connected over a local socket
+ */
+class WorkerCoordinator : public QObject {
+    Q_OBJECT
+
+public:
+    explicit WorkerCoordinator(QObject* parent = nullptr);
+    ~WorkerCoordinator() override;
+
+    /**
+     * @brief Start accepting workers
+     * @param socketPath Path of the Unix domain socket (named pipe on Windows)
+     * @return true if successful
+     */
+    bool listen(const QString& socketPath);
+
+    /**
+     * @brief Ask for a job slot; granted() follows once a worker has one free
+     * @param parent Owner of the lease
+     */
+    WorkerLease* requestLease(QObject* parent);
+
+    /**
+     * @brief Get the number of connected workers
+     */
+    int workerCount() const;
+
+signals:
+    void workerConnected(const QString& name, int slotCount);
+    void workerDisconnected(const QString& name);
+    void error(const QString& errorMessage);
+
+private:
+    friend class WorkerLease;
+
+    struct Worker {
+        MessageChannel* channel = nullptr;
+        QString name;
+        int slotCount = 0;
+        QList<QPointer<WorkerLease>> leases;
+    };
+
+    void acceptWorkers();
+    void handleMessage(QLocalSocket* socket, const QJsonObject& message);
+    void removeWorker(QLocalSocket* socket);
+    void releaseLease(WorkerLease* lease);
+    void sendToWorker(WorkerLease* lease, const QJsonObject& message);
+    void assignLeases();
+
+    QLocalServer* m_server;
+    QMap<QLocalSocket*, Worker> m_workers;
+    QList<QPointer<WorkerLease>> m_pending;
+    qint64 m_nextLeaseId;
+};
+
+} // namespace core
+} // namespace gwt
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "WorkflowParser.h"
+#include "backends/ExecutionBackend.h"
+#include <QByteArray>
+#include <QJsonObject>
+#include <QObject>
+#include <QPointer>
+
+class QIODevice;
+
+namespace gwt {
+namespace core {
+
+/**
+ * @brief Wire format shared by the coordinator and `gwt worker`
+ *
+ * Messages are JSON objects, one per line, over any stream device, so the
+ * same protocol works over a Unix domain socket or a TCP connection. Every
+ * message has a "type"; messages about a job carry its "lease" id.
+ *
+ * Worker to coordinator: hello, prepared, output, error, stepCompleted,
+ * cleanupFinished. Coordinator to worker: prepare, execute, cancel, cleanup.
+ */
+namespace protocol {
+
+constexpr int VERSION = 3;
+
+/**
+ * @brief Default path of the coordinator socket
+ */
+QString defaultSocketPath();
+
+/**
+ * @brief Serialize a step for an execute message
+ */
+QJsonObject stepToJson(const WorkflowStep& step);
+
+/**
+ * @brief Deserialize a step from an execute message
+ */
+WorkflowStep stepFromJson(const QJsonObject& object);
+
+/**
+ * @brief Get the name of a backend type in a prepare message
+ */
+QString backendTypeName(backends::BackendType type);
+
+/**
+ * @brief Get the backend type named in a prepare message
+ * @return The type, or Container for an unknown name
+ */
+backends::BackendType backendTypeFromName(const QString& name);
+
+/**
+ * @brief Serialize resource usage for a prepared or stepCompleted message
+ * @return The usage, or an empty object if it is invalid
+ */
+QJsonObject usageToJson(const ResourceUsage& usage);
+
+/**
+ * @brief Deserialize resource usage, invalid for an empty object
+ */
+ResourceUsage usageFromJson(const QJsonObject& object);
+
+} // namespace protocol
+
+/**
+ * @brief Sends and receives newline-delimited JSON messages on a stream
+ */
+class MessageChannel : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Wrap an open device
+     * @param device The stream; not owned
+     */
+    explicit MessageChannel(QIODevice* device, QObject* parent = nullptr);
+    ~MessageChannel() override;
+
+    /**
+     * @brief Queue a message for sending
+     */
+    void send(const QJsonObject& message);
+
+signals:
+    void messageReceived(const QJsonObject& message);
+
+private:
+    void readMessages();
+
+    QPointer<QIODevice> m_device;
+    QByteArray m_buffer;
+};
+
+} // namespace core
+} // namespace gwt
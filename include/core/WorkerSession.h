@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include <map>
+#include <memory>
+
+class QLocalSocket;
+
+namespace gwt {
+namespace backends {
+class ExecutionBackend;
+}
+
+namespace core {
+
+class MessageChannel;
+
+/**
+ * @brief Serves job slots of this machine to a coordinator (`gwt worker`)
+ *
+ * Each lease the coordinator sends gets its own local backend. Backend
+ * events are streamed back tagged with the lease id. When the connection
+ * drops, all local environments are torn down.
+ */
+class WorkerSession : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @param slotCount Number of jobs this worker runs at the same time
+     */
+    explicit WorkerSession(int slotCount, QObject* parent = nullptr);
+    ~WorkerSession() override;
+
+    /**
+     * @brief Connect to a coordinator
+     * @param socketPath Path of the coordinator socket
+     *
+     * connected() or finished() follows.
+     */
+    void connectToCoordinator(const QString& socketPath);
+
+    /**
+     * @brief Get the number of leases being served
+     */
+    int activeLeases() const;
+
+signals:
+    void connected();
+    void leaseStarted(qint64 leaseId, const QString& runsOn);
+    void leaseFinished(qint64 leaseId);
+    void finished();
+    void error(const QString& errorMessage);
+
+private:
+    void handleMessage(const QJsonObject& message);
+    void prepare(qint64 leaseId, const QJsonObject& message);
+    void send(qint64 leaseId, QJsonObject message);
+
+    int m_slotCount;
+    QLocalSocket* m_socket;
+    MessageChannel* m_channel;
+    bool m_connected;
+    std::map<qint64, std::unique_ptr<backends::ExecutionBackend>> m_backends;
+};
+
+} // namespace core
+} // namespace gwt
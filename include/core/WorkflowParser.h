@@ -35,6 +35,7 @@ struct WorkflowJob {
     QVariantMap outputs;            // Job outputs
     QList<WorkflowStep> steps;
     QVariantMap strategy;           // Matrix strategy
+    QVariantMap matrixValues;       // Resolved matrix values of an expanded job
     QString ifCondition;            // Conditional execution
 };
 
@@ -12,6 +12,7 @@ namespace gwt {
 namespace core {
 class RepoManager;
 class JobExecutor;
+class WorkflowParser;
 }
 
 namespace gui {
@@ -31,9 +32,17 @@ private slots:
     void onRefreshRepositories();
     void onRepositorySelected();
     void onRunWorkflow();
+    void onStopWorkflow();
+    void onCloneFinished(bool success);
+    void onExecutionFinished(bool success);
+    void onExecutionStopped(qint64 elapsedMs);
+    void onError(const QString& errorMessage);
     void onJobOutput(const QString& jobId, const QString& stepName, const QString& output);
+    void onImageProgress(const QString& image, const QString& status);
 
 private:
+    static constexpr int MAX_OUTPUT_LINES = 10000;
+
     void setupUI();
     void loadRepositories();
 
@@ -42,6 +51,7 @@ private:
     QTextEdit* m_outputView;
     QPushButton* m_cloneButton;
     QPushButton* m_runButton;
+    QPushButton* m_stopButton;
     QComboBox* m_backendCombo;
 
     std::unique_ptr<core::RepoManager> m_repoManager;
@@ -1,32 +1,116 @@
 #include "backends/ContainerBackend.h"
+#include "backends/ContainerPool.h"
+#include "backends/EngineClient.h"
+#include "backends/EngineStream.h"
+#include "backends/OverlayWorkspace.h"
+#include "backends/ShellSession.h"
+#include "core/RuntimeCapabilities.h"
 #include <QProcess>
+#include <QTimer>
+#include <QUuid>
 #include <QDebug>
+#include <memory>
 
 namespace gwt {
 namespace backends {
 
+namespace {
+
+/**
+ * @brief Describe why a runtime command run by runRuntime() did not succeed
+ */
+QString runtimeError(QProcess& process, bool finished) {
+    if (process.error() == QProcess::FailedToStart) {
+        return "could not start the container runtime: " + process.errorString();
+    }
+    if (!finished) {
+        return "timed out";
+    }
+    return QString::fromUtf8(process.readAllStandardError()).trimmed();
+}
+
+} // namespace
+
 ContainerBackend::ContainerBackend(QObject* parent)
+    : ContainerBackend(nullptr, parent)
+{
+}
+
+ContainerBackend::ContainerBackend(ContainerPool* pool, QObject* parent)
     : ExecutionBackend(parent)
+    , m_pool(pool)
+    , m_stepTimer(new QTimer(this))
+    , m_pooled(false)
+    , m_cancelled(false)
+    , m_creating(false)
+    , m_shellStarting(false)
+    , m_layerCacheBudget(0)
+    , m_restoredSteps(0)
+    , m_stepIndex(0)
+    , m_layerCaching(false)
+    , m_committing(false)
+    , m_uncommittedMs(0)
 {
-    detectRuntime();
+    m_containerRuntime = core::RuntimeCapabilities::instance().containerRuntime();
+    m_engine = EngineClient::instance();
+    
+    m_stepTimer->setSingleShot(true);
+    connect(m_stepTimer, &QTimer::timeout, this, [this]() {
+        discardShellSession();
+        emit error("Step execution timeout");
+        emit stepCompleted(false);
+    });
 }
 
 ContainerBackend::~ContainerBackend() {
-    cleanup();
+    // The daemon finishes a commit whose client is killed, so keep the
+    // client and remove the image nobody will record once it is done
+    if (m_activeProcess && !m_commitTag.isEmpty()) {
+        QProcess* process = m_activeProcess;
+        QString runtime = m_containerRuntime;
+        QString tag = m_commitTag;
+        process->setParent(nullptr);
+        connect(process, &QProcess::finished, process, [process, runtime, tag]() {
+            QProcess::startDetached(runtime, QStringList() << "rmi" << tag);
+            process->deleteLater();
+        });
+    }
+
+    // Never block in the destructor; let the runtime remove a leftover container
+    if (m_pooled && m_pool) {
+        m_pool->release(m_containerName);
+        return;
+    }
+
+    QStringList removeArgs;
+    if (!m_containerName.isEmpty()) {
+        removeArgs << m_containerRuntime << "rm" << "-f" << m_containerName;
+    }
+    if (m_workspace) {
+        m_workspace->discard(removeArgs);
+    } else if (!removeArgs.isEmpty()) {
+        QProcess::startDetached(removeArgs.takeFirst(), removeArgs);
+    }
 }
 
-bool ContainerBackend::executeStep(const core::WorkflowStep& step,
+void ContainerBackend::executeStep(const core::WorkflowStep& step,
                                    const QVariantMap& context) {
     if (m_containerId.isEmpty()) {
         emit error("Container not prepared");
-        return false;
+        completeStepLater(false);
+        return;
+    }
+    
+    // The container started from an image that already holds these steps
+    int stepIndex = m_stepIndex++;
+    if (stepIndex < m_restoredSteps) {
+        emit output("Restored from the layer cache");
+        completeStepLater(true);
+        return;
     }
     
     // Execute command in container
     if (!step.run.isEmpty()) {
-        QProcess process;
-        QStringList args;
-        
         // Use specified shell or default to sh
         // Common shells: bash, sh, dash, ash
         QString shell = step.shell.isEmpty() ? "sh" : step.shell;
@@ -40,92 +124,581 @@ bool ContainerBackend::executeStep(const core::WorkflowStep& step,
         }
         // For other shells, use as specified and let container fail if unavailable
         
-        args << "exec" << m_containerId << shell << "-c" << step.run;
+        QString script = step.run;
+        QString workingDirectory = context.value("workingDirectory").toString();
         
-        process.start(m_containerRuntime, args);
+        m_stepClock.start();
+        m_stepTimer->start(STEP_TIMEOUT_MS);
+        openShellSession([this, shell, script, workingDirectory](const QString& errorMessage) {
+            if (!errorMessage.isEmpty()) {
+                m_stepTimer->stop();
+                emit error("Failed to start a shell in the container: " + errorMessage);
+                completeStepLater(false);
+                return;
+            }
+            m_shell->run(shell, script, workingDirectory);
+        });
+        return;
+    }
+    
+    if (!step.uses.isEmpty()) {
+        // Handle actions like actions/checkout@v3
+        emit this->output("Action execution: " + step.uses + " (stub)");
+        // Would need more complex action resolution
+    }
+    
+    completeStepLater(true);
+}
+
+void ContainerBackend::prepareEnvironment(const QString& runsOn) {
+    QString image = mapRunsOnToImage(runsOn);
+    m_baseImage = image;
+    
+    // Start from the longest prefix of the steps that an earlier run committed;
+    // without a hash of the workspace a cached layer could predate its changes
+    bool workspaceKnown = m_workspacePath.isEmpty() || !m_workspaceHash.isEmpty();
+    if (m_layerCacheBudget > 0 && !m_job.steps.isEmpty() && workspaceKnown) {
+        m_layerKeys = core::LayerCache::prefixKeys(image, m_job, m_workspaceHash);
+        m_restoredSteps = m_layerCache.lookup(m_layerKeys);
+        m_layerCaching = true;
+        if (m_restoredSteps > 0) {
+            image = core::LayerCache::imageTag(m_layerKeys[m_restoredSteps - 1]);
+        }
+    }
+    
+    // A warm container is already running; the runtime accepts its name as id
+    if (m_pool && m_restoredSteps == 0) {
+        QString pooledName = m_pool->acquire(image, m_resourceLimits, m_workspacePath);
+        if (!pooledName.isEmpty()) {
+            m_containerName = pooledName;
+            m_containerId = pooledName;
+            m_pooled = true;
+            finishPreparation();
+            return;
+        }
+    }
+    
+    if (m_workspacePath.isEmpty()) {
+        startContainer(image);
+        return;
+    }
+    
+    // The repository is shared copy-on-write, never copied into the container
+    m_workspace = new OverlayWorkspace(this);
+    connect(m_workspace, &OverlayWorkspace::error, this, &ExecutionBackend::error);
+    connect(m_workspace, &OverlayWorkspace::mounted, this, [this, image](bool mounted) {
+        if (m_cancelled) {
+            emit error("Container creation cancelled");
+            emit environmentPrepared(false);
+            return;
+        }
+        if (!mounted) {
+            emit error("Running without the repository in " + QString(ContainerPool::WORKSPACE_PATH));
+        }
+        startContainer(image);
+    });
+    m_workspace->mount(m_workspacePath);
+}
+
+void ContainerBackend::startContainer(const QString& image) {
+    // A named container can be removed even if creation is cancelled before
+    // the runtime reported its id
+    m_containerName = "gwt-" + QUuid::createUuid().toString(QUuid::Id128);
+    
+    QString workspaceDir = m_workspace && m_workspace->isMounted() ? m_workspace->mergedDir() : QString();
+    
+    if (m_engine) {
+        // The engine keeps creating after a cancel; whoever gets the late
+        // container removes it
+        m_creating = true;
+        QPointer<ContainerBackend> self(this);
+        QPointer<EngineClient> engine(m_engine);
+        m_engine->runContainer(m_containerName, image, m_resourceLimits, workspaceDir, PREPARE_TIMEOUT_MS,
+                               [self, engine](const QString& containerId, const QString& errorMessage) {
+            if (!self || !self->m_creating) {
+                if (engine && !containerId.isEmpty()) {
+                    engine->removeContainer(containerId, CLEANUP_TIMEOUT_MS);
+                }
+                return;
+            }
+            
+            self->m_creating = false;
+            if (!errorMessage.isEmpty() && self->dropRestoredLayer()) {
+                return;
+            }
+            if (!errorMessage.isEmpty()) {
+                emit self->error("Failed to create container: " + errorMessage);
+                emit self->environmentPrepared(false);
+                return;
+            }
+            self->m_containerId = containerId;
+            self->finishPreparation();
+        });
+        return;
+    }
+    
+    QStringList args = ContainerPool::runArguments(m_containerName, image, m_resourceLimits, workspaceDir);
+    
+    runRuntime(args, PREPARE_TIMEOUT_MS, [this](QProcess& process, bool finished) {
+        if (finished && process.exitCode() == 0) {
+            m_containerId = QString::fromUtf8(process.readAllStandardOutput()).trimmed();
+        }
+        
+        if (m_cancelled) {
+            emit error("Container creation cancelled");
+            emit environmentPrepared(false);
+            return;
+        }
         
-        if (!process.waitForFinished(STEP_TIMEOUT_MS)) {
-            emit error("Step execution timeout");
-            return false;
+        if (!finished || process.exitCode() != 0) {
+            if (finished && dropRestoredLayer()) {
+                return;
+            }
+            emit error("Failed to create container: " + runtimeError(process, finished));
+            emit environmentPrepared(false);
+            return;
         }
         
-        QString output = QString::fromUtf8(process.readAllStandardOutput());
-        emit this->output(output);
+        if (m_containerId.isEmpty()) {
+            emit environmentPrepared(false);
+            return;
+        }
+        finishPreparation();
+    });
+}
+
+void ContainerBackend::finishPreparation() {
+    // Preparation is cancellable until the container is inspected
+    m_creating = true;
+    QPointer<ContainerBackend> self(this);
+    auto onPid = [self](qint64 pid) {
+        if (!self || !self->m_creating) {
+            return;
+        }
+        self->m_creating = false;
         
-        if (process.exitCode() != 0) {
-            QString errorMsg = QString::fromUtf8(process.readAllStandardError());
-            emit error("Step failed: " + errorMsg);
-            return false;
+        // The runtime puts every process of the container into its init process's cgroup
+        QString cgroup = pid > 0 ? core::CgroupMonitor::cgroupOfProcess(pid) : QString();
+        if (!cgroup.isEmpty()) {
+            self->setCgroup(cgroup);
         }
-    } else if (!step.uses.isEmpty()) {
-        // Handle actions like actions/checkout@v3
-        emit this->output("Action execution: " + step.uses + " (stub)");
-        // Would need more complex action resolution
+        emit self->environmentPrepared(true);
+    };
+    
+    if (m_engine) {
+        m_engine->containerPid(m_containerId, PREPARE_TIMEOUT_MS, [onPid](qint64 pid, const QString&) {
+            onPid(pid);
+        });
+        return;
     }
     
-    return true;
+    QStringList args;
+    args << "inspect" << "--format" << "{{.State.Pid}}" << m_containerId;
+    runRuntime(args, PREPARE_TIMEOUT_MS, [onPid](QProcess& process, bool finished) {
+        bool ok = finished && process.exitCode() == 0;
+        onPid(ok ? QString::fromUtf8(process.readAllStandardOutput()).trimmed().toLongLong() : 0);
+    });
 }
 
-bool ContainerBackend::prepareEnvironment(const QString& runsOn) {
-    QString image = mapRunsOnToImage(runsOn);
+void ContainerBackend::cleanup() {
+    discardShellSession();
+    
+    if (m_containerName.isEmpty()) {
+        discardWorkspace();
+        completeCleanupLater();
+        return;
+    }
+    
+    // The pool replaces the container in the background
+    if (m_pooled) {
+        if (m_pool) {
+            m_pool->release(m_containerName);
+        } else {
+            QProcess::startDetached(m_containerRuntime, QStringList() << "rm" << "-f" << m_containerName);
+        }
+        m_pooled = false;
+        m_containerId.clear();
+        m_containerName.clear();
+        completeCleanupLater();
+        return;
+    }
+    
+    // Removing the container also kills whatever a cancelled step left running in it
+    if (m_engine) {
+        QPointer<ContainerBackend> self(this);
+        m_engine->removeContainer(m_containerName, CLEANUP_TIMEOUT_MS, [self](const QString&) {
+            if (self) {
+                self->discardWorkspace();
+                emit self->cleanupFinished();
+            }
+        });
+        m_containerId.clear();
+        m_containerName.clear();
+        return;
+    }
     
-    QProcess process;
     QStringList args;
-    args << "run" << "-d" << "-it" << image << "sh";
+    args << "rm" << "-f" << m_containerName;
+    m_containerId.clear();
+    m_containerName.clear();
+    
+    runRuntime(args, CLEANUP_TIMEOUT_MS, [this](QProcess&, bool) {
+        discardWorkspace();
+        emit cleanupFinished();
+    });
+}
+
+void ContainerBackend::discardWorkspace() {
+    if (m_workspace) {
+        m_workspace->discard();
+        m_workspace->deleteLater();
+        m_workspace = nullptr;
+    }
+}
+
+void ContainerBackend::cancel() {
+    m_cancelled = true;
+    
+    if (m_committing) {
+        // Neither the engine nor the CLI aborts a commit; commitLayer()
+        // removes the image once it is done
+        m_committing = false;
+        emit error("Step cancelled");
+        completeStepLater(false);
+        return;
+    }
+    
+    if (m_creating) {
+        m_creating = false;
+        emit error("Container creation cancelled");
+        completePreparationLater(false);
+        return;
+    }
+    
+    if (m_shellStarting || (m_shell && m_shell->isBusy())) {
+        discardShellSession();
+        emit error("Step cancelled");
+        completeStepLater(false);
+        return;
+    }
+    
+    // Killing the runtime client fails the step at once; the completion
+    // handler of the killed process reports the failure
+    if (m_activeProcess) {
+        m_activeProcess->kill();
+    }
+}
+
+void ContainerBackend::openShellSession(std::function<void(const QString& errorMessage)> onReady) {
+    if (m_shell) {
+        onReady(QString());
+        return;
+    }
+    
+    if (m_engine) {
+        m_shellStarting = true;
+        QPointer<ContainerBackend> self(this);
+        m_engine->execAttached(m_containerId, QStringList() << "sh", PREPARE_TIMEOUT_MS,
+                               [self, onReady](EngineStream* stream, const QString& errorMessage) {
+            if (!self || !self->m_shellStarting) {
+                delete stream;
+                return;
+            }
+            
+            self->m_shellStarting = false;
+            if (!stream) {
+                onReady(errorMessage);
+                return;
+            }
+            stream->setParent(self.data());
+            self->attachShellSession(stream);
+            connect(stream, &QIODevice::readChannelFinished, self.data(), &ContainerBackend::endShellSession);
+            onReady(QString());
+        });
+        return;
+    }
+    
+    QProcess* process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::MergedChannels);
+    attachShellSession(process);
+    
+    connect(process, &QProcess::finished, this, &ContainerBackend::endShellSession);
+    connect(process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError processError) {
+        // Every other error is followed by finished()
+        if (processError == QProcess::FailedToStart) {
+            endShellSession();
+        }
+    });
+    
+    process->start(m_containerRuntime, QStringList() << "exec" << "-i" << m_containerId << "sh");
+    onReady(QString());
+}
+
+void ContainerBackend::attachShellSession(QIODevice* device) {
+    m_shellDevice = device;
+    m_shell = new ShellSession(device, this);
+    
+    connect(m_shell, &ShellSession::output, this, &ExecutionBackend::output);
+    connect(m_shell, &ShellSession::finished, this, &ContainerBackend::finishShellStep);
+}
+
+void ContainerBackend::endShellSession() {
+    // A session that goes away takes the running step with it
+    bool busy = m_shell && m_shell->isBusy();
+    discardShellSession();
+    if (busy) {
+        emit error("Shell session in container ended unexpectedly");
+        emit stepCompleted(false);
+    }
+}
+
+void ContainerBackend::discardShellSession() {
+    m_stepTimer->stop();
+    m_shellStarting = false;
+    
+    // We may be inside a signal of the device or the session
+    if (m_shell) {
+        m_shell->disconnect(this);
+        m_shell->deleteLater();
+    }
+    if (m_shellDevice) {
+        m_shellDevice->disconnect(this);
+        if (QProcess* process = qobject_cast<QProcess*>(m_shellDevice.data())) {
+            process->kill();
+        } else {
+            m_shellDevice->close();
+        }
+        m_shellDevice->deleteLater();
+    }
+    m_shell = nullptr;
+    m_shellDevice = nullptr;
+}
+
+void ContainerBackend::finishShellStep(int exitCode) {
+    m_stepTimer->stop();
     
-    process.start(m_containerRuntime, args);
+    if (m_cancelled) {
+        emit error("Step cancelled");
+        emit stepCompleted(false);
+        return;
+    }
+    
+    if (exitCode != 0) {
+        m_layerCaching = false;
+        emit error(QString("Step failed with exit code %1").arg(exitCode));
+        emit stepCompleted(false);
+        return;
+    }
+    
+    // What a step exports through GITHUB_ENV lives in the session, not in
+    // the image, so a restored prefix would lose it
+    if (m_shell && m_shell->exportedEnvironment()) {
+        m_layerCaching = false;
+    }
     
-    if (!process.waitForFinished(PREPARE_TIMEOUT_MS)) {
-        emit error("Container creation timeout");
+    m_uncommittedMs += m_stepClock.elapsed();
+    if (shouldCommitLayer()) {
+        commitLayer(m_layerKeys[m_stepIndex - 1]);
+        return;
+    }
+    
+    emit stepCompleted(true);
+}
+
+void ContainerBackend::setLayerCacheBudget(qint64 budgetBytes) {
+    m_layerCacheBudget = budgetBytes;
+}
+
+bool ContainerBackend::dropRestoredLayer() {
+    if (m_restoredSteps == 0 || m_cancelled) {
+        return false;
+    }
+    
+    QString key = m_layerKeys[m_restoredSteps - 1];
+    emit output("Cannot start from cached layer " + core::LayerCache::imageTag(key)
+                + ", starting from " + m_baseImage);
+    m_layerCache.remove(key);
+    m_restoredSteps = 0;
+    
+    removeContainerLater(m_containerName);
+    startContainer(m_baseImage);
+    return true;
+}
+
+bool ContainerBackend::shouldCommitLayer() {
+    if (!m_layerCaching) {
         return false;
     }
     
-    if (process.exitCode() != 0) {
-        QString errorMsg = QString::fromUtf8(process.readAllStandardError());
-        emit error("Failed to create container: " + errorMsg);
+    // Restoring a prefix would lose what its steps wrote to the workspace
+    OverlayWorkspace* workspace = m_pooled && m_pool ? m_pool->workspace(m_containerName) : m_workspace.data();
+    if (workspace && workspace->hasChanges()) {
+        m_layerCaching = false;
         return false;
     }
     
-    m_containerId = QString::fromUtf8(process.readAllStandardOutput()).trimmed();
-    return !m_containerId.isEmpty();
+    // A commit pauses the container and copies its changes
+    if (m_uncommittedMs < MIN_COMMIT_STEP_MS) {
+        return false;
+    }
+    if (m_layerCache.contains(m_layerKeys[m_stepIndex - 1])) {
+        m_uncommittedMs = 0;
+        return false;
+    }
+    return true;
 }
 
-void ContainerBackend::cleanup() {
-    if (!m_containerId.isEmpty()) {
-        QProcess process;
-        QStringList args;
-        args << "rm" << "-f" << m_containerId;
-        
-        process.start(m_containerRuntime, args);
-        process.waitForFinished(CLEANUP_TIMEOUT_MS);
-        
-        m_containerId.clear();
+void ContainerBackend::commitLayer(const QString& key) {
+    QString tag = core::LayerCache::imageTag(key);
+    m_committing = true;
+    
+    // A cancelled commit still tags its image, which would then escape the
+    // layer cache's index and budget
+    QPointer<ContainerBackend> self(this);
+    QPointer<EngineClient> engine = m_engine;
+    QString runtime = m_containerRuntime;
+    auto onCommitted = [self, key, tag, engine, runtime](qint64 sizeBytes, const QString& errorMessage) {
+        if (!self || !self->m_committing) {
+            if (engine) {
+                engine->removeImage(tag, CLEANUP_TIMEOUT_MS);
+            } else {
+                QProcess::startDetached(runtime, QStringList() << "rmi" << tag);
+            }
+            return;
+        }
+        self->m_committing = false;
+        self->finishCommit(key, sizeBytes, errorMessage);
+    };
+    
+    if (m_engine) {
+        m_engine->commitContainer(m_containerId, tag, COMMIT_TIMEOUT_MS, onCommitted);
+        return;
     }
+    
+    // The writable layer is exactly what the commit adds on top of the image
+    QStringList inspectArgs;
+    inspectArgs << "container" << "inspect" << "--size" << "--format" << "{{.SizeRw}}" << m_containerId;
+    runRuntime(inspectArgs, COMMIT_TIMEOUT_MS, [this, tag, onCommitted](QProcess& process, bool finished) {
+        if (!m_committing) {
+            // Cancelled before anything was committed
+            return;
+        }
+        if (!finished || process.exitCode() != 0) {
+            onCommitted(-1, runtimeError(process, finished));
+            return;
+        }
+        qint64 sizeBytes = QString::fromUtf8(process.readAllStandardOutput()).trimmed().toLongLong();
+        
+        m_commitTag = tag;
+        runRuntime(QStringList() << "commit" << m_containerId << tag, COMMIT_TIMEOUT_MS,
+                   [this, onCommitted, sizeBytes](QProcess& commitProcess, bool commitFinished) {
+            m_commitTag.clear();
+            if (!commitFinished || commitProcess.exitCode() != 0) {
+                onCommitted(-1, runtimeError(commitProcess, commitFinished));
+                return;
+            }
+            onCommitted(sizeBytes, QString());
+        });
+    });
 }
 
-bool ContainerBackend::detectRuntime() {
-    // Try docker first
-    QProcess dockerCheck;
-    dockerCheck.start("docker", QStringList() << "--version");
+void ContainerBackend::finishCommit(const QString& key, qint64 sizeBytes, const QString& errorMessage) {
+    // The cache only saves time; the step itself succeeded either way
+    if (!errorMessage.isEmpty()) {
+        m_layerCaching = false;
+        emit output("Could not cache the steps so far: " + errorMessage);
+        emit stepCompleted(true);
+        return;
+    }
     
-    if (dockerCheck.waitForFinished(5000) && dockerCheck.exitCode() == 0) {
-        m_containerRuntime = "docker";
-        return true;
+    m_layerCache.record(key, sizeBytes);
+    m_uncommittedMs = 0;
+    emit output(QString("Cached the steps so far as %1 (%2 MiB)")
+                .arg(core::LayerCache::imageTag(key)).arg(sizeBytes >> 20));
+    
+    for (const QString& evictedKey : m_layerCache.evict(m_layerCacheBudget)) {
+        removeLayer(evictedKey);
     }
     
-    // Try podman
-    QProcess podmanCheck;
-    podmanCheck.start("podman", QStringList() << "--version");
+    emit stepCompleted(true);
+}
+
+void ContainerBackend::removeLayer(const QString& key) {
+    // The index entry goes only with the image; an image still used by a
+    // container stays accounted and is tried again by the next eviction.
+    // Neither callback needs the backend, which may be gone by then.
+    QString image = core::LayerCache::imageTag(key);
+    if (m_engine) {
+        m_engine->removeImage(image, CLEANUP_TIMEOUT_MS, [key](const QString& errorMessage) {
+            if (errorMessage.isEmpty()) {
+                core::LayerCache().remove(key);
+            }
+        });
+        return;
+    }
     
-    if (podmanCheck.waitForFinished(5000) && podmanCheck.exitCode() == 0) {
-        m_containerRuntime = "podman";
-        return true;
+    QProcess* process = new QProcess();
+    connect(process, &QProcess::finished, process, [process, key](int exitCode, QProcess::ExitStatus exitStatus) {
+        // Docker says "No such image", Podman "image not known"
+        QString errorMessage = QString::fromUtf8(process->readAllStandardError());
+        bool gone = errorMessage.contains("No such image") || errorMessage.contains("image not known");
+        if ((exitStatus == QProcess::NormalExit && exitCode == 0) || gone) {
+            core::LayerCache().remove(key);
+        }
+        process->deleteLater();
+    });
+    connect(process, &QProcess::errorOccurred, process, [process](QProcess::ProcessError processError) {
+        // Every other error is followed by finished()
+        if (processError == QProcess::FailedToStart) {
+            process->deleteLater();
+        }
+    });
+    process->start(m_containerRuntime, QStringList() << "rmi" << image);
+}
+
+void ContainerBackend::removeContainerLater(const QString& containerName) {
+    if (m_engine) {
+        m_engine->removeContainer(containerName, CLEANUP_TIMEOUT_MS);
+    } else {
+        QProcess::startDetached(m_containerRuntime, QStringList() << "rm" << "-f" << containerName);
     }
+}
+
+void ContainerBackend::runRuntime(const QStringList& args, int timeoutMs,
+                                  std::function<void(QProcess& process, bool finished)> onFinished) {
+    QProcess* process = new QProcess(this);
+    QTimer* timer = new QTimer(process);
+    timer->setSingleShot(true);
+    
+    auto timedOut = std::make_shared<bool>(false);
+    connect(timer, &QTimer::timeout, process, [process, timedOut]() {
+        *timedOut = true;
+        process->kill();
+    });
+    
+    connect(process, &QProcess::finished, this,
+            [process, timer, timedOut, onFinished](int, QProcess::ExitStatus) {
+        timer->stop();
+        onFinished(*process, !*timedOut);
+        process->deleteLater();
+    });
+    
+    connect(process, &QProcess::errorOccurred, this,
+            [process, onFinished](QProcess::ProcessError processError) {
+        // Every other error is followed by finished(); the caller reports
+        // process->errorString() through runtimeError()
+        if (processError == QProcess::FailedToStart) {
+            onFinished(*process, false);
+            process->deleteLater();
+        }
+    });
     
-    return false;
+    m_activeProcess = process;
+    process->start(m_containerRuntime, args);
+    timer->start(timeoutMs);
 }
 
-QString ContainerBackend::mapRunsOnToImage(const QString& runsOn) const {
+QString ContainerBackend::mapRunsOnToImage(const QString& runsOn) {
     // Map GitHub runner specs to container images
     if (runsOn.contains("ubuntu-latest") || runsOn.contains("ubuntu-22.04")) {
         return "ubuntu:22.04";
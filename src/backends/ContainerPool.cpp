@@ -0,0 +1,247 @@
+#include "backends/ContainerPool.h"
+#include "backends/EngineClient.h"
+#include "backends/OverlayWorkspace.h"
+#include "core/RuntimeCapabilities.h"
+#include <QDateTime>
+#include <QProcess>
+#include <QTimer>
+#include <QUuid>
+#include <memory>
+
+namespace gwt {
+namespace backends {
+
+ContainerPool::ContainerPool(int size, QObject* parent)
+    : QObject(parent)
+    , m_size(qMax(0, size))
+    , m_containerRuntime(core::RuntimeCapabilities::instance().containerRuntime())
+    , m_engine(EngineClient::instance())
+{
+}
+
+ContainerPool::~ContainerPool() {
+    for (const Group& group : m_groups) {
+        for (const QString& containerName : group.idle) {
+            removeContainer(containerName);
+        }
+    }
+
+    // Creations still in flight are killed with their processes; remove
+    // whatever the runtime managed to create anyway
+    for (const QString& containerName : m_starting) {
+        removeContainer(containerName);
+    }
+}
+
+int ContainerPool::size() const {
+    return m_size;
+}
+
+void ContainerPool::warm(const QString& image, const core::ResourceReservation& limits,
+                         const QString& workspace) {
+    if (m_containerRuntime.isEmpty()) {
+        return;
+    }
+
+    QString key = groupKey(image, limits, workspace);
+    Group& group = m_groups[key];
+    group.image = image;
+    group.limits = limits;
+    group.workspace = workspace;
+    if (QDateTime::currentMSecsSinceEpoch() < group.retryAtMs) {
+        return;
+    }
+
+    for (int count = group.idle.size() + group.starting; count < m_size; ++count) {
+        startContainer(key, image, limits, workspace);
+    }
+}
+
+QString ContainerPool::acquire(const QString& image, const core::ResourceReservation& limits,
+                               const QString& workspace) {
+    Group& group = m_groups[groupKey(image, limits, workspace)];
+    QString containerName = group.idle.isEmpty() ? QString() : group.idle.takeFirst();
+
+    warm(image, limits, workspace);
+    return containerName;
+}
+
+void ContainerPool::release(const QString& containerName) {
+    if (!m_engine) {
+        removeContainer(containerName);
+        return;
+    }
+
+    // The overlay is unmounted once the container no longer uses it
+    QPointer<OverlayWorkspace> overlay = m_workspaces.take(containerName);
+    m_engine->removeContainer(containerName, START_TIMEOUT_MS, [overlay](const QString&) {
+        if (overlay) {
+            overlay->discard();
+            overlay->deleteLater();
+        }
+    });
+}
+
+OverlayWorkspace* ContainerPool::workspace(const QString& containerName) const {
+    return m_workspaces.value(containerName);
+}
+
+QStringList ContainerPool::runArguments(const QString& containerName,
+                                        const QString& image,
+                                        const core::ResourceReservation& limits,
+                                        const QString& workspaceDir) {
+    QStringList args;
+    args << "run" << "-d" << "-it" << "--name" << containerName;
+    if (limits.cpus > 0) {
+        args << "--cpus" << QString::number(limits.cpus);
+    }
+    if (limits.memoryBytes > 0) {
+        args << "--memory" << QString::number(limits.memoryBytes);
+    }
+    if (!workspaceDir.isEmpty()) {
+        args << "-v" << workspaceDir + ":" + WORKSPACE_PATH << "-w" << WORKSPACE_PATH
+             << "-e" << QString("GITHUB_WORKSPACE=") + WORKSPACE_PATH;
+    }
+    args << image << "sh";
+    return args;
+}
+
+QString ContainerPool::groupKey(const QString& image, const core::ResourceReservation& limits,
+                                const QString& workspace) {
+    return QStringLiteral("%1|%2|%3|%4").arg(image).arg(limits.cpus).arg(limits.memoryBytes).arg(workspace);
+}
+
+void ContainerPool::startContainer(const QString& key, const QString& image,
+                                   const core::ResourceReservation& limits, const QString& workspace) {
+    QString containerName = "gwt-pool-" + QUuid::createUuid().toString(QUuid::Id128);
+    ++m_groups[key].starting;
+    m_starting << containerName;
+
+    if (workspace.isEmpty()) {
+        runContainer(key, image, limits, containerName, QString());
+        return;
+    }
+
+    // Each container gets its own overlay, mounted before it starts
+    OverlayWorkspace* overlay = new OverlayWorkspace(this);
+    m_workspaces.insert(containerName, overlay);
+    connect(overlay, &OverlayWorkspace::error, this, &ContainerPool::error);
+    connect(overlay, &OverlayWorkspace::mounted, this,
+            [this, key, image, limits, containerName, overlay](bool mounted) {
+        if (!mounted) {
+            // Jobs then mount their own workspaces, or run without one
+            m_starting.removeOne(containerName);
+            --m_groups[key].starting;
+            removeContainer(containerName);
+            retryLater(key, "could not mount the workspace");
+            return;
+        }
+        runContainer(key, image, limits, containerName, overlay->mergedDir());
+    });
+    overlay->mount(workspace);
+}
+
+void ContainerPool::runContainer(const QString& key, const QString& image,
+                                 const core::ResourceReservation& limits,
+                                 const QString& containerName, const QString& workspaceDir) {
+    if (m_engine) {
+        // A container the engine finishes after we are gone is removed right away
+        QPointer<ContainerPool> self(this);
+        QPointer<EngineClient> engine(m_engine);
+        m_engine->runContainer(containerName, image, limits, workspaceDir, START_TIMEOUT_MS,
+                               [self, engine, key, containerName](const QString& containerId,
+                                                                  const QString& errorMessage) {
+            if (!self) {
+                if (engine && !containerId.isEmpty()) {
+                    engine->removeContainer(containerId, START_TIMEOUT_MS);
+                }
+                return;
+            }
+            self->finishStart(key, containerName, errorMessage.isEmpty(), errorMessage);
+        });
+        return;
+    }
+
+    QProcess* process = new QProcess(this);
+    QTimer* timer = new QTimer(process);
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, process, &QProcess::kill);
+
+    auto done = std::make_shared<bool>(false);
+    auto onFinished = [this, process, timer, done, key, containerName](bool started) {
+        if (*done) {
+            return;
+        }
+        *done = true;
+        timer->stop();
+        process->deleteLater();
+        finishStart(key, containerName, started,
+                    process->error() == QProcess::FailedToStart
+                        ? process->errorString()
+                        : QString::fromUtf8(process->readAllStandardError()).trimmed());
+    };
+
+    connect(process, &QProcess::finished, this,
+            [onFinished](int exitCode, QProcess::ExitStatus exitStatus) {
+        onFinished(exitStatus == QProcess::NormalExit && exitCode == 0);
+    });
+    connect(process, &QProcess::errorOccurred, this,
+            [onFinished](QProcess::ProcessError processError) {
+        // Every other error is followed by finished()
+        if (processError == QProcess::FailedToStart) {
+            onFinished(false);
+        }
+    });
+
+    process->start(m_containerRuntime, runArguments(containerName, image, limits, workspaceDir));
+    timer->start(START_TIMEOUT_MS);
+}
+
+void ContainerPool::finishStart(const QString& key, const QString& containerName, bool started,
+                                const QString& errorMessage) {
+    m_starting.removeOne(containerName);
+    Group& group = m_groups[key];
+    --group.starting;
+
+    if (started) {
+        group.idle << containerName;
+        group.failures = 0;
+        return;
+    }
+
+    removeContainer(containerName);
+    retryLater(key, errorMessage);
+}
+
+void ContainerPool::retryLater(const QString& key, const QString& errorMessage) {
+    // A failed start usually fails again, e.g. for an image that cannot be
+    // pulled; jobs start their own containers until the retry, which backs
+    // off while the starts keep failing
+    Group& group = m_groups[key];
+    int delayMs = RETRY_MS << qMin(group.failures, MAX_RETRY_SHIFT);
+    group.failures++;
+    group.retryAtMs = QDateTime::currentMSecsSinceEpoch() + delayMs;
+    emit error(QString("Could not pre-start a container for %1, retrying in %2 s: %3")
+               .arg(group.image).arg(delayMs / 1000).arg(errorMessage));
+    QTimer::singleShot(delayMs, this, [this, key]() {
+        Group group = m_groups.value(key);
+        warm(group.image, group.limits, group.workspace);
+    });
+}
+
+void ContainerPool::removeContainer(const QString& containerName) {
+    QStringList removeArgs = QStringList() << m_containerRuntime << "rm" << "-f" << containerName;
+
+    // The overlay is unmounted once the container no longer uses it
+    OverlayWorkspace* overlay = m_workspaces.take(containerName);
+    if (overlay) {
+        overlay->discard(removeArgs);
+        overlay->deleteLater();
+        return;
+    }
+
+    QProcess::startDetached(removeArgs.takeFirst(), removeArgs);
+}
+
+} // namespace backends
+} // namespace gwt
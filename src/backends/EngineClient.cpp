@@ -0,0 +1,546 @@
+#include "backends/EngineClient.h"
+#include "backends/ContainerPool.h"
+#include "backends/EngineStream.h"
+#include "core/RuntimeCapabilities.h"
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QMetaObject>
+#include <QPointer>
+#include <QTimer>
+#include <QUrl>
+
+namespace gwt {
+namespace backends {
+
+namespace {
+
+QString encode(const QString& value) {
+    return QString::fromUtf8(QUrl::toPercentEncoding(value));
+}
+
+} // namespace
+
+bool EngineReply::isSuccess() const {
+    return status >= 200 && status < 300;
+}
+
+QJsonDocument EngineReply::json() const {
+    return QJsonDocument::fromJson(body);
+}
+
+QString EngineReply::errorMessage() const {
+    if (!transportError.isEmpty()) {
+        return transportError;
+    }
+    QString message = json().object()["message"].toString();
+    return message.isEmpty() ? QString("Engine returned HTTP %1").arg(status) : message;
+}
+
+/**
+ * @brief One keep-alive connection and the response being read on it
+ */
+struct EngineClient::Connection {
+    QLocalSocket* socket = nullptr;
+    QTimer* timer = nullptr;
+    bool reused = false;
+
+    QByteArray request;             // Kept to retry on a fresh connection
+    bool upgrade = false;
+    bool retry = false;
+    int timeoutMs = 0;
+    ResponseHandler onResponse;     // Empty while idle
+
+    QByteArray buffer;
+    bool headersDone = false;
+    int status = 0;
+    qint64 contentLength = -1;
+    bool chunked = false;
+    bool keepAlive = true;
+    QByteArray body;
+
+    void resetResponse() {
+        buffer.clear();
+        headersDone = false;
+        status = 0;
+        contentLength = -1;
+        chunked = false;
+        keepAlive = true;
+        body.clear();
+    }
+};
+
+EngineClient::EngineClient(const QString& socketPath, QObject* parent)
+    : QObject(parent)
+    , m_socketPath(socketPath)
+{
+}
+
+EngineClient::~EngineClient() {
+    // Sockets and timers are children and go with us; pending handlers are
+    // never called
+    qDeleteAll(m_connections);
+}
+
+EngineClient* EngineClient::instance() {
+    static QPointer<EngineClient> client;
+    static bool probed = false;
+    if (!probed) {
+        probed = true;
+        QString socketPath = findSocket(core::RuntimeCapabilities::instance().containerRuntime());
+        if (!socketPath.isEmpty()) {
+            client = new EngineClient(socketPath, QCoreApplication::instance());
+        }
+    }
+    return client;
+}
+
+QString EngineClient::findSocket(const QString& containerRuntime) {
+    const core::RuntimeCapabilities& capabilities = core::RuntimeCapabilities::instance();
+    QString runtimeDir = qEnvironmentVariable("XDG_RUNTIME_DIR");
+    QStringList candidates;
+
+    // An engine reached over the network is left to the CLI
+    QString host = qEnvironmentVariable(containerRuntime == "podman" ? "CONTAINER_HOST" : "DOCKER_HOST");
+    if (!host.isEmpty()) {
+        if (!host.startsWith("unix://")) {
+            return QString();
+        }
+        candidates << host.mid(7);
+    } else if (containerRuntime == "docker") {
+        if (capabilities.docker().rootless && !runtimeDir.isEmpty()) {
+            candidates << runtimeDir + "/docker.sock";
+        }
+        candidates << "/var/run/docker.sock";
+    } else if (containerRuntime == "podman") {
+        if (capabilities.podman().rootless && !runtimeDir.isEmpty()) {
+            candidates << runtimeDir + "/podman/podman.sock";
+        }
+        candidates << "/run/podman/podman.sock";
+    }
+
+    for (const QString& candidate : candidates) {
+        QFileInfo socket(candidate);
+        if (socket.exists() && socket.isWritable()) {
+            return candidate;
+        }
+    }
+    return QString();
+}
+
+QString EngineClient::socketPath() const {
+    return m_socketPath;
+}
+
+void EngineClient::request(const QByteArray& method, const QString& path, const QJsonDocument& body,
+                           int timeoutMs, ReplyHandler onReply) {
+    QByteArray data = body.isNull() ? QByteArray() : body.toJson(QJsonDocument::Compact);
+    QByteArray request = method + ' ' + path.toUtf8() + " HTTP/1.1\r\nHost: localhost\r\n";
+    if (!data.isEmpty()) {
+        request += "Content-Type: application/json\r\n";
+    }
+    request += "Content-Length: " + QByteArray::number(data.size()) + "\r\n\r\n" + data;
+
+    send(request, false, timeoutMs, [onReply](const EngineReply& reply, QLocalSocket*, const QByteArray&) {
+        onReply(reply);
+    });
+}
+
+void EngineClient::runContainer(const QString& containerName, const QString& image,
+                                const core::ResourceReservation& limits, const QString& workspaceDir,
+                                int timeoutMs, StartHandler onStarted) {
+    QJsonObject hostConfig;
+    if (limits.cpus > 0) {
+        hostConfig["NanoCpus"] = static_cast<qint64>(limits.cpus * 1e9);
+    }
+    if (limits.memoryBytes > 0) {
+        hostConfig["Memory"] = limits.memoryBytes;
+    }
+
+    // `run -d -it <image> sh`: an interactive shell keeps the container alive
+    QJsonObject config;
+    config["Image"] = image;
+    config["Cmd"] = QJsonArray{"sh"};
+    config["Tty"] = true;
+    config["OpenStdin"] = true;
+    if (!workspaceDir.isEmpty()) {
+        hostConfig["Binds"] = QJsonArray{workspaceDir + ":" + ContainerPool::WORKSPACE_PATH};
+        config["WorkingDir"] = ContainerPool::WORKSPACE_PATH;
+        config["Env"] = QJsonArray{QString("GITHUB_WORKSPACE=") + ContainerPool::WORKSPACE_PATH};
+    }
+    config["HostConfig"] = hostConfig;
+
+    createContainer(containerName, image, config, timeoutMs, false, onStarted);
+}
+
+void EngineClient::removeContainer(const QString& containerId, int timeoutMs, ErrorHandler onRemoved) {
+    request("DELETE", "/containers/" + encode(containerId) + "?force=true", QJsonDocument(), timeoutMs,
+            [onRemoved](const EngineReply& reply) {
+        if (onRemoved) {
+            // A container that is already gone counts as removed
+            onRemoved(reply.isSuccess() || reply.status == 404 ? QString() : reply.errorMessage());
+        }
+    });
+}
+
+void EngineClient::containerPid(const QString& containerId, int timeoutMs,
+                                std::function<void(qint64 pid, const QString& errorMessage)> onPid) {
+    request("GET", "/containers/" + encode(containerId) + "/json", QJsonDocument(), timeoutMs,
+            [onPid](const EngineReply& reply) {
+        if (!reply.isSuccess()) {
+            onPid(0, reply.errorMessage());
+            return;
+        }
+        onPid(reply.json().object()["State"].toObject()["Pid"].toInteger(), QString());
+    });
+}
+
+void EngineClient::commitContainer(const QString& containerId, const QString& tag, int timeoutMs,
+                                   std::function<void(qint64 sizeBytes, const QString& errorMessage)> onCommitted) {
+    // The writable layer is exactly what the commit adds on top of the image
+    request("GET", "/containers/" + encode(containerId) + "/json?size=true", QJsonDocument(), timeoutMs,
+            [this, containerId, tag, timeoutMs, onCommitted](const EngineReply& reply) {
+        if (!reply.isSuccess()) {
+            onCommitted(-1, reply.errorMessage());
+            return;
+        }
+        qint64 size = reply.json().object()["SizeRw"].toInteger();
+
+        QString repository = tag.section(':', 0, 0);
+        QString path = "/commit?container=" + encode(containerId) + "&repo=" + encode(repository)
+                     + "&tag=" + encode(tag.section(':', 1));
+        request("POST", path, QJsonDocument(), timeoutMs, [size, onCommitted](const EngineReply& commitReply) {
+            if (!commitReply.isSuccess()) {
+                onCommitted(-1, commitReply.errorMessage());
+                return;
+            }
+            onCommitted(size, QString());
+        });
+    });
+}
+
+void EngineClient::removeImage(const QString& image, int timeoutMs, ErrorHandler onRemoved) {
+    request("DELETE", "/images/" + encode(image), QJsonDocument(), timeoutMs,
+            [onRemoved](const EngineReply& reply) {
+        if (onRemoved) {
+            onRemoved(reply.isSuccess() || reply.status == 404 ? QString() : reply.errorMessage());
+        }
+    });
+}
+
+void EngineClient::execAttached(const QString& containerId, const QStringList& command,
+                                int timeoutMs, AttachHandler onAttached) {
+    QJsonObject exec;
+    exec["AttachStdin"] = true;
+    exec["AttachStdout"] = true;
+    exec["AttachStderr"] = true;
+    exec["Tty"] = false;
+    exec["Cmd"] = QJsonArray::fromStringList(command);
+
+    request("POST", "/containers/" + encode(containerId) + "/exec", QJsonDocument(exec), timeoutMs,
+            [this, timeoutMs, onAttached](const EngineReply& reply) {
+        QString execId = reply.json().object()["Id"].toString();
+        if (!reply.isSuccess() || execId.isEmpty()) {
+            onAttached(nullptr, reply.errorMessage());
+            return;
+        }
+
+        // Without a TTY, stdout and stderr come back multiplexed in frames
+        QByteArray data = QJsonDocument(QJsonObject{{"Detach", false}, {"Tty", false}})
+                              .toJson(QJsonDocument::Compact);
+        QByteArray request = "POST /exec/" + execId.toUtf8() + "/start HTTP/1.1\r\nHost: localhost\r\n"
+                             "Content-Type: application/json\r\nConnection: Upgrade\r\nUpgrade: tcp\r\n"
+                             "Content-Length: " + QByteArray::number(data.size()) + "\r\n\r\n" + data;
+
+        send(request, true, timeoutMs,
+             [onAttached](const EngineReply& startReply, QLocalSocket* hijacked, const QByteArray& pending) {
+            if (!hijacked) {
+                onAttached(nullptr, startReply.errorMessage());
+                return;
+            }
+            onAttached(new EngineStream(hijacked, pending), QString());
+        });
+    });
+}
+
+void EngineClient::createContainer(const QString& containerName, const QString& image,
+                                   const QJsonObject& config, int timeoutMs, bool pulled,
+                                   StartHandler onStarted) {
+    request("POST", "/containers/create?name=" + encode(containerName), QJsonDocument(config), timeoutMs,
+            [this, containerName, image, config, timeoutMs, pulled, onStarted](const EngineReply& reply) {
+        // Unlike `run`, create does not pull a missing image
+        if (reply.status == 404 && !pulled) {
+            pullImage(image, [this, containerName, image, config, timeoutMs, onStarted](const QString& pullError) {
+                if (!pullError.isEmpty()) {
+                    onStarted(QString(), pullError);
+                    return;
+                }
+                createContainer(containerName, image, config, timeoutMs, true, onStarted);
+            });
+            return;
+        }
+
+        QString containerId = reply.json().object()["Id"].toString();
+        if (!reply.isSuccess() || containerId.isEmpty()) {
+            onStarted(QString(), reply.errorMessage());
+            return;
+        }
+
+        request("POST", "/containers/" + containerId + "/start", QJsonDocument(), timeoutMs,
+                [containerId, onStarted](const EngineReply& startReply) {
+            if (!startReply.isSuccess() && startReply.status != 304) {
+                onStarted(QString(), startReply.errorMessage());
+                return;
+            }
+            onStarted(containerId, QString());
+        });
+    });
+}
+
+void EngineClient::pullImage(const QString& image, ErrorHandler onPulled) {
+    // Without a tag the engine would pull every tag of the repository
+    QString reference = image;
+    if (!reference.section('/', -1).contains(':') && !reference.contains('@')) {
+        reference += ":latest";
+    }
+
+    request("POST", "/images/create?fromImage=" + encode(reference), QJsonDocument(), PULL_TIMEOUT_MS,
+            [onPulled](const EngineReply& reply) {
+        if (!reply.isSuccess()) {
+            onPulled(reply.errorMessage());
+            return;
+        }
+
+        // The progress stream reports a failed pull as a final error object
+        for (const QByteArray& line : reply.body.split('\n')) {
+            QString error = QJsonDocument::fromJson(line).object()["error"].toString();
+            if (!error.isEmpty()) {
+                onPulled(error);
+                return;
+            }
+        }
+        onPulled(QString());
+    });
+}
+
+void EngineClient::send(const QByteArray& request, bool upgrade, int timeoutMs, ResponseHandler onResponse) {
+    Connection* connection = nullptr;
+    if (!m_idle.isEmpty()) {
+        connection = m_idle.takeLast();
+        connection->reused = true;
+    } else {
+        connection = openConnection();
+    }
+    dispatch(connection, request, upgrade, timeoutMs, connection->reused, onResponse);
+}
+
+void EngineClient::dispatch(Connection* connection, const QByteArray& request, bool upgrade,
+                            int timeoutMs, bool retry, ResponseHandler onResponse) {
+    connection->request = request;
+    connection->upgrade = upgrade;
+    connection->retry = retry;
+    connection->timeoutMs = timeoutMs;
+    connection->onResponse = onResponse;
+    connection->resetResponse();
+    connection->timer->start(timeoutMs);
+
+    // Connecting may fail synchronously, and handlers must run from the event loop
+    QPointer<QLocalSocket> socket = connection->socket;
+    QMetaObject::invokeMethod(this, [this, socket, request]() {
+        if (!socket) {
+            return;
+        }
+        if (socket->state() == QLocalSocket::ConnectedState) {
+            socket->write(request);
+        } else if (socket->state() == QLocalSocket::UnconnectedState) {
+            socket->connectToServer(m_socketPath);
+        }
+    }, Qt::QueuedConnection);
+}
+
+EngineClient::Connection* EngineClient::openConnection() {
+    Connection* connection = new Connection;
+    connection->socket = new QLocalSocket(this);
+    connection->timer = new QTimer(this);
+    connection->timer->setSingleShot(true);
+    m_connections.append(connection);
+
+    connect(connection->socket, &QLocalSocket::connected, this, [connection]() {
+        connection->socket->write(connection->request);
+    });
+    connect(connection->socket, &QLocalSocket::readyRead, this, [this, connection]() {
+        readResponse(connection);
+    });
+    connect(connection->socket, &QLocalSocket::disconnected, this, [this, connection]() {
+        handleBrokenConnection(connection, "Engine closed the connection");
+    });
+    connect(connection->socket, &QLocalSocket::errorOccurred, this,
+            [this, connection](QLocalSocket::LocalSocketError) {
+        // Errors of a connected socket are followed by disconnected()
+        if (connection->socket->state() == QLocalSocket::UnconnectedState) {
+            handleBrokenConnection(connection, "Cannot reach the container engine at " + m_socketPath
+                                               + ": " + connection->socket->errorString());
+        }
+    });
+    connect(connection->timer, &QTimer::timeout, this, [this, connection]() {
+        connection->retry = false;
+        handleBrokenConnection(connection, "Container engine request timed out");
+    });
+
+    return connection;
+}
+
+void EngineClient::readResponse(Connection* connection) {
+    connection->buffer += connection->socket->readAll();
+    if (!connection->onResponse) {
+        // Nothing is expected on an idle connection
+        closeConnection(connection);
+        return;
+    }
+
+    if (!connection->headersDone) {
+        int end = connection->buffer.indexOf("\r\n\r\n");
+        if (end == -1) {
+            return;
+        }
+
+        QList<QByteArray> lines = connection->buffer.left(end).split('\n');
+        connection->status = lines.first().split(' ').value(1).toInt();
+        for (int i = 1; i < lines.size(); ++i) {
+            int colon = lines[i].indexOf(':');
+            QByteArray name = lines[i].left(colon).trimmed().toLower();
+            QByteArray value = lines[i].mid(colon + 1).trimmed().toLower();
+            if (name == "content-length") {
+                connection->contentLength = value.toLongLong();
+            } else if (name == "transfer-encoding") {
+                connection->chunked = value.contains("chunked");
+            } else if (name == "connection") {
+                connection->keepAlive = !value.contains("close");
+            }
+        }
+        connection->buffer.remove(0, end + 4);
+        connection->headersDone = true;
+
+        if (connection->status == 204 || connection->status == 304) {
+            connection->contentLength = 0;
+        }
+    }
+
+    bool hijacked = connection->upgrade && (connection->status == 101 || connection->status == 200);
+    bool complete = hijacked;
+
+    while (!complete && connection->chunked) {
+        QByteArray& buffer = connection->buffer;
+        int lineEnd = buffer.indexOf("\r\n");
+        if (lineEnd == -1) {
+            return;
+        }
+
+        bool ok = false;
+        qint64 size = buffer.left(lineEnd).split(';').first().trimmed().toLongLong(&ok, 16);
+        if (!ok) {
+            connection->keepAlive = false;
+            complete = true;
+        } else if (size == 0) {
+            // The last chunk is followed by optional trailers and a blank line
+            int end = buffer.indexOf("\r\n\r\n", lineEnd);
+            if (end == -1) {
+                return;
+            }
+            buffer.remove(0, end + 4);
+            complete = true;
+        } else if (buffer.size() >= lineEnd + 2 + size + 2) {
+            connection->body += buffer.mid(lineEnd + 2, size);
+            buffer.remove(0, lineEnd + 2 + size + 2);
+        } else {
+            return;
+        }
+    }
+
+    if (!complete) {
+        if (connection->chunked || connection->contentLength < 0
+            || connection->buffer.size() < connection->contentLength) {
+            // Without a length the body ends when the engine closes the connection
+            return;
+        }
+        connection->body = connection->buffer.left(connection->contentLength);
+        connection->buffer.remove(0, connection->contentLength);
+    }
+
+    connection->timer->stop();
+    EngineReply reply;
+    reply.status = connection->status;
+    reply.body = connection->body;
+    ResponseHandler onResponse = std::move(connection->onResponse);
+    connection->onResponse = nullptr;
+
+    if (hijacked) {
+        // The socket now belongs to the stream
+        QLocalSocket* socket = connection->socket;
+        QByteArray pending = connection->buffer;
+        socket->disconnect(this);
+        m_connections.removeOne(connection);
+        connection->timer->deleteLater();
+        delete connection;
+        onResponse(reply, socket, pending);
+        return;
+    }
+
+    // Idle before the handler runs, so a follow-up request reuses it
+    if (connection->keepAlive && connection->buffer.isEmpty() && m_idle.size() < MAX_IDLE_CONNECTIONS) {
+        connection->resetResponse();
+        m_idle.append(connection);
+    } else {
+        closeConnection(connection);
+    }
+    onResponse(reply, nullptr, QByteArray());
+}
+
+void EngineClient::handleBrokenConnection(Connection* connection, const QString& message) {
+    if (!connection->onResponse) {
+        closeConnection(connection);
+        return;
+    }
+
+    ResponseHandler onResponse = std::move(connection->onResponse);
+    connection->onResponse = nullptr;
+    connection->timer->stop();
+
+    // The engine may have closed a kept-alive connection just as we reused it
+    if (connection->retry && connection->status == 0 && connection->buffer.isEmpty()) {
+        QByteArray request = connection->request;
+        bool upgrade = connection->upgrade;
+        int timeoutMs = connection->timeoutMs;
+        closeConnection(connection);
+        dispatch(openConnection(), request, upgrade, timeoutMs, false, onResponse);
+        return;
+    }
+
+    EngineReply reply;
+    if (connection->headersDone && !connection->chunked && connection->contentLength < 0) {
+        reply.status = connection->status;
+        reply.body = connection->buffer;
+    } else {
+        reply.transportError = message;
+    }
+    closeConnection(connection);
+    onResponse(reply, nullptr, QByteArray());
+}
+
+void EngineClient::closeConnection(Connection* connection) {
+    // We may be inside a signal of the socket
+    m_idle.removeOne(connection);
+    m_connections.removeOne(connection);
+    connection->socket->disconnect(this);
+    connection->socket->abort();
+    connection->socket->deleteLater();
+    connection->timer->disconnect(this);
+    connection->timer->stop();
+    connection->timer->deleteLater();
+    delete connection;
+}
+
+} // namespace backends
+} // namespace gwt
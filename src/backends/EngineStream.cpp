@@ -0,0 +1,85 @@
+#include "backends/EngineStream.h"
+#include <QLocalSocket>
+#include <QMetaObject>
+#include <QtEndian>
+#include <cstring>
+
+namespace gwt {
+namespace backends {
+
+EngineStream::EngineStream(QLocalSocket* socket, const QByteArray& pending, QObject* parent)
+    : QIODevice(parent)
+    , m_socket(socket)
+{
+    m_socket->setParent(this);
+    QIODevice::open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+
+    connect(m_socket, &QLocalSocket::readyRead, this, [this]() {
+        unpackFrames(m_socket->readAll());
+    });
+    connect(m_socket, &QLocalSocket::disconnected, this, &QIODevice::readChannelFinished);
+
+    // Output that came with the response headers is announced from the
+    // event loop, once the reader is connected
+    QByteArray received = pending + m_socket->readAll();
+    if (!received.isEmpty()) {
+        QMetaObject::invokeMethod(this, [this, received]() {
+            unpackFrames(received);
+        }, Qt::QueuedConnection);
+    }
+}
+
+EngineStream::~EngineStream() = default;
+
+bool EngineStream::isSequential() const {
+    return true;
+}
+
+qint64 EngineStream::bytesAvailable() const {
+    return m_output.size() + QIODevice::bytesAvailable();
+}
+
+void EngineStream::close() {
+    if (m_socket) {
+        m_socket->disconnect(this);
+        m_socket->abort();
+    }
+    QIODevice::close();
+}
+
+qint64 EngineStream::readData(char* data, qint64 maxSize) {
+    qint64 size = qMin<qint64>(maxSize, m_output.size());
+    std::memcpy(data, m_output.constData(), size);
+    m_output.remove(0, size);
+    return size;
+}
+
+qint64 EngineStream::writeData(const char* data, qint64 maxSize) {
+    if (!m_socket || m_socket->state() != QLocalSocket::ConnectedState) {
+        return -1;
+    }
+    return m_socket->write(data, maxSize);
+}
+
+void EngineStream::unpackFrames(const QByteArray& data) {
+    m_frames += data;
+
+    // Each frame: stream type, three zero bytes, big-endian payload size
+    qsizetype offset = 0;
+    while (m_frames.size() - offset >= FRAME_HEADER_SIZE) {
+        quint32 size = qFromBigEndian<quint32>(m_frames.constData() + offset + 4);
+        if (m_frames.size() - offset - FRAME_HEADER_SIZE < static_cast<qsizetype>(size)) {
+            break;
+        }
+        m_output += m_frames.mid(offset + FRAME_HEADER_SIZE, size);
+        offset += FRAME_HEADER_SIZE + size;
+    }
+    m_frames.remove(0, offset);
+
+    if (!m_output.isEmpty()) {
+        emit readyRead();
+    }
+}
+
+} // namespace backends
+} // namespace gwt
@@ -0,0 +1,65 @@
+#include "backends/ExecutionBackend.h"
+#include <QMetaObject>
+
+namespace gwt {
+namespace backends {
+
+ExecutionBackend::ExecutionBackend(QObject* parent)
+    : QObject(parent)
+    , m_cgroupMonitor(nullptr)
+{
+}
+
+ExecutionBackend::~ExecutionBackend() = default;
+
+void ExecutionBackend::cancel() {
+    // Backends without long-running operations have nothing to abort
+}
+
+void ExecutionBackend::setResourceLimits(const core::ResourceReservation& limits) {
+    m_resourceLimits = limits;
+}
+
+void ExecutionBackend::setWorkspace(const QString& hostPath) {
+    m_workspacePath = hostPath;
+}
+
+void ExecutionBackend::setJob(const core::WorkflowJob& job) {
+    m_job = job;
+}
+
+void ExecutionBackend::setWorkspaceHash(const QString& hash) {
+    m_workspaceHash = hash;
+}
+
+core::ResourceUsage ExecutionBackend::takeResourceUsage() {
+    return m_cgroupMonitor ? m_cgroupMonitor->take() : core::ResourceUsage();
+}
+
+void ExecutionBackend::setCgroup(const QString& cgroupPath) {
+    if (!m_cgroupMonitor) {
+        m_cgroupMonitor = new core::CgroupMonitor(this);
+    }
+    m_cgroupMonitor->start(cgroupPath);
+}
+
+void ExecutionBackend::completePreparationLater(bool success) {
+    QMetaObject::invokeMethod(this, [this, success]() {
+        emit environmentPrepared(success);
+    }, Qt::QueuedConnection);
+}
+
+void ExecutionBackend::completeStepLater(bool success) {
+    QMetaObject::invokeMethod(this, [this, success]() {
+        emit stepCompleted(success);
+    }, Qt::QueuedConnection);
+}
+
+void ExecutionBackend::completeCleanupLater() {
+    QMetaObject::invokeMethod(this, [this]() {
+        emit cleanupFinished();
+    }, Qt::QueuedConnection);
+}
+
+} // namespace backends
+} // namespace gwt
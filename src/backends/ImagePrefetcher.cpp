@@ -0,0 +1,131 @@
+#include "backends/ImagePrefetcher.h"
+#include "core/RuntimeCapabilities.h"
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QTimer>
+#include <memory>
+
+namespace gwt {
+namespace backends {
+
+ImagePrefetcher::ImagePrefetcher(QObject* parent)
+    : QObject(parent)
+    , m_containerRuntime(core::RuntimeCapabilities::instance().containerRuntime())
+{
+}
+
+ImagePrefetcher::~ImagePrefetcher() {
+    // Never block in the destructor; the processes delete themselves once killed
+    for (QProcess* process : findChildren<QProcess*>(Qt::FindDirectChildrenOnly)) {
+        process->disconnect(this);
+        process->setParent(nullptr);
+        if (process->state() == QProcess::NotRunning) {
+            process->deleteLater();
+        } else {
+            connect(process, &QProcess::finished, process, &QObject::deleteLater);
+            process->kill();
+        }
+    }
+}
+
+void ImagePrefetcher::prefetch(const QStringList& images) {
+    if (m_containerRuntime.isEmpty()) {
+        return;
+    }
+
+    for (const QString& image : images) {
+        if (!image.isEmpty() && !m_inFlight.contains(image)) {
+            m_inFlight.insert(image);
+            fetch(image);
+        }
+    }
+}
+
+bool ImagePrefetcher::isBusy() const {
+    return !m_inFlight.isEmpty();
+}
+
+void ImagePrefetcher::fetch(const QString& image) {
+    // Like `run`, only pull what is missing; a pull of a present image would
+    // still ask the registry for the manifest
+    runRuntime(QStringList() << "image" << "inspect" << "--format" << "{{.Id}}" << image,
+               INSPECT_TIMEOUT_MS, [this, image](bool present) {
+        if (present) {
+            m_inFlight.remove(image);
+            emit imageReady(image, true);
+            return;
+        }
+        pull(image);
+    });
+}
+
+void ImagePrefetcher::pull(const QString& image) {
+    emit progress(image, "Pulling");
+
+    auto timer = std::make_shared<QElapsedTimer>();
+    timer->start();
+
+    QProcess* process = runRuntime(QStringList() << "pull" << image, PULL_TIMEOUT_MS,
+                                   [this, image, timer](bool success) {
+        m_inFlight.remove(image);
+        m_partialLines.remove(image);
+        emit progress(image, success
+            ? QStringLiteral("Pulled in %1 s").arg(timer->elapsed() / 1000.0, 0, 'f', 1)
+            : QStringLiteral("Pull failed"));
+        emit imageReady(image, success);
+    });
+
+    // Without a terminal the runtime prints one line per layer state change
+    process->setProcessChannelMode(QProcess::MergedChannels);
+    connect(process, &QProcess::readyRead, this, [this, process, image]() {
+        QByteArray& partial = m_partialLines[image];
+        partial += process->readAll();
+
+        int end;
+        while ((end = partial.indexOf('\n')) != -1) {
+            QString line = QString::fromUtf8(partial.left(end)).trimmed();
+            partial.remove(0, end + 1);
+            if (!line.isEmpty()) {
+                emit progress(image, line);
+            }
+        }
+    });
+}
+
+QProcess* ImagePrefetcher::runRuntime(const QStringList& args, int timeoutMs,
+                                      std::function<void(bool success)> onFinished) {
+    QProcess* process = new QProcess(this);
+    QTimer* timer = new QTimer(process);
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, process, &QProcess::kill);
+
+    auto done = std::make_shared<bool>(false);
+    auto finish = [process, timer, done, onFinished](bool success) {
+        if (*done) {
+            return;
+        }
+        *done = true;
+        timer->stop();
+        process->deleteLater();
+        onFinished(success);
+    };
+
+    connect(process, &QProcess::finished, this,
+            [finish](int exitCode, QProcess::ExitStatus exitStatus) {
+        finish(exitStatus == QProcess::NormalExit && exitCode == 0);
+    });
+    connect(process, &QProcess::errorOccurred, this,
+            [finish](QProcess::ProcessError processError) {
+        // Every other error is followed by finished()
+        if (processError == QProcess::FailedToStart) {
+            finish(false);
+        }
+    });
+
+    process->start(m_containerRuntime, args);
+    timer->start(timeoutMs);
+    return process;
+}
+
+} // namespace backends
+} // namespace gwt
@@ -0,0 +1,415 @@
+#include "backends/NamespaceBackend.h"
+#include "backends/ContainerBackend.h"
+#include "backends/ContainerPool.h"
+#include "backends/ShellSession.h"
+#include "core/RuntimeCapabilities.h"
+#include "core/StorageProvider.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QRegularExpression>
+#include <QTimer>
+#include <QUuid>
+#include <memory>
+
+namespace gwt {
+namespace backends {
+
+namespace {
+
+// Exports the image's filesystem through a stopped container. The root
+// filesystem only appears under its final name once complete, so a
+// concurrent unpack of the same image simply loses the rename.
+const char* UNPACK_SCRIPT = R"(set -e
+runtime=$1 image=$2 target=$3
+tmp="$target.partial.$$"
+id=
+trap 'chmod -R u+rwX "$tmp" 2>/dev/null; rm -rf "$tmp" "$tmp.tar"; [ -z "$id" ] || "$runtime" rm -f "$id" >/dev/null 2>&1' EXIT
+mkdir -p "$tmp"
+id=$("$runtime" create "$image")
+"$runtime" export -o "$tmp.tar" "$id"
+tar -xf "$tmp.tar" -C "$tmp" --exclude='dev/*'
+[ -e "$tmp/bin/sh" ] || [ -L "$tmp/bin/sh" ] || { echo "$image has no /bin/sh" >&2; exit 1; }
+mv -T "$tmp" "$target" 2>/dev/null || [ -d "$target" ]
+)";
+
+// Runs as root of the new user namespace, so the mounts below need no
+// privileges on the host and vanish with the namespace
+const char* START_SCRIPT = R"(set -e
+job=$1 lower=$2 repo=$3 token=$4
+root="$job/merged"
+mount -t overlay overlay -o "lowerdir=$lower,upperdir=$job/upper,workdir=$job/work" "$root"
+mount -t proc proc "$root/proc"
+mount --rbind /dev "$root/dev"
+mkdir -p "$root/github/workspace"
+if [ -n "$repo" ]; then
+    mount -t overlay overlay -o "lowerdir=$repo,upperdir=$job/workspace/upper,workdir=$job/workspace/work" "$root/github/workspace"
+fi
+rm -f "$root/etc/resolv.conf"
+cat /etc/resolv.conf > "$root/etc/resolv.conf" 2>/dev/null || true
+echo "$token"
+exec env -i PATH=/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin HOME=/root \
+    GITHUB_WORKSPACE=/github/workspace chroot "$root" /bin/sh -c 'cd /github/workspace && exec /bin/sh'
+)";
+
+} // namespace
+
+NamespaceBackend::NamespaceBackend(QObject* parent)
+    : ExecutionBackend(parent)
+    , m_stepTimer(new QTimer(this))
+    , m_startTimer(new QTimer(this))
+    , m_scoped(false)
+    , m_cancelled(false)
+{
+    m_stepTimer->setSingleShot(true);
+    connect(m_stepTimer, &QTimer::timeout, this, [this]() {
+        discardShellSession();
+        emit error("Step execution timeout");
+        emit stepCompleted(false);
+    });
+
+    m_startTimer->setSingleShot(true);
+    connect(m_startTimer, &QTimer::timeout, this, [this]() {
+        discardShellSession();
+        emit error("Entering the namespaces timed out");
+        emit environmentPrepared(false);
+    });
+}
+
+NamespaceBackend::~NamespaceBackend() {
+    // Killing the namespace's first process unmounts everything in it
+    discardShellSession();
+    removeJobDir();
+}
+
+void NamespaceBackend::executeStep(const core::WorkflowStep& step,
+                                   const QVariantMap& context) {
+    if (!m_shell) {
+        emit error("Environment not prepared");
+        completeStepLater(false);
+        return;
+    }
+
+    if (!step.run.isEmpty()) {
+        QString shell = step.shell.isEmpty() ? "sh" : step.shell;
+        if (shell == "/bin/bash") {
+            shell = "bash";
+        } else if (shell == "/bin/sh") {
+            shell = "sh";
+        }
+
+        m_stepTimer->start(STEP_TIMEOUT_MS);
+        m_shell->run(shell, step.run, context.value("workingDirectory").toString());
+        return;
+    }
+
+    if (!step.uses.isEmpty()) {
+        emit output("Action execution: " + step.uses + " (stub)");
+    }
+
+    completeStepLater(true);
+}
+
+void NamespaceBackend::prepareEnvironment(const QString& runsOn) {
+    if (!core::RuntimeCapabilities::instance().hasUserNamespaces()) {
+        emit error("Unprivileged user namespaces with overlay mounts are not available on this host");
+        completePreparationLater(false);
+        return;
+    }
+
+    QString image = ContainerBackend::mapRunsOnToImage(runsOn);
+    unpackRootfs(image, [this, image](const QString& errorMessage) {
+        if (m_cancelled) {
+            emit error("Environment preparation cancelled");
+            emit environmentPrepared(false);
+            return;
+        }
+        if (!errorMessage.isEmpty()) {
+            emit error("Could not unpack the root filesystem of " + image + ": " + errorMessage);
+            emit environmentPrepared(false);
+            return;
+        }
+        startShell(rootfsDir(image));
+    });
+}
+
+void NamespaceBackend::unpackRootfs(const QString& image,
+                                    std::function<void(const QString& errorMessage)> onUnpacked) {
+    QString target = rootfsDir(image);
+    QString runtime = core::RuntimeCapabilities::instance().containerRuntime();
+
+    auto completeLater = [this, onUnpacked](const QString& errorMessage) {
+        QMetaObject::invokeMethod(this, [onUnpacked, errorMessage]() {
+            onUnpacked(errorMessage);
+        }, Qt::QueuedConnection);
+    };
+
+    if (QFileInfo(target).isDir()) {
+        completeLater(QString());
+        return;
+    }
+    if (runtime.isEmpty()) {
+        completeLater("Docker or Podman is needed once to unpack the runner image");
+        return;
+    }
+
+    emit output("Unpacking " + image + " to " + target);
+
+    QProcess* process = new QProcess(this);
+    QTimer* timer = new QTimer(process);
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, process, &QProcess::kill);
+
+    auto done = std::make_shared<bool>(false);
+    auto onFinished = [this, process, timer, done, onUnpacked](bool success) {
+        if (*done) {
+            return;
+        }
+        *done = true;
+        bool timedOut = !timer->isActive();
+        timer->stop();
+        process->deleteLater();
+        m_unpackProcess = nullptr;
+
+        if (success) {
+            onUnpacked(QString());
+        } else if (timedOut) {
+            onUnpacked("Timed out");
+        } else {
+            QString message = QString::fromUtf8(process->readAllStandardError()).trimmed();
+            onUnpacked(message.isEmpty() ? process->errorString() : message);
+        }
+    };
+
+    connect(process, &QProcess::finished, this,
+            [onFinished](int exitCode, QProcess::ExitStatus exitStatus) {
+        onFinished(exitStatus == QProcess::NormalExit && exitCode == 0);
+    });
+    connect(process, &QProcess::errorOccurred, this,
+            [onFinished](QProcess::ProcessError processError) {
+        // Every other error is followed by finished()
+        if (processError == QProcess::FailedToStart) {
+            onFinished(false);
+        }
+    });
+
+    m_unpackProcess = process;
+    timer->start(UNPACK_TIMEOUT_MS);
+    process->start("sh", QStringList() << "-c" << UNPACK_SCRIPT << "sh" << runtime << image << target);
+}
+
+void NamespaceBackend::startShell(const QString& rootfs) {
+    QString workspace;
+    if (!m_workspacePath.isEmpty()) {
+        // Overlay options are separated by commas and layers by colons
+        workspace = QFileInfo(m_workspacePath).canonicalFilePath();
+        if (workspace.isEmpty() || workspace.contains(',') || workspace.contains(':')) {
+            emit error("Running without the repository in " + QString(ContainerPool::WORKSPACE_PATH));
+            workspace.clear();
+        }
+    }
+
+    m_jobDir = core::StorageProvider::instance().getCacheRoot()
+             + "/namespaces/" + QUuid::createUuid().toString(QUuid::Id128);
+    QDir dir;
+    QStringList layers = QStringList() << "upper" << "work" << "merged";
+    if (!workspace.isEmpty()) {
+        layers << "workspace/upper" << "workspace/work";
+    }
+    for (const QString& layer : layers) {
+        if (!dir.mkpath(m_jobDir + "/" + layer)) {
+            emit error("Could not create the overlay layers in " + m_jobDir);
+            emit environmentPrepared(false);
+            return;
+        }
+    }
+
+    m_readyToken = QUuid::createUuid().toString(QUuid::Id128);
+    m_startOutput.clear();
+
+    QProcess* process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::MergedChannels);
+    m_shellProcess = process;
+
+    connect(process, &QIODevice::readyRead, this, &NamespaceBackend::readStartOutput);
+    connect(process, &QProcess::finished, this, &NamespaceBackend::endShellSession);
+    connect(process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError processError) {
+        // Every other error is followed by finished()
+        if (processError == QProcess::FailedToStart) {
+            endShellSession();
+        }
+    });
+
+    // --kill-child takes the whole namespace down with unshare itself
+    QStringList args;
+    args << "unshare" << "--user" << "--map-root-user" << "--mount" << "--pid" << "--fork" << "--kill-child"
+         << "sh" << "-c" << START_SCRIPT << "sh" << m_jobDir << rootfs << workspace << m_readyToken;
+
+    // A transient scope of the user's systemd gives the job its own cgroup,
+    // which enforces the limits and accounts its usage; systemd-run then
+    // execs unshare in place
+    m_scoped = core::RuntimeCapabilities::instance().hasUserScopes();
+    if (m_scoped) {
+        QStringList scope;
+        scope << "--user" << "--scope" << "--quiet" << "--collect";
+        if (m_resourceLimits.cpus > 0) {
+            scope << "-p" << QString("CPUQuota=%1%").arg(qRound(m_resourceLimits.cpus * 100));
+        }
+        if (m_resourceLimits.memoryBytes > 0) {
+            scope << "-p" << QString("MemoryMax=%1").arg(m_resourceLimits.memoryBytes);
+        }
+        args = scope << "--" << args;
+    }
+
+    QString program = m_scoped ? QString("systemd-run") : args.takeFirst();
+    m_startTimer->start(START_TIMEOUT_MS);
+    process->start(program, args);
+}
+
+void NamespaceBackend::readStartOutput() {
+    m_startOutput += m_shellProcess->readAll();
+    if (!m_startOutput.contains(m_readyToken.toUtf8() + '\n')) {
+        return;
+    }
+
+    // Everything from here on is output of the steps
+    disconnect(m_shellProcess, &QIODevice::readyRead, this, &NamespaceBackend::readStartOutput);
+    m_startTimer->stop();
+    m_startOutput.clear();
+
+    if (m_scoped) {
+        QString cgroup = core::CgroupMonitor::cgroupOfProcess(m_shellProcess->processId());
+        if (!cgroup.isEmpty()) {
+            setCgroup(cgroup);
+        }
+    }
+
+    m_shell = new ShellSession(m_shellProcess, this);
+    connect(m_shell, &ShellSession::output, this, &ExecutionBackend::output);
+    connect(m_shell, &ShellSession::finished, this, &NamespaceBackend::finishShellStep);
+    emit environmentPrepared(true);
+}
+
+void NamespaceBackend::cleanup() {
+    QProcess* process = m_shellProcess;
+    bool running = process && process->state() != QProcess::NotRunning;
+    discardShellSession();
+
+    if (!running) {
+        removeJobDir();
+        completeCleanupLater();
+        return;
+    }
+
+    // The overlays are gone once the last process of the namespace is
+    connect(process, &QProcess::finished, this, [this]() {
+        removeJobDir();
+        emit cleanupFinished();
+    });
+}
+
+void NamespaceBackend::cancel() {
+    m_cancelled = true;
+
+    // The unpack's completion handler reports the cancellation
+    if (m_unpackProcess) {
+        m_unpackProcess->kill();
+        return;
+    }
+
+    if (m_startTimer->isActive()) {
+        discardShellSession();
+        emit error("Environment preparation cancelled");
+        completePreparationLater(false);
+        return;
+    }
+
+    if (m_shell && m_shell->isBusy()) {
+        discardShellSession();
+        emit error("Step cancelled");
+        completeStepLater(false);
+    }
+}
+
+QString NamespaceBackend::rootfsDir(const QString& image) {
+    QString name = image;
+    name.replace(QRegularExpression("[^A-Za-z0-9._-]"), "_");
+    return core::StorageProvider::instance().getCacheRoot() + "/rootfs/" + name;
+}
+
+void NamespaceBackend::endShellSession() {
+    if (m_startTimer->isActive()) {
+        if (m_shellProcess) {
+            m_startOutput += m_shellProcess->readAll();
+        }
+        QString message = QString::fromUtf8(m_startOutput).trimmed();
+        discardShellSession();
+        emit error("Could not enter the namespaces: "
+                   + (message.isEmpty() ? QString("unshare failed to start") : message));
+        emit environmentPrepared(false);
+        return;
+    }
+
+    // A session that goes away takes the running step with it
+    bool busy = m_shell && m_shell->isBusy();
+    discardShellSession();
+    if (busy) {
+        emit error("Shell session in namespace ended unexpectedly");
+        emit stepCompleted(false);
+    }
+}
+
+void NamespaceBackend::discardShellSession() {
+    m_stepTimer->stop();
+    m_startTimer->stop();
+
+    // We may be inside a signal of the process or the session
+    if (m_shell) {
+        m_shell->disconnect(this);
+        m_shell->deleteLater();
+    }
+    if (m_shellProcess) {
+        m_shellProcess->disconnect(this);
+        if (m_shellProcess->state() == QProcess::NotRunning) {
+            m_shellProcess->deleteLater();
+        } else {
+            connect(m_shellProcess, &QProcess::finished, m_shellProcess, &QObject::deleteLater);
+            m_shellProcess->kill();
+        }
+    }
+    m_shell = nullptr;
+    m_shellProcess = nullptr;
+}
+
+void NamespaceBackend::finishShellStep(int exitCode) {
+    m_stepTimer->stop();
+
+    if (m_cancelled) {
+        emit error("Step cancelled");
+        emit stepCompleted(false);
+        return;
+    }
+
+    if (exitCode != 0) {
+        emit error(QString("Step failed with exit code %1").arg(exitCode));
+        emit stepCompleted(false);
+        return;
+    }
+
+    emit stepCompleted(true);
+}
+
+void NamespaceBackend::removeJobDir() {
+    if (m_jobDir.isEmpty()) {
+        return;
+    }
+
+    // The overlay's work directory and whatever the job made read-only
+    // would stop a plain rm
+    QProcess::startDetached("sh", QStringList() << "-c"
+                            << "chmod -R u+rwX \"$1\" 2>/dev/null; rm -rf \"$1\"" << "sh" << m_jobDir);
+    m_jobDir.clear();
+}
+
+} // namespace backends
+} // namespace gwt
@@ -0,0 +1,188 @@
+#include "backends/OverlayWorkspace.h"
+#include "backends/ShellSession.h"
+#include "core/RuntimeCapabilities.h"
+#include "core/StorageProvider.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QUuid>
+#include <memory>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+namespace gwt {
+namespace backends {
+
+OverlayWorkspace::OverlayWorkspace(QObject* parent)
+    : QObject(parent)
+    , m_mounted(false)
+{
+}
+
+OverlayWorkspace::~OverlayWorkspace() {
+    discard();
+}
+
+void OverlayWorkspace::mount(const QString& lowerDir) {
+#ifndef Q_OS_UNIX
+    Q_UNUSED(lowerDir);
+    failLater("Copy-on-write workspaces need Linux");
+#else
+    QFileInfo lower(lowerDir);
+    if (!lower.isDir()) {
+        failLater("Workspace directory does not exist: " + lowerDir);
+        return;
+    }
+
+    // Overlay options are separated by commas and layers by colons
+    QString lowerPath = lower.canonicalFilePath();
+    if (lowerPath.contains(',') || lowerPath.contains(':')) {
+        failLater("Workspace directory cannot be an overlay layer: " + lowerPath);
+        return;
+    }
+
+    m_root = core::StorageProvider::instance().getCacheRoot()
+           + "/workspaces/" + QUuid::createUuid().toString(QUuid::Id128);
+    QDir root;
+    if (!root.mkpath(m_root + "/upper") || !root.mkpath(m_root + "/work")
+        || !root.mkpath(m_root + "/merged")) {
+        failLater("Could not create the workspace layers in " + m_root);
+        return;
+    }
+
+    QString options = QString("lowerdir=%1,upperdir=%2/upper,workdir=%2/work").arg(lowerPath, m_root);
+    QString mergedPath = mergedDir();
+    QString program;
+    QStringList args;
+
+    if (geteuid() == 0) {
+        program = "mount";
+        args << "-t" << "overlay" << "overlay" << "-o" << options << mergedPath;
+        m_unmountCommand = QStringList() << "umount" << mergedPath;
+    } else {
+        const core::RuntimeCapabilities& capabilities = core::RuntimeCapabilities::instance();
+        if (!capabilities.fuseOverlayfs().available) {
+            failLater("fuse-overlayfs is not installed");
+            return;
+        }
+
+        // A runtime daemon running as root can only enter the mount with
+        // allow_other, which needs user_allow_other in /etc/fuse.conf
+        core::ToolInfo runtime = capabilities.containerRuntime() == "podman"
+            ? capabilities.podman() : capabilities.docker();
+        if (!runtime.rootless) {
+            options += ",allow_other";
+        }
+
+        program = "fuse-overlayfs";
+        args << "-o" << options << mergedPath;
+
+        QString fusermount = QStandardPaths::findExecutable("fusermount3");
+        m_unmountCommand = QStringList() << (fusermount.isEmpty() ? QString("fusermount") : fusermount)
+                                         << "-u" << mergedPath;
+    }
+
+    QProcess* process = new QProcess(this);
+    QTimer* timer = new QTimer(process);
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, process, &QProcess::kill);
+
+    auto done = std::make_shared<bool>(false);
+    auto onFinished = [this, process, timer, done, program](bool success) {
+        if (*done) {
+            return;
+        }
+        *done = true;
+        timer->stop();
+        process->deleteLater();
+
+        if (!success) {
+            emit error("Could not mount the workspace with " + program + ": "
+                       + QString::fromUtf8(process->readAllStandardError()).trimmed());
+            discard();
+            emit mounted(false);
+            return;
+        }
+
+        m_mounted = true;
+        emit mounted(true);
+    };
+
+    connect(process, &QProcess::finished, this,
+            [onFinished](int exitCode, QProcess::ExitStatus exitStatus) {
+        onFinished(exitStatus == QProcess::NormalExit && exitCode == 0);
+    });
+    connect(process, &QProcess::errorOccurred, this,
+            [onFinished](QProcess::ProcessError processError) {
+        // Every other error is followed by finished()
+        if (processError == QProcess::FailedToStart) {
+            onFinished(false);
+        }
+    });
+
+    process->start(program, args);
+    timer->start(MOUNT_TIMEOUT_MS);
+#endif
+}
+
+QString OverlayWorkspace::mergedDir() const {
+    return m_root.isEmpty() ? QString() : m_root + "/merged";
+}
+
+bool OverlayWorkspace::isMounted() const {
+    return m_mounted;
+}
+
+bool OverlayWorkspace::hasChanges() const {
+    return m_mounted && !QDir(m_root + "/upper").isEmpty();
+}
+
+void OverlayWorkspace::discard(const QStringList& removeFirst) {
+    if (m_root.isEmpty()) {
+        if (!removeFirst.isEmpty()) {
+            QProcess::startDetached(removeFirst.first(), removeFirst.mid(1));
+        }
+        return;
+    }
+
+    // The upper layer of a large build can take a while to delete. Never
+    // delete while still mounted: that would recurse into the overlay.
+    QStringList commands;
+    if (!removeFirst.isEmpty()) {
+        commands << "\"$@\" >/dev/null 2>&1;";
+    }
+    if (m_mounted) {
+        QStringList unmount;
+        for (const QString& word : m_unmountCommand) {
+            unmount << ShellSession::quote(word);
+        }
+        commands << unmount.join(' ') << "&&";
+    }
+    commands << "rm -rf" << ShellSession::quote(m_root);
+
+    QProcess::startDetached("sh", QStringList() << "-c" << commands.join(' ') << "sh" << removeFirst);
+
+    m_root.clear();
+    m_unmountCommand.clear();
+    m_mounted = false;
+}
+
+void OverlayWorkspace::failLater(const QString& message) {
+    if (!m_root.isEmpty()) {
+        QDir(m_root).removeRecursively();
+        m_root.clear();
+    }
+
+    QMetaObject::invokeMethod(this, [this, message]() {
+        emit error(message);
+        emit mounted(false);
+    }, Qt::QueuedConnection);
+}
+
+} // namespace backends
+} // namespace gwt
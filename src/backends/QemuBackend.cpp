@@ -1,70 +1,160 @@
 #include "backends/QemuBackend.h"
-#include <QProcess>
+#include "backends/ShellSession.h"
+#include "backends/VmPool.h"
+#include "core/RuntimeCapabilities.h"
+#include "core/StorageProvider.h"
 #include <QDateTime>
-#include <QDebug>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QUuid>
+#include <cmath>
 
 namespace gwt {
 namespace backends {
 
+namespace {
+
+// Written to the agent shell of each job's guest. A restored guest still has
+// the clock and random pool of the moment it was saved, so both are
+// refreshed. The repository arrives as a read-only 9p share; an overlay with
+// a tmpfs upper layer makes it writable without the guest's changes reaching
+// the host. %1 is the host's time, %2 random bytes, %3 the ready token.
+const char* GUEST_SETUP = R"(date -s @%1 >/dev/null 2>&1
+echo %2 > /dev/urandom
+mkdir -p /github/workspace /run/gwt/lower /run/gwt/rw
+if ! mountpoint -q /github/workspace; then
+    { mount -t 9p -o trans=virtio,version=9p2000.L,ro gwt-workspace /run/gwt/lower &&
+      mount -t tmpfs tmpfs /run/gwt/rw && mkdir -p /run/gwt/rw/upper /run/gwt/rw/work &&
+      mount -t overlay overlay -o lowerdir=/run/gwt/lower,upperdir=/run/gwt/rw/upper,workdir=/run/gwt/rw/work /github/workspace
+    } 2>/dev/null || echo "Running without the repository in /github/workspace"
+fi
+export HOME=/root GITHUB_WORKSPACE=/github/workspace
+cd /github/workspace
+echo %3
+)";
+
+} // namespace
+
 QemuBackend::QemuBackend(QObject* parent)
+    : QemuBackend(nullptr, parent)
+{
+}
+
+QemuBackend::QemuBackend(VmPool* pool, QObject* parent)
     : ExecutionBackend(parent)
+    , m_pool(pool)
+    , m_stepTimer(new QTimer(this))
+    , m_setupTimer(new QTimer(this))
+    , m_pooled(false)
+    , m_scoped(false)
+    , m_cancelled(false)
 {
     detectQemu();
+
+    m_stepTimer->setSingleShot(true);
+    connect(m_stepTimer, &QTimer::timeout, this, [this]() {
+        stopVM();
+        emit error("Step execution timeout");
+        emit stepCompleted(false);
+    });
+
+    m_setupTimer->setSingleShot(true);
+    connect(m_setupTimer, &QTimer::timeout, this, [this]() {
+        stopVM();
+        emit error("Setting up the guest timed out");
+        emit environmentPrepared(false);
+    });
 }
 
 QemuBackend::~QemuBackend() {
-    cleanup();
+    stopVM();
 }
 
-bool QemuBackend::executeStep(const core::WorkflowStep& step,
+void QemuBackend::executeStep(const core::WorkflowStep& step,
                               const QVariantMap& context) {
-    if (m_vmId.isEmpty()) {
+    if (!m_shell) {
         emit error("VM not prepared");
-        return false;
+        completeStepLater(false);
+        return;
     }
-    
-    // Execute command in VM via SSH or QEMU guest agent
+
     if (!step.run.isEmpty()) {
-        // Stub implementation - would need VM communication setup
-        emit output("Executing in VM: " + step.run);
-        // Would use QEMU monitor or SSH to execute
-    } else if (!step.uses.isEmpty()) {
+        QString shell = step.shell.isEmpty() ? "sh" : step.shell;
+        if (shell == "/bin/bash") {
+            shell = "bash";
+        } else if (shell == "/bin/sh") {
+            shell = "sh";
+        }
+
+        m_stepTimer->start(STEP_TIMEOUT_MS);
+        m_shell->run(shell, step.run, context.value("workingDirectory").toString());
+        return;
+    }
+
+    if (!step.uses.isEmpty()) {
         emit output("Action execution in VM: " + step.uses + " (stub)");
     }
-    
-    return true;
+
+    completeStepLater(true);
 }
 
-bool QemuBackend::prepareEnvironment(const QString& runsOn) {
-    QString vmImage = mapRunsOnToVMImage(runsOn);
-    
-    if (!startVM(vmImage)) {
-        emit error("Failed to start VM");
-        return false;
+void QemuBackend::prepareEnvironment(const QString& runsOn) {
+    if (m_qemuPath.isEmpty()) {
+        emit error("QEMU not found");
+        completePreparationLater(false);
+        return;
+    }
+
+    VirtualMachine::Config config = guestConfig(runsOn, m_resourceLimits, m_workspacePath);
+    if (!QFileInfo(config.backingDisk).isFile()) {
+        emit error("VM image not found: " + config.backingDisk);
+        completePreparationLater(false);
+        return;
     }
-    
-    return true;
+
+    startVM(config);
 }
 
 void QemuBackend::cleanup() {
+    // The VM removes its overlay without waiting for QEMU to exit
     stopVM();
+    completeCleanupLater();
+}
+
+void QemuBackend::cancel() {
+    m_cancelled = true;
+
+    if (m_vm && !m_shell) {
+        stopVM();
+        emit error("Environment preparation cancelled");
+        completePreparationLater(false);
+        return;
+    }
+
+    if (m_shell && m_shell->isBusy()) {
+        stopVM();
+        emit error("Step cancelled");
+        completeStepLater(false);
+    }
+}
+
+QString QemuBackend::imageDirectory() {
+    return core::StorageProvider::instance().getCacheRoot() + "/vm-images";
 }
 
 bool QemuBackend::detectQemu() {
-    QProcess qemuCheck;
-    qemuCheck.start("qemu-system-x86_64", QStringList() << "--version");
-    
-    if (qemuCheck.waitForFinished(5000) && qemuCheck.exitCode() == 0) {
+    if (core::RuntimeCapabilities::instance().qemu().available) {
         m_qemuPath = "qemu-system-x86_64";
         return true;
     }
-    
+
     return false;
 }
 
-QString QemuBackend::mapRunsOnToVMImage(const QString& runsOn) const {
-    // Map GitHub runner specs to VM images
-    // These would be pre-built VM images stored locally
+QString QemuBackend::mapRunsOnToVMImage(const QString& runsOn) {
+    // Map GitHub runner specs to base images in imageDirectory()
     if (runsOn.contains("ubuntu-latest") || runsOn.contains("ubuntu-22.04")) {
         return "ubuntu-22.04.qcow2";
     } else if (runsOn.contains("ubuntu-20.04")) {
@@ -72,29 +162,181 @@ QString QemuBackend::mapRunsOnToVMImage(const QString& runsOn) const {
     } else if (runsOn.contains("windows-latest")) {
         return "windows-2022.qcow2";
     }
-    
+
     return "ubuntu-22.04.qcow2";
 }
 
-bool QemuBackend::startVM(const QString& imagePath) {
-    // Stub implementation - would need proper VM startup with networking
-    m_vmId = "vm-" + QString::number(QDateTime::currentSecsSinceEpoch());
-    
-    // Would execute something like:
-    // qemu-system-x86_64 -m 2048 -smp 2 -hda imagePath -net user -net nic
-    
-    emit output("Starting QEMU VM with image: " + imagePath);
-    
-    // For now, just simulate
-    return true;
+VirtualMachine::Config QemuBackend::guestConfig(const QString& runsOn,
+                                                const core::ResourceReservation& limits,
+                                                const QString& workspace) {
+    VirtualMachine::Config config;
+    config.backingDisk = imageDirectory() + "/" + mapRunsOnToVMImage(runsOn);
+    config.fromSnapshot = true;
+    config.kvm = core::RuntimeCapabilities::instance().hasKvm();
+    config.scoped = core::RuntimeCapabilities::instance().hasUserScopes();
+    if (limits.cpus > 0) {
+        config.cpus = qMax(1, static_cast<int>(std::ceil(limits.cpus)));
+    }
+    if (limits.memoryBytes > 0) {
+        config.memoryMiB = qMax<qint64>(256, limits.memoryBytes >> 20);
+    }
+    if (!workspace.isEmpty()) {
+        config.workspace = QFileInfo(workspace).canonicalFilePath();
+    }
+    return config;
+}
+
+void QemuBackend::startVM(const VirtualMachine::Config& config) {
+    m_startClock.start();
+    m_scoped = config.scoped;
+    emit output("Starting QEMU VM with image: " + config.backingDisk);
+    if (!config.kvm) {
+        emit output("/dev/kvm is not usable, emulating the guest with TCG: expect it to be slow");
+    }
+
+    VirtualMachine* vm = m_pool ? m_pool->acquire(config, this) : nullptr;
+    m_pooled = vm != nullptr;
+    if (m_pooled) {
+        emit output(vm->isReady() ? QString("Took a started VM from the pool")
+                                  : QString("Took a VM from the pool that is still starting"));
+    } else {
+        if (m_pool) {
+            emit output("No pooled VM is free, starting one");
+        }
+        vm = new VirtualMachine(this);
+    }
+
+    m_vm = vm;
+    connect(vm, &VirtualMachine::output, this, &ExecutionBackend::output);
+    connect(vm, &VirtualMachine::ready, this, &QemuBackend::setupGuest);
+    connect(vm, &VirtualMachine::stopped, this, &QemuBackend::endAgentSession);
+    connect(vm, &VirtualMachine::failed, this, [this](const QString& errorMessage) {
+        stopVM();
+        emit error(errorMessage);
+        emit environmentPrepared(false);
+    });
+
+    if (!m_pooled) {
+        vm->start(config);
+    } else if (vm->isReady()) {
+        QMetaObject::invokeMethod(this, [this, vm]() {
+            if (m_vm == vm) {
+                setupGuest();
+            }
+        }, Qt::QueuedConnection);
+    }
+}
+
+void QemuBackend::setupGuest() {
+    // Waiting ends here; the setup below is the same for every guest
+    if (m_pool) {
+        m_pool->recordWait(m_startClock.elapsed());
+    }
+
+    m_readyToken = QUuid::createUuid().toString(QUuid::Id128);
+    m_setupOutput.clear();
+
+    QString entropy;
+    for (int i = 0; i < 4; ++i) {
+        entropy += QString::number(QRandomGenerator::system()->generate64(), 16);
+    }
+
+    QIODevice* agent = m_vm->agent();
+    connect(agent, &QIODevice::readyRead, this, &QemuBackend::readSetupOutput);
+    m_setupTimer->start(SETUP_TIMEOUT_MS);
+    agent->write(QString(GUEST_SETUP)
+                 .arg(QDateTime::currentSecsSinceEpoch())
+                 .arg(entropy)
+                 .arg(m_readyToken)
+                 .toUtf8());
+}
+
+void QemuBackend::readSetupOutput() {
+    QIODevice* agent = m_vm->agent();
+    m_setupOutput += agent->readAll();
+    int tokenAt = m_setupOutput.indexOf(m_readyToken.toUtf8() + '\n');
+    if (tokenAt < 0) {
+        return;
+    }
+
+    // Everything from here on is output of the steps
+    disconnect(agent, &QIODevice::readyRead, this, &QemuBackend::readSetupOutput);
+    m_setupTimer->stop();
+    QString setupOutput = QString::fromUtf8(m_setupOutput.left(tokenAt)).trimmed();
+    m_setupOutput.clear();
+    if (!setupOutput.isEmpty()) {
+        emit output(setupOutput);
+    }
+    QString origin = m_vm->isRestored() ? "restored from snapshot" : "booted";
+    emit output(QString("VM ready in %1 s (%2 in %3 s%4)")
+                .arg(m_startClock.elapsed() / 1000.0, 0, 'f', 1)
+                .arg(origin)
+                .arg(m_vm->startupMs() / 1000.0, 0, 'f', 1)
+                .arg(m_pooled ? QString(", ahead of time by the pool") : QString()));
+
+    if (m_scoped) {
+        QString cgroup = core::CgroupMonitor::cgroupOfProcess(m_vm->processId());
+        if (!cgroup.isEmpty()) {
+            setCgroup(cgroup);
+        }
+    }
+
+    m_shell = new ShellSession(agent, this);
+    connect(m_shell, &ShellSession::output, this, &ExecutionBackend::output);
+    connect(m_shell, &ShellSession::finished, this, &QemuBackend::finishShellStep);
+    emit environmentPrepared(true);
+}
+
+void QemuBackend::endAgentSession() {
+    if (m_setupTimer->isActive()) {
+        stopVM();
+        emit error("The VM stopped while setting up the guest");
+        emit environmentPrepared(false);
+        return;
+    }
+
+    // A guest that goes away takes the running step with it
+    bool busy = m_shell && m_shell->isBusy();
+    stopVM();
+    if (busy) {
+        emit error("VM stopped unexpectedly");
+        emit stepCompleted(false);
+    }
 }
 
 void QemuBackend::stopVM() {
-    if (!m_vmId.isEmpty()) {
-        emit output("Stopping VM: " + m_vmId);
-        // Would send shutdown command to VM
-        m_vmId.clear();
+    m_stepTimer->stop();
+    m_setupTimer->stop();
+
+    // We may be inside a signal of the VM or the session
+    if (m_shell) {
+        m_shell->disconnect(this);
+        m_shell->deleteLater();
     }
+    if (m_vm) {
+        m_vm->disconnect(this);
+        m_vm->deleteLater();
+    }
+    m_shell = nullptr;
+    m_vm = nullptr;
+}
+
+void QemuBackend::finishShellStep(int exitCode) {
+    m_stepTimer->stop();
+
+    if (m_cancelled) {
+        emit error("Step cancelled");
+        emit stepCompleted(false);
+        return;
+    }
+
+    if (exitCode != 0) {
+        emit error(QString("Step failed with exit code %1").arg(exitCode));
+        emit stepCompleted(false);
+        return;
+    }
+
+    emit stepCompleted(true);
 }
 
 } // namespace backends
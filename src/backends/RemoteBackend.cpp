@@ -0,0 +1,148 @@
+#include "backends/RemoteBackend.h"
+#include "core/WorkerCoordinator.h"
+#include "core/WorkerProtocol.h"
+
+namespace gwt {
+namespace backends {
+
+RemoteBackend::RemoteBackend(core::WorkerCoordinator* coordinator, BackendType backendType, QObject* parent)
+    : ExecutionBackend(parent)
+    , m_coordinator(coordinator)
+    , m_lease(nullptr)
+    , m_backendType(backendType)
+    , m_pending(Pending::None)
+{
+}
+
+RemoteBackend::~RemoteBackend() {
+    // The worker tears down an environment whose lease goes away
+    if (m_lease && m_lease->isGranted()) {
+        m_lease->send(QJsonObject{{"type", "cleanup"}});
+    }
+}
+
+void RemoteBackend::executeStep(const core::WorkflowStep& step,
+                                const QVariantMap& context) {
+    if (!m_lease || !m_lease->isGranted()) {
+        emit error("No worker assigned");
+        completeStepLater(false);
+        return;
+    }
+    
+    m_pending = Pending::Step;
+    QJsonObject message;
+    message["type"] = "execute";
+    message["step"] = core::protocol::stepToJson(step);
+    message["context"] = QJsonObject::fromVariantMap(context);
+    m_lease->send(message);
+}
+
+void RemoteBackend::prepareEnvironment(const QString& runsOn) {
+    if (!m_coordinator) {
+        emit error("Worker coordinator is gone");
+        completePreparationLater(false);
+        return;
+    }
+    
+    m_runsOn = runsOn;
+    m_pending = Pending::Prepare;
+    m_lease = m_coordinator->requestLease(this);
+    
+    connect(m_lease, &core::WorkerLease::granted, this, [this]() {
+        emit output("Running on worker " + m_lease->workerName());
+        
+        QJsonObject message;
+        message["type"] = "prepare";
+        message["runsOn"] = m_runsOn;
+        message["backend"] = core::protocol::backendTypeName(m_backendType);
+        message["cpus"] = m_resourceLimits.cpus;
+        message["memory"] = m_resourceLimits.memoryBytes;
+        // Workers share the coordinator's filesystem
+        message["workspace"] = m_workspacePath;
+        m_lease->send(message);
+    });
+    connect(m_lease, &core::WorkerLease::messageReceived, this, &RemoteBackend::handleMessage);
+    connect(m_lease, &core::WorkerLease::lost, this, [this]() {
+        emit error("Lost connection to worker");
+        failPending();
+    });
+}
+
+void RemoteBackend::cleanup() {
+    if (!m_lease || !m_lease->isGranted()) {
+        // Never got a worker, or lost it; there is nothing left to tear down
+        if (m_lease) {
+            m_lease->release();
+        }
+        completeCleanupLater();
+        return;
+    }
+    
+    m_pending = Pending::Cleanup;
+    m_lease->send(QJsonObject{{"type", "cleanup"}});
+}
+
+void RemoteBackend::cancel() {
+    if (!m_lease) {
+        return;
+    }
+    
+    if (!m_lease->isGranted()) {
+        // Still waiting for a slot; give up the request
+        m_lease->release();
+        failPending();
+        return;
+    }
+    
+    m_lease->send(QJsonObject{{"type", "cancel"}});
+}
+
+core::ResourceUsage RemoteBackend::takeResourceUsage() {
+    core::ResourceUsage usage = m_usage;
+    m_usage = core::ResourceUsage();
+    return usage;
+}
+
+void RemoteBackend::handleMessage(const QJsonObject& message) {
+    QString type = message["type"].toString();
+    
+    if (type == "output") {
+        emit output(message["text"].toString());
+    } else if (type == "error") {
+        emit error(message["message"].toString());
+    } else if (type == "prepared" && m_pending == Pending::Prepare) {
+        m_pending = Pending::None;
+        m_usage.accumulate(core::protocol::usageFromJson(message["usage"].toObject()));
+        emit environmentPrepared(message["success"].toBool());
+    } else if (type == "stepCompleted" && m_pending == Pending::Step) {
+        m_pending = Pending::None;
+        m_usage.accumulate(core::protocol::usageFromJson(message["usage"].toObject()));
+        emit stepCompleted(message["success"].toBool());
+    } else if (type == "cleanupFinished" && m_pending == Pending::Cleanup) {
+        m_pending = Pending::None;
+        m_lease->release();
+        emit cleanupFinished();
+    }
+}
+
+void RemoteBackend::failPending() {
+    Pending pending = m_pending;
+    m_pending = Pending::None;
+    
+    switch (pending) {
+    case Pending::Prepare:
+        completePreparationLater(false);
+        break;
+    case Pending::Step:
+        completeStepLater(false);
+        break;
+    case Pending::Cleanup:
+        completeCleanupLater();
+        break;
+    case Pending::None:
+        break;
+    }
+}
+
+} // namespace backends
+} // namespace gwt
@@ -0,0 +1,140 @@
+#include "backends/ShellSession.h"
+#include <QIODevice>
+#include <QStringList>
+#include <QUuid>
+
+namespace gwt {
+namespace backends {
+
+ShellSession::ShellSession(QIODevice* device, QObject* parent)
+    : QObject(parent)
+    , m_device(device)
+    , m_token("__gwt_" + QUuid::createUuid().toString(QUuid::Id128) + "_status")
+    , m_busy(false)
+    , m_started(false)
+    , m_exportedEnvironment(false)
+    , m_heldBlankLine(false)
+{
+    connect(m_device, &QIODevice::readyRead, this, &ShellSession::readOutput);
+}
+
+ShellSession::~ShellSession() = default;
+
+bool ShellSession::isBusy() const {
+    return m_busy;
+}
+
+bool ShellSession::exportedEnvironment() const {
+    return m_exportedEnvironment;
+}
+
+void ShellSession::run(const QString& shell, const QString& script, const QString& workingDirectory) {
+    QString envFile = "/tmp/" + m_token + ".env";
+    QString commands;
+
+    if (!m_started) {
+        m_started = true;
+        commands += "export GITHUB_ENV=" + quote(envFile) + "\n";
+        commands += ": > \"$GITHUB_ENV\"\n";
+    }
+
+    // The step must not read the session's input, which carries later commands
+    commands += "(";
+    if (!workingDirectory.isEmpty()) {
+        commands += " cd " + quote(workingDirectory) + " || exit 1;";
+    }
+    commands += " exec " + shell + " -c " + quote(script) + " ) </dev/null 2>&1\n";
+    commands += "__gwt_status=$? __gwt_env=0\n";
+
+    // Export what the step appended to GITHUB_ENV for the following steps
+    commands += "if [ -s \"$GITHUB_ENV\" ]; then __gwt_env=1; "
+                "while IFS= read -r __gwt_line; do "
+                "case \"$__gwt_line\" in *=*) export \"${__gwt_line%%=*}=${__gwt_line#*=}\";; esac; "
+                "done < \"$GITHUB_ENV\"; : > \"$GITHUB_ENV\"; fi\n";
+
+    // The leading line break puts the marker on a line of its own
+    commands += "printf '\\n%s %d %d\\n' " + m_token + " \"$__gwt_status\" \"$__gwt_env\"\n";
+
+    m_busy = true;
+    m_heldBlankLine = false;
+    m_device->write(commands.toUtf8());
+}
+
+QString ShellSession::quote(const QString& text) {
+    QString quoted = text;
+    quoted.replace("'", "'\\''");
+    return "'" + quoted + "'";
+}
+
+void ShellSession::readOutput() {
+    m_buffer += m_device->readAll();
+
+    QStringList lines;
+    int start = 0;
+    int end;
+    while ((end = m_buffer.indexOf('\n', start)) != -1) {
+        QString line = QString::fromUtf8(m_buffer.constData() + start, end - start);
+        start = end + 1;
+
+        if (line.startsWith(m_token + ' ')) {
+            m_buffer.remove(0, start);
+            start = 0;
+            if (!lines.isEmpty()) {
+                emit output(lines.join('\n'));
+                lines.clear();
+            }
+
+            // "<token> <status> <env>"
+            QStringList fields = line.mid(m_token.size() + 1).trimmed().split(' ');
+            bool ok = false;
+            int exitCode = fields.value(0).toInt(&ok);
+            m_exportedEnvironment = fields.value(1) == "1";
+            m_busy = false;
+            m_heldBlankLine = false;
+            emit finished(ok ? exitCode : -1);
+            continue;
+        }
+
+        // Hold an empty line back until it is clear it is not the one
+        // written in front of the marker
+        if (m_heldBlankLine) {
+            lines << QString();
+            m_heldBlankLine = false;
+        }
+        if (line.isEmpty()) {
+            m_heldBlankLine = true;
+        } else {
+            lines << line;
+        }
+    }
+
+    m_buffer.remove(0, start);
+
+    // Output without line breaks must not pile up; cut before a UTF-8
+    // continuation byte so no character is split
+    if (m_buffer.size() > MAX_LINE_BYTES) {
+        int cut = m_buffer.size();
+        while (cut > 0 && (static_cast<unsigned char>(m_buffer[cut - 1]) & 0xC0) == 0x80) {
+            --cut;
+        }
+        if (cut > 0 && static_cast<unsigned char>(m_buffer[cut - 1]) >= 0xC0) {
+            --cut;
+        }
+        if (cut == 0) {
+            cut = m_buffer.size();
+        }
+        if (m_heldBlankLine) {
+            lines << QString();
+            m_heldBlankLine = false;
+        }
+        lines << QString::fromUtf8(m_buffer.constData(), cut);
+        m_buffer.remove(0, cut);
+    }
+
+    if (!lines.isEmpty()) {
+        emit output(lines.join('\n'));
+    }
+}
+
+} // namespace backends
+} // namespace gwt
@@ -0,0 +1,135 @@
+#include "backends/SimulatedBackend.h"
+#include <QElapsedTimer>
+#include <QTimer>
+#include <atomic>
+#include <cmath>
+#include <random>
+
+namespace gwt {
+namespace backends {
+
+namespace {
+std::atomic<qint64> s_spinNs{0};
+}
+
+SimulatedBackend::SimulatedBackend(const SimulationProfile& profile, quint32 seed, QObject* parent)
+    : ExecutionBackend(parent)
+    , m_profile(profile)
+    , m_random(seed)
+    , m_timer(new QTimer(this))
+    , m_pending(Pending::None)
+    , m_pendingSuccess(false)
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, [this]() {
+        complete(m_pendingSuccess);
+    });
+}
+
+SimulatedBackend::~SimulatedBackend() = default;
+
+void SimulatedBackend::executeStep(const core::WorkflowStep& step,
+                                   const QVariantMap& context) {
+    Q_UNUSED(context);
+    
+    for (int line = 0; line < m_profile.outputLinesPerStep; ++line) {
+        emit output(QStringLiteral("%1: simulated output line %2").arg(step.name).arg(line + 1));
+    }
+    
+    bool success = m_random.generateDouble() >= m_profile.failureRate;
+    simulate(Pending::Step, sampleStepMs(), success);
+}
+
+void SimulatedBackend::prepareEnvironment(const QString& runsOn) {
+    Q_UNUSED(runsOn);
+    simulate(Pending::Prepare, m_profile.prepareMs, true);
+}
+
+void SimulatedBackend::cleanup() {
+    simulate(Pending::Cleanup, m_profile.cleanupMs, true);
+}
+
+void SimulatedBackend::cancel() {
+    // Only a sleeping operation can be interrupted; a spin has already finished
+    if (m_timer->isActive() && m_pending != Pending::Cleanup) {
+        m_timer->stop();
+        QMetaObject::invokeMethod(this, [this]() {
+            complete(false);
+        }, Qt::QueuedConnection);
+    }
+}
+
+qint64 SimulatedBackend::totalSpinNs() {
+    return s_spinNs.load();
+}
+
+double SimulatedBackend::sampleStepMs() {
+    double mean = m_profile.meanStepMs;
+    if (mean <= 0) {
+        return 0;
+    }
+    
+    switch (m_profile.distribution) {
+    case SimulationProfile::Distribution::Fixed:
+        return mean;
+    case SimulationProfile::Distribution::Uniform:
+        return std::uniform_real_distribution<double>(0, 2 * mean)(m_random);
+    case SimulationProfile::Distribution::Exponential:
+        return std::exponential_distribution<double>(1.0 / mean)(m_random);
+    case SimulationProfile::Distribution::LogNormal:
+        // With sigma 1 the mean of the distribution is exp(mu + 1/2)
+        return std::lognormal_distribution<double>(std::log(mean) - 0.5, 1.0)(m_random);
+    }
+    return mean;
+}
+
+void SimulatedBackend::simulate(Pending operation, double durationMs, bool success) {
+    m_pending = operation;
+    m_pendingSuccess = success;
+    
+    if (durationMs <= 0) {
+        QMetaObject::invokeMethod(this, [this, success]() {
+            complete(success);
+        }, Qt::QueuedConnection);
+        return;
+    }
+    
+    if (m_profile.spin) {
+        QElapsedTimer timer;
+        timer.start();
+        qint64 durationNs = qint64(durationMs * 1e6);
+        while (timer.nsecsElapsed() < durationNs) {
+        }
+        s_spinNs += timer.nsecsElapsed();
+        
+        QMetaObject::invokeMethod(this, [this, success]() {
+            complete(success);
+        }, Qt::QueuedConnection);
+        return;
+    }
+    
+    m_timer->start(qMax(1, qRound(durationMs)));
+}
+
+void SimulatedBackend::complete(bool success) {
+    Pending pending = m_pending;
+    m_pending = Pending::None;
+    
+    switch (pending) {
+    case Pending::Prepare:
+        emit environmentPrepared(success);
+        break;
+    case Pending::Step:
+        emit stepCompleted(success);
+        break;
+    case Pending::Cleanup:
+        emit cleanupFinished();
+        break;
+    case Pending::None:
+        break;
+    }
+}
+
+} // namespace backends
+} // namespace gwt
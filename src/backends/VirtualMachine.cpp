@@ -0,0 +1,565 @@
+#include "backends/VirtualMachine.h"
+#include "backends/VmSnapshotStore.h"
+#include "core/StorageProvider.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QMetaObject>
+#include <QTimer>
+#include <QUuid>
+#include <memory>
+
+namespace gwt {
+namespace backends {
+
+namespace {
+
+// Sent whenever the agent connects. Waiting for systemd to finish starting
+// leaves the guest idle before it is used or saved. %1 is the ready token.
+const char* AGENT_PROBE = "{ command -v systemctl && timeout 120 systemctl is-system-running --wait; } "
+                          ">/dev/null 2>&1; echo %1\n";
+
+constexpr int CONSOLE_TAIL_LINES = 20;
+
+/**
+ * @brief Escape a value for QEMU's comma-separated option syntax
+ */
+QString escapeOption(QString value) {
+    return value.replace(',', ",,");
+}
+
+/**
+ * @brief Quote a word for the shell QEMU runs exec: migrations in
+ */
+QString shellQuote(QString text) {
+    return "'" + text.replace("'", "'\\''") + "'";
+}
+
+} // namespace
+
+VirtualMachine::VirtualMachine(QObject* parent)
+    : QObject(parent)
+    , m_bootTimer(new QTimer(this))
+    , m_agentPollTimer(new QTimer(this))
+    , m_saveTimer(new QTimer(this))
+    , m_startupMs(0)
+    , m_ready(false)
+    , m_saving(false)
+{
+    m_bootTimer->setSingleShot(true);
+    connect(m_bootTimer, &QTimer::timeout, this, [this]() {
+        fail(QString("The guest agent did not answer within %1 s; does the image run a shell on %2?")
+             .arg(m_bootTimer->interval() / 1000)
+             .arg(QString("/dev/virtio-ports/") + AGENT_PORT));
+    });
+
+    m_agentPollTimer->setSingleShot(true);
+    connect(m_agentPollTimer, &QTimer::timeout, this, &VirtualMachine::connectAgent);
+
+    m_saveTimer->setSingleShot(true);
+    connect(m_saveTimer, &QTimer::timeout, this, [this]() {
+        finishSave("Saving the VM state timed out");
+    });
+}
+
+VirtualMachine::~VirtualMachine() {
+    kill();
+    if (!m_dir.isEmpty()) {
+        QProcess::startDetached("rm", QStringList() << "-rf" << m_dir);
+    }
+}
+
+void VirtualMachine::start(const Config& config) {
+    m_config = config;
+    m_startClock.start();
+
+    if (!config.fromSnapshot) {
+        createOverlay();
+        return;
+    }
+
+    if (!VmSnapshotStore::isComplete(VmSnapshotStore::snapshotDir(config))) {
+        emit output(QString("Booting and saving a snapshot of the image for %1 CPUs and %2 MiB; later VMs restore it")
+                    .arg(config.cpus).arg(config.memoryMiB));
+    }
+    VmSnapshotStore::instance().acquire(config, this, [this](const QString& snapshotDir, const QString& errorMessage) {
+        if (!errorMessage.isEmpty()) {
+            emit output("No snapshot of the image, booting instead: " + errorMessage);
+        }
+        m_snapshotDir = snapshotDir;
+        createOverlay();
+    });
+}
+
+bool VirtualMachine::isReady() const {
+    return m_ready;
+}
+
+bool VirtualMachine::isRestored() const {
+    return m_ready && !m_snapshotDir.isEmpty();
+}
+
+void VirtualMachine::createOverlay() {
+    // A failed restore leaves its directory behind
+    if (!m_dir.isEmpty()) {
+        QProcess::startDetached("rm", QStringList() << "-rf" << m_dir);
+    }
+    m_dir = core::StorageProvider::instance().getCacheRoot() + "/vms/"
+          + QUuid::createUuid().toString(QUuid::Id128);
+
+    // The 9p share needs a directory even when the job has no repository
+    if (!QDir().mkpath(m_dir + "/empty")) {
+        QMetaObject::invokeMethod(this, [this]() {
+            emit failed("Could not create the VM directory " + m_dir);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    // A thin overlay: the backing image is only read, every write of the
+    // guest lands in the VM's own file
+    QString backingDisk = m_snapshotDir.isEmpty() ? m_config.backingDisk
+                                                  : m_snapshotDir + "/" + VmSnapshotStore::DISK_FILE;
+    QProcess* process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::MergedChannels);
+    QTimer* timer = new QTimer(process);
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, process, &QProcess::kill);
+
+    auto done = std::make_shared<bool>(false);
+    auto onFinished = [this, process, timer, done](bool success) {
+        if (*done) {
+            return;
+        }
+        *done = true;
+        bool timedOut = !timer->isActive();
+        timer->stop();
+        process->deleteLater();
+        m_overlayProcess = nullptr;
+
+        if (success) {
+            launch();
+            return;
+        }
+        QString message = timedOut ? QString("Timed out") : QString::fromUtf8(process->readAll()).trimmed();
+        fail("Could not create the overlay disk: " + (message.isEmpty() ? process->errorString() : message));
+    };
+
+    connect(process, &QProcess::finished, this,
+            [onFinished](int exitCode, QProcess::ExitStatus exitStatus) {
+        onFinished(exitStatus == QProcess::NormalExit && exitCode == 0);
+    });
+    connect(process, &QProcess::errorOccurred, this,
+            [onFinished](QProcess::ProcessError processError) {
+        // Every other error is followed by finished()
+        if (processError == QProcess::FailedToStart) {
+            onFinished(false);
+        }
+    });
+
+    m_overlayProcess = process;
+    timer->start(OVERLAY_TIMEOUT_MS);
+    process->start("qemu-img", QStringList() << "create" << "-q" << "-f" << "qcow2"
+                   << "-F" << "qcow2" << "-b" << QFileInfo(backingDisk).absoluteFilePath()
+                   << m_dir + "/disk.qcow2");
+}
+
+void VirtualMachine::saveState(const QString& stateFile) {
+    if (!m_ready || !m_process) {
+        QMetaObject::invokeMethod(this, [this]() {
+            emit stateSaved("The VM is not running");
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    m_saving = true;
+    m_saveTimer->start(SAVE_TIMEOUT_MS);
+
+    openMonitor([this, stateFile]() {
+        // A paused guest is saved in a single pass over its memory; it is
+        // restored paused as well, see resumeRestored()
+        qmp("stop", QJsonObject(), [](const QJsonObject&) {});
+        // QEMU signals the writer once the stream is sent, so the writer
+        // ignores SIGTERM and the file only appears once it is complete
+        QString partial = stateFile + ".partial";
+        QJsonObject arguments{{"uri", "exec:trap '' TERM; cat > " + shellQuote(partial)
+                                      + " && mv " + shellQuote(partial) + " " + shellQuote(stateFile)}};
+        qmp("migrate", arguments, [this](const QJsonObject& response) {
+            if (response.contains("error")) {
+                finishSave(response["error"].toObject()["desc"].toString());
+            } else {
+                pollMigration();
+            }
+        });
+    }, [this](const QString& errorMessage) {
+        finishSave(errorMessage);
+    });
+}
+
+void VirtualMachine::shutdown() {
+    if (!m_process || m_process->state() == QProcess::NotRunning) {
+        QMetaObject::invokeMethod(this, [this]() {
+            emit stopped();
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    // QEMU flushes the overlay on SIGTERM; only its exit counts from now on
+    if (m_agent) {
+        m_agent->disconnect(this);
+    }
+    m_process->terminate();
+}
+
+QIODevice* VirtualMachine::agent() const {
+    return m_ready ? m_agent.data() : nullptr;
+}
+
+qint64 VirtualMachine::processId() const {
+    return m_process ? m_process->processId() : 0;
+}
+
+QString VirtualMachine::directory() const {
+    return m_dir;
+}
+
+qint64 VirtualMachine::startupMs() const {
+    return m_startupMs;
+}
+
+void VirtualMachine::launch() {
+    m_readyToken = QUuid::createUuid().toString(QUuid::Id128);
+    m_agentOutput.clear();
+
+    // Only QEMU's own messages; the guest's console goes to console.log
+    QProcess* process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::MergedChannels);
+    m_process = process;
+
+    connect(process, &QProcess::finished, this, &VirtualMachine::handleExit);
+    connect(process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError processError) {
+        // Every other error is followed by finished()
+        if (processError == QProcess::FailedToStart) {
+            handleExit();
+        }
+    });
+
+    QStringList args = arguments();
+    QString program = "qemu-system-x86_64";
+
+    // The scope only accounts the VM: -smp and -m already limit the guest,
+    // and a MemoryMax would have to leave room for QEMU's own overhead
+    if (m_config.scoped) {
+        args = QStringList() << "--user" << "--scope" << "--quiet" << "--collect"
+                             << "--" << program << args;
+        program = "systemd-run";
+    }
+
+    m_bootTimer->start(m_config.kvm ? BOOT_TIMEOUT_MS : TCG_BOOT_TIMEOUT_MS);
+    process->start(program, args);
+    connectAgent();
+    if (!m_snapshotDir.isEmpty()) {
+        resumeRestored();
+    }
+}
+
+QStringList VirtualMachine::arguments() const {
+    QString workspace = m_config.workspace.isEmpty() ? m_dir + "/empty" : m_config.workspace;
+
+    QStringList args;
+    args << "-machine" << (m_config.kvm ? "q35,accel=kvm" : "q35,accel=tcg")
+         << "-cpu" << (m_config.kvm ? "host" : "max")
+         << "-smp" << QString::number(m_config.cpus)
+         << "-m" << QString::number(m_config.memoryMiB)
+         << "-nodefaults" << "-display" << "none" << "-monitor" << "none"
+         << "-serial" << "file:" + m_dir + "/console.log"
+         << "-qmp" << "unix:" + escapeOption(m_dir + "/qmp.sock") + ",server=on,wait=off"
+         // The overlay is thrown away with the VM, so flushes to the host disk are wasted
+         << "-drive" << "file=" + escapeOption(m_dir + "/disk.qcow2")
+                        + ",if=virtio,format=qcow2,cache=unsafe,discard=unmap"
+         << "-netdev" << "user,id=net0" << "-device" << "virtio-net-pci,netdev=net0"
+         << "-virtfs" << "local,path=" + escapeOption(workspace) + ",mount_tag=" + WORKSPACE_TAG
+                        + ",security_model=none,readonly=on"
+         << "-device" << "virtio-serial-pci"
+         << "-chardev" << "socket,id=agent,path=" + escapeOption(m_dir + "/agent.sock")
+                          + ",server=on,wait=off"
+         << "-device" << QString("virtserialport,chardev=agent,name=") + AGENT_PORT;
+
+    // Resuming needs the same devices in the same order as the saved guest
+    if (!m_snapshotDir.isEmpty()) {
+        args << "-incoming" << "exec:cat " + shellQuote(m_snapshotDir + "/" + VmSnapshotStore::STATE_FILE);
+    }
+    return args;
+}
+
+void VirtualMachine::connectAgent() {
+    if (!m_process || !m_bootTimer->isActive()) {
+        return;
+    }
+
+    QLocalSocket* agent = new QLocalSocket(this);
+    m_agent = agent;
+
+    // QEMU keeps what we write until the guest opens its end of the port,
+    // so the probe can be sent before the guest has booted
+    connect(agent, &QLocalSocket::connected, this, [this, agent]() {
+        agent->write(QString(AGENT_PROBE).arg(m_readyToken).toUtf8());
+    });
+    connect(agent, &QIODevice::readyRead, this, &VirtualMachine::readAgentOutput);
+    connect(agent, &QLocalSocket::disconnected, this, &VirtualMachine::handleExit);
+    connect(agent, &QLocalSocket::errorOccurred, this, [this, agent](QLocalSocket::LocalSocketError socketError) {
+        // QEMU creates the socket a moment after it starts
+        if (socketError == QLocalSocket::ServerNotFoundError
+            || socketError == QLocalSocket::ConnectionRefusedError) {
+            agent->disconnect(this);
+            agent->deleteLater();
+            m_agent = nullptr;
+            m_agentPollTimer->start(AGENT_POLL_MS);
+        }
+    });
+
+    agent->connectToServer(m_dir + "/agent.sock");
+}
+
+void VirtualMachine::readAgentOutput() {
+    m_agentOutput += m_agent->readAll();
+    if (!m_agentOutput.contains(m_readyToken.toUtf8() + '\n')) {
+        return;
+    }
+
+    // Everything from here on is read by the user of the VM
+    disconnect(m_agent, &QIODevice::readyRead, this, &VirtualMachine::readAgentOutput);
+    m_bootTimer->stop();
+    m_agentOutput.clear();
+    m_startupMs = m_startClock.elapsed();
+    m_ready = true;
+    emit ready();
+}
+
+void VirtualMachine::handleExit() {
+    if (!m_ready) {
+        QString message;
+        if (m_process) {
+            message = QString::fromUtf8(m_process->readAll()).trimmed();
+            if (message.isEmpty() && m_process->error() == QProcess::FailedToStart) {
+                message = m_process->errorString();
+            }
+        }
+        fail("The VM stopped while starting" + (message.isEmpty() ? QString() : ": " + message));
+        return;
+    }
+
+    if (m_saving) {
+        finishSave("QEMU exited while saving the VM state");
+    }
+    kill();
+    emit stopped();
+}
+
+void VirtualMachine::fail(const QString& errorMessage) {
+    kill();
+
+    QFile console(m_dir + "/console.log");
+    if (console.open(QIODevice::ReadOnly)) {
+        QStringList lines = QString::fromUtf8(console.readAll()).trimmed().split('\n');
+        if (lines.size() > CONSOLE_TAIL_LINES) {
+            lines = lines.mid(lines.size() - CONSOLE_TAIL_LINES);
+        }
+        if (!lines.join("").trimmed().isEmpty()) {
+            emit output("Guest console:\n" + lines.join('\n'));
+        }
+    }
+
+    if (!m_snapshotDir.isEmpty()) {
+        // Most likely QEMU or the host changed since the snapshot was saved
+        emit output("Restoring the snapshot failed, booting instead: " + errorMessage);
+        VmSnapshotStore::instance().discard(m_snapshotDir);
+        m_snapshotDir.clear();
+        createOverlay();
+        return;
+    }
+    emit failed(errorMessage);
+}
+
+void VirtualMachine::kill() {
+    m_bootTimer->stop();
+    m_agentPollTimer->stop();
+
+    // We may be inside a signal of a socket or process; the processes are
+    // detached so that deleting the VM does not wait for them to exit
+    if (m_agent) {
+        m_agent->disconnect(this);
+        m_agent->deleteLater();
+    }
+    if (m_qmp) {
+        m_qmp->disconnect(this);
+        m_qmp->deleteLater();
+    }
+    for (QProcess* process : {m_overlayProcess.data(), m_process.data()}) {
+        if (!process) {
+            continue;
+        }
+        process->disconnect(this);
+        process->setParent(nullptr);
+        if (process->state() == QProcess::NotRunning) {
+            process->deleteLater();
+        } else {
+            connect(process, &QProcess::finished, process, &QObject::deleteLater);
+            process->kill();
+        }
+    }
+    m_agent = nullptr;
+    m_qmp = nullptr;
+    m_overlayProcess = nullptr;
+    m_process = nullptr;
+}
+
+void VirtualMachine::resumeRestored() {
+    openMonitor([this]() {
+        pollIncoming();
+    }, [this](const QString& errorMessage) {
+        fail("Could not resume the restored guest: " + errorMessage);
+    });
+}
+
+void VirtualMachine::pollIncoming() {
+    qmp("query-status", QJsonObject(), [this](const QJsonObject& response) {
+        if (response.contains("error")) {
+            fail("Could not resume the restored guest: " + response["error"].toObject()["desc"].toString());
+            return;
+        }
+
+        // A cont sent while the state is still arriving would be ignored,
+        // because the guest takes on the saved run state once it has arrived
+        QString status = response["return"].toObject()["status"].toString();
+        if (status == "inmigrate") {
+            QTimer::singleShot(MIGRATION_POLL_MS, this, [this]() {
+                if (m_qmp && !m_ready) {
+                    pollIncoming();
+                }
+            });
+            return;
+        }
+        if (status == "running") {
+            closeMonitor();
+            return;
+        }
+
+        qmp("cont", QJsonObject(), [this](const QJsonObject& contResponse) {
+            if (contResponse.contains("error")) {
+                fail("Could not resume the restored guest: " + contResponse["error"].toObject()["desc"].toString());
+                return;
+            }
+            closeMonitor();
+        });
+    });
+}
+
+void VirtualMachine::openMonitor(std::function<void()> onConnected,
+                                 std::function<void(const QString& errorMessage)> onError) {
+    m_qmpOutput.clear();
+    m_qmpCallbacks.clear();
+
+    QLocalSocket* monitor = new QLocalSocket(this);
+    m_qmp = monitor;
+    connect(monitor, &QIODevice::readyRead, this, &VirtualMachine::readQmpOutput);
+    connect(monitor, &QLocalSocket::connected, this, [this, onConnected]() {
+        qmp("qmp_capabilities", QJsonObject(), [](const QJsonObject&) {});
+        onConnected();
+    });
+    connect(monitor, &QLocalSocket::errorOccurred, this,
+            [this, monitor, onConnected, onError](QLocalSocket::LocalSocketError socketError) {
+        QString errorMessage = "QEMU monitor: " + monitor->errorString();
+        monitor->disconnect(this);
+        monitor->deleteLater();
+        m_qmp = nullptr;
+
+        // QEMU creates the socket a moment after it starts
+        bool notYet = socketError == QLocalSocket::ServerNotFoundError
+                   || socketError == QLocalSocket::ConnectionRefusedError;
+        if (notYet && m_process && m_process->state() != QProcess::NotRunning) {
+            QTimer::singleShot(AGENT_POLL_MS, this, [this, onConnected, onError]() {
+                if (m_process && !m_qmp) {
+                    openMonitor(onConnected, onError);
+                }
+            });
+            return;
+        }
+        onError(errorMessage);
+    });
+
+    monitor->connectToServer(m_dir + "/qmp.sock");
+}
+
+void VirtualMachine::closeMonitor() {
+    m_qmpCallbacks.clear();
+    if (m_qmp) {
+        m_qmp->disconnect(this);
+        m_qmp->deleteLater();
+        m_qmp = nullptr;
+    }
+}
+
+void VirtualMachine::qmp(const QString& command, const QJsonObject& arguments,
+                         std::function<void(const QJsonObject& response)> onResponse) {
+    QJsonObject message{{"execute", command}};
+    if (!arguments.isEmpty()) {
+        message["arguments"] = arguments;
+    }
+    m_qmpCallbacks.append(onResponse);
+    m_qmp->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+}
+
+void VirtualMachine::readQmpOutput() {
+    m_qmpOutput += m_qmp->readAll();
+
+    int newline;
+    while ((newline = m_qmpOutput.indexOf('\n')) >= 0) {
+        QJsonObject message = QJsonDocument::fromJson(m_qmpOutput.left(newline)).object();
+        m_qmpOutput.remove(0, newline + 1);
+
+        // The greeting and asynchronous events answer no command
+        if (message.contains("QMP") || message.contains("event") || m_qmpCallbacks.isEmpty()) {
+            continue;
+        }
+        auto onResponse = m_qmpCallbacks.takeFirst();
+        onResponse(message);
+        if (!m_qmp) {
+            return;
+        }
+    }
+}
+
+void VirtualMachine::pollMigration() {
+    qmp("query-migrate", QJsonObject(), [this](const QJsonObject& response) {
+        QJsonObject migration = response["return"].toObject();
+        QString status = migration["status"].toString();
+        if (status == "completed") {
+            finishSave(QString());
+        } else if (status == "failed" || status == "cancelled" || response.contains("error")) {
+            QString reason = migration["error-desc"].toString();
+            finishSave("Migration " + (status.isEmpty() ? QString("failed") : status)
+                       + (reason.isEmpty() ? QString() : ": " + reason));
+        } else {
+            QTimer::singleShot(MIGRATION_POLL_MS, this, [this]() {
+                if (m_saving && m_qmp) {
+                    pollMigration();
+                }
+            });
+        }
+    });
+}
+
+void VirtualMachine::finishSave(const QString& errorMessage) {
+    if (!m_saving) {
+        return;
+    }
+    m_saving = false;
+    m_saveTimer->stop();
+    closeMonitor();
+    emit stateSaved(errorMessage);
+}
+
+} // namespace backends
+} // namespace gwt
@@ -0,0 +1,124 @@
+#include "backends/VmPool.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QTimer>
+
+namespace gwt {
+namespace backends {
+
+VmPool::VmPool(int size, QObject* parent)
+    : QObject(parent)
+    , m_size(qMax(0, size))
+{
+}
+
+// The guests are children of the pool; deleting them kills QEMU
+VmPool::~VmPool() = default;
+
+int VmPool::size() const {
+    return m_size;
+}
+
+void VmPool::warm(const VirtualMachine::Config& config) {
+    if (!QFileInfo(config.backingDisk).isFile()) {
+        return;
+    }
+
+    QString key = groupKey(config);
+    Group& group = m_groups[key];
+    if (QDateTime::currentMSecsSinceEpoch() < group.retryAtMs) {
+        return;
+    }
+
+    for (int count = group.vms.size(); count < m_size; ++count) {
+        startVM(key, config);
+    }
+}
+
+VirtualMachine* VmPool::acquire(const VirtualMachine::Config& config, QObject* parent) {
+    QString key = groupKey(config);
+    Group& group = m_groups[key];
+
+    // A ready guest first, else the one that has been starting the longest
+    VirtualMachine* vm = nullptr;
+    for (const QPointer<VirtualMachine>& candidate : group.vms) {
+        if (candidate && candidate->isReady()) {
+            vm = candidate;
+            break;
+        }
+    }
+    if (!vm && !group.vms.isEmpty()) {
+        vm = group.vms.first();
+    }
+
+    if (!vm) {
+        m_stats.misses++;
+    } else {
+        if (vm->isReady()) {
+            m_stats.hits++;
+        } else {
+            m_stats.partialHits++;
+        }
+        group.vms.removeAll(QPointer<VirtualMachine>(vm));
+        vm->disconnect(this);
+        vm->setParent(parent);
+    }
+
+    warm(config);
+    return vm;
+}
+
+void VmPool::recordWait(qint64 waitMs) {
+    m_stats.waitMs += waitMs;
+}
+
+VmPool::Stats VmPool::stats() const {
+    return m_stats;
+}
+
+QString VmPool::groupKey(const VirtualMachine::Config& config) {
+    return QString("%1|%2|%3|%4|%5|%6")
+        .arg(config.backingDisk)
+        .arg(config.cpus)
+        .arg(config.memoryMiB)
+        .arg(config.kvm ? "kvm" : "tcg")
+        .arg(config.scoped ? "scope" : "")
+        .arg(config.workspace);
+}
+
+void VmPool::startVM(const QString& key, const VirtualMachine::Config& config) {
+    VirtualMachine* vm = new VirtualMachine(this);
+    m_groups[key].vms.append(vm);
+
+    connect(vm, &VirtualMachine::ready, this, [this, key]() {
+        m_groups[key].failures = 0;
+    });
+    connect(vm, &VirtualMachine::failed, this, [this, key, config, vm](const QString& errorMessage) {
+        // Jobs start their own guests and report their own errors until the
+        // retry, which backs off while the starts keep failing
+        Group& group = m_groups[key];
+        int delayMs = RETRY_MS << qMin(group.failures, MAX_RETRY_SHIFT);
+        group.failures++;
+        group.retryAtMs = QDateTime::currentMSecsSinceEpoch() + delayMs;
+        dropVM(key, vm);
+        emit error(QString("Could not start a pooled VM, retrying in %1 s: %2")
+                   .arg(delayMs / 1000).arg(errorMessage));
+        QTimer::singleShot(delayMs, this, [this, config]() {
+            warm(config);
+        });
+    });
+    connect(vm, &VirtualMachine::stopped, this, [this, key, vm]() {
+        dropVM(key, vm);
+    });
+
+    vm->start(config);
+}
+
+void VmPool::dropVM(const QString& key, VirtualMachine* vm) {
+    m_groups[key].vms.removeAll(QPointer<VirtualMachine>(vm));
+    vm->disconnect(this);
+    vm->deleteLater();
+}
+
+} // namespace backends
+} // namespace gwt
@@ -0,0 +1,174 @@
+#include "backends/VmSnapshotStore.h"
+#include "core/StorageProvider.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QProcess>
+#include <QUuid>
+#include <memory>
+
+namespace gwt {
+namespace backends {
+
+namespace {
+
+/**
+ * @brief Get the part of a snapshot's directory name shared by all versions of its base image
+ */
+QString snapshotPrefix(const VirtualMachine::Config& config) {
+    return QString("%1-%2c-%3m-%4-")
+        .arg(QFileInfo(config.backingDisk).completeBaseName())
+        .arg(config.cpus)
+        .arg(config.memoryMiB)
+        .arg(config.kvm ? "kvm" : "tcg");
+}
+
+QString snapshotRoot() {
+    return core::StorageProvider::instance().getCacheRoot() + "/vm-snapshots";
+}
+
+void removeDirLater(const QString& path) {
+    QProcess::startDetached("rm", QStringList() << "-rf" << path);
+}
+
+} // namespace
+
+VmSnapshotStore& VmSnapshotStore::instance() {
+    static VmSnapshotStore store;
+    return store;
+}
+
+void VmSnapshotStore::acquire(const VirtualMachine::Config& config, QObject* context, Callback onReady) {
+    QString dir = snapshotDir(config);
+
+    if (isComplete(dir) || m_failed.contains(dir)) {
+        QString errorMessage = m_failed.value(dir);
+        QString readyDir = errorMessage.isEmpty() ? dir : QString();
+        QMetaObject::invokeMethod(context, [onReady, readyDir, errorMessage]() {
+            onReady(readyDir, errorMessage);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    bool saving = m_pending.contains(dir);
+    m_pending[dir].append(Waiter{context, onReady});
+    if (!saving) {
+        save(dir, config);
+    }
+}
+
+void VmSnapshotStore::discard(const QString& snapshotDir) {
+    // Guests restoring from it keep their open files
+    if (QFileInfo(snapshotDir).isDir()) {
+        QString doomed = snapshotDir + ".discarded." + QUuid::createUuid().toString(QUuid::Id128);
+        if (QDir().rename(snapshotDir, doomed)) {
+            removeDirLater(doomed);
+        }
+    }
+}
+
+QString VmSnapshotStore::snapshotDir(const VirtualMachine::Config& config) {
+    qint64 imageTime = QFileInfo(config.backingDisk).lastModified().toSecsSinceEpoch();
+    return snapshotRoot() + "/" + snapshotPrefix(config) + QString::number(imageTime);
+}
+
+bool VmSnapshotStore::isComplete(const QString& snapshotDir) {
+    return QFileInfo(snapshotDir + "/" + DISK_FILE).isFile()
+        && QFileInfo(snapshotDir + "/" + STATE_FILE).isFile();
+}
+
+void VmSnapshotStore::save(const QString& snapshotDir, const VirtualMachine::Config& config) {
+    // Snapshots of an older version of the base image are of no use anymore
+    QString prefix = snapshotPrefix(config);
+    QDir root(snapshotRoot());
+    for (const QString& name : root.entryList(QStringList() << prefix + "*", QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (root.filePath(name) != snapshotDir && !name.contains(".partial.") && !name.contains(".discarded.")) {
+            discard(root.filePath(name));
+        }
+    }
+
+    // Only moved into place once complete, so a concurrent save by
+    // another process simply loses the rename
+    QString partial = snapshotDir + ".partial." + QUuid::createUuid().toString(QUuid::Id128);
+    if (!QDir().mkpath(partial)) {
+        finish(snapshotDir, "Could not create " + partial);
+        return;
+    }
+
+    // The guest is saved without a repository or a scope; a restored guest
+    // gets both from the VM it is restored into
+    VirtualMachine::Config guest = config;
+    guest.fromSnapshot = false;
+    guest.workspace.clear();
+    guest.scoped = false;
+
+    // Owned by the application, so a save in progress at exit is killed
+    VirtualMachine* vm = new VirtualMachine(QCoreApplication::instance());
+    auto saved = std::make_shared<bool>(false);
+
+    auto fail = [this, vm, snapshotDir, partial](const QString& errorMessage) {
+        vm->disconnect();
+        vm->deleteLater();
+        removeDirLater(partial);
+        finish(snapshotDir, errorMessage);
+    };
+
+    QObject::connect(vm, &VirtualMachine::failed, vm, fail);
+    QObject::connect(vm, &VirtualMachine::ready, vm, [vm, partial]() {
+        vm->saveState(partial + "/" + STATE_FILE);
+    });
+    QObject::connect(vm, &VirtualMachine::stateSaved, vm, [vm, saved, fail](const QString& errorMessage) {
+        if (!errorMessage.isEmpty()) {
+            fail("Could not save the VM state: " + errorMessage);
+            return;
+        }
+        *saved = true;
+        vm->shutdown();
+    });
+    QObject::connect(vm, &VirtualMachine::stopped, vm, [this, vm, saved, fail, snapshotDir, partial]() {
+        if (!*saved) {
+            fail("The VM stopped before its state was saved");
+            return;
+        }
+
+        // The overlay now holds exactly the disk the saved memory refers to
+        if (!QFileInfo(partial + "/" + STATE_FILE).isFile()
+            || !QFile::rename(vm->directory() + "/disk.qcow2", partial + "/" + DISK_FILE)) {
+            fail("The saved VM state is incomplete");
+            return;
+        }
+        if (!QDir().rename(partial, snapshotDir)) {
+            removeDirLater(partial);
+        }
+
+        vm->disconnect();
+        vm->deleteLater();
+        finish(snapshotDir, isComplete(snapshotDir) ? QString() : QString("Could not store the snapshot"));
+    });
+
+    vm->start(guest);
+}
+
+void VmSnapshotStore::finish(const QString& snapshotDir, const QString& errorMessage) {
+    if (!errorMessage.isEmpty()) {
+        m_failed[snapshotDir] = errorMessage;
+    }
+
+    QList<Waiter> waiters = m_pending.take(snapshotDir);
+    QString readyDir = errorMessage.isEmpty() ? snapshotDir : QString();
+    for (const Waiter& waiter : waiters) {
+        if (!waiter.context) {
+            continue;
+        }
+        Callback onReady = waiter.onReady;
+        QMetaObject::invokeMethod(waiter.context.data(), [onReady, readyDir, errorMessage]() {
+            onReady(readyDir, errorMessage);
+        }, Qt::QueuedConnection);
+    }
+}
+
+} // namespace backends
+} // namespace gwt
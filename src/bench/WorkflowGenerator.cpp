@@ -0,0 +1,131 @@
+#include "bench/WorkflowGenerator.h"
+#include <QRandomGenerator>
+#include <QVariantList>
+#include <cmath>
+
+namespace gwt {
+namespace bench {
+
+WorkflowGenerator::WorkflowGenerator(int stepsPerJob, quint32 seed)
+    : m_stepsPerJob(qMax(1, stepsPerJob))
+    , m_seed(seed)
+{
+}
+
+QStringList WorkflowGenerator::scenarios() {
+    return QStringList() << "fanout" << "chain" << "random" << "matrix";
+}
+
+core::Workflow WorkflowGenerator::generate(const QString& scenario, int size) const {
+    if (scenario == "fanout") {
+        return fanOut(qMax(1, size - 2));
+    } else if (scenario == "chain") {
+        return chain(size);
+    } else if (scenario == "random") {
+        return randomDag(size);
+    } else if (scenario == "matrix") {
+        return matrix(qMax(1, size - 1));
+    }
+    return core::Workflow();
+}
+
+core::Workflow WorkflowGenerator::fanOut(int width) const {
+    core::Workflow workflow = makeWorkflow(QStringLiteral("fanout-%1").arg(width));
+    workflow.jobs["root"] = makeJob("root", QStringList());
+    
+    QStringList leaves;
+    for (int i = 0; i < width; ++i) {
+        QString id = jobId(i);
+        workflow.jobs[id] = makeJob(id, QStringList{"root"});
+        leaves << id;
+    }
+    
+    workflow.jobs["sink"] = makeJob("sink", leaves);
+    return workflow;
+}
+
+core::Workflow WorkflowGenerator::chain(int depth) const {
+    core::Workflow workflow = makeWorkflow(QStringLiteral("chain-%1").arg(depth));
+    for (int i = 0; i < depth; ++i) {
+        QStringList needs;
+        if (i > 0) {
+            needs << jobId(i - 1);
+        }
+        workflow.jobs[jobId(i)] = makeJob(jobId(i), needs);
+    }
+    return workflow;
+}
+
+core::Workflow WorkflowGenerator::randomDag(int jobs, int maxNeeds) const {
+    core::Workflow workflow = makeWorkflow(QStringLiteral("random-%1").arg(jobs));
+    QRandomGenerator random(m_seed);
+    
+    // Edges only point to earlier jobs, which keeps the graph acyclic
+    for (int i = 0; i < jobs; ++i) {
+        QStringList needs;
+        int count = i == 0 ? 0 : random.bounded(qMin(i, maxNeeds) + 1);
+        while (needs.size() < count) {
+            QString dep = jobId(random.bounded(i));
+            if (!needs.contains(dep)) {
+                needs << dep;
+            }
+        }
+        workflow.jobs[jobId(i)] = makeJob(jobId(i), needs);
+    }
+    return workflow;
+}
+
+core::Workflow WorkflowGenerator::matrix(int variants) const {
+    core::Workflow workflow = makeWorkflow(QStringLiteral("matrix-%1").arg(variants));
+    
+    int side = qMax(1, qRound(std::cbrt(double(variants))));
+    int last = qMax(1, (variants + side * side - 1) / (side * side));
+    
+    QVariantMap axes;
+    QList<int> sizes{side, side, last};
+    QStringList names{"a", "b", "c"};
+    for (int axis = 0; axis < names.size(); ++axis) {
+        QVariantList values;
+        for (int value = 0; value < sizes[axis]; ++value) {
+            values << value;
+        }
+        axes[names[axis]] = values;
+    }
+    
+    core::WorkflowJob test = makeJob("test", QStringList());
+    test.strategy["matrix"] = axes;
+    test.strategy["fail-fast"] = false;
+    workflow.jobs["test"] = test;
+    workflow.jobs["report"] = makeJob("report", QStringList{"test"});
+    return workflow;
+}
+
+core::Workflow WorkflowGenerator::makeWorkflow(const QString& name) const {
+    core::Workflow workflow;
+    workflow.name = name;
+    workflow.filePath = "bench/" + name + ".yml";
+    return workflow;
+}
+
+core::WorkflowJob WorkflowGenerator::makeJob(const QString& id, const QStringList& needs) const {
+    core::WorkflowJob job;
+    job.id = id;
+    job.name = id;
+    job.runsOn = "ubuntu-latest";
+    job.needs = needs;
+    
+    for (int i = 0; i < m_stepsPerJob; ++i) {
+        core::WorkflowStep step;
+        step.name = QStringLiteral("step %1").arg(i + 1);
+        step.run = "true";
+        job.steps << step;
+    }
+    return job;
+}
+
+QString WorkflowGenerator::jobId(int index) {
+    return QStringLiteral("job-%1").arg(index, 6, 10, QChar('0'));
+}
+
+} // namespace bench
+} // namespace gwt
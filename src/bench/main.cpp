@@ -0,0 +1,356 @@
+#include "bench/WorkflowGenerator.h"
+#include "backends/SimulatedBackend.h"
+#include "core/JobExecutor.h"
+#include "core/JobGraph.h"
+#include "core/MatrixStrategy.h"
+#include "core/ResourceBudget.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <climits>
+#include <memory>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+using namespace gwt;
+
+namespace {
+
+struct BenchOptions {
+    QStringList scenarios;
+    int size = 1000;
+    int steps = 3;
+    int jobs = 256;
+    quint32 seed = 1;
+    bool graphOnly = false;
+    backends::SimulationProfile profile;
+};
+
+struct BenchResult {
+    int jobs = 0;
+    bool success = false;
+    qint64 wallMs = 0;
+    double cpuMs = 0;
+    double overheadUs = 0;
+    qint64 peakRssKb = 0;
+};
+
+struct GraphResult {
+    int jobs = 0;
+    int edges = 0;
+    bool success = false;
+    double buildMs = 0;
+    double drainMs = 0;
+    qint64 peakRssKb = 0;
+};
+
+/**
+ * @brief Get the CPU time used by the process so far
+ * @return Milliseconds of user and system time
+ */
+double processCpuMs() {
+#ifdef Q_OS_UNIX
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0
+        + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Reset the peak resident set size so each scenario is measured alone
+ *
+ * Only supported on Linux; elsewhere the peak accumulates across scenarios.
+ */
+void resetPeakRss() {
+    QFile file("/proc/self/clear_refs");
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write("5");
+    }
+}
+
+/**
+ * @brief Get the peak resident set size of the process
+ * @return Kilobytes, or 0 if unknown
+ */
+qint64 peakRssKb() {
+    QFile status("/proc/self/status");
+    if (status.open(QIODevice::ReadOnly)) {
+        while (!status.atEnd()) {
+            QByteArray line = status.readLine();
+            if (line.startsWith("VmHWM:")) {
+                return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+            }
+        }
+    }
+#ifdef Q_OS_UNIX
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef Q_OS_MACOS
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Compile the job graph of a scenario and resolve every job in dependency order
+ *
+ * Measures the scheduler's graph bookkeeping alone, without backends,
+ * signals or the run journal.
+ */
+GraphResult runGraphScenario(const core::Workflow& workflow) {
+    QMap<QString, core::WorkflowJob> jobs = core::MatrixStrategy().expandJobs(workflow.jobs);
+
+    resetPeakRss();
+    QElapsedTimer timer;
+    timer.start();
+
+    core::JobGraph graph;
+    graph.build(jobs);
+    qint64 buildNs = timer.nsecsElapsed();
+
+    // Resolving appends newly ready jobs to the list being walked
+    std::vector<int> ready = graph.roots();
+    std::vector<int> skipped;
+    for (size_t next = 0; next < ready.size(); ++next) {
+        graph.resolve(ready[next], true, ready, skipped);
+    }
+
+    GraphResult result;
+    result.drainMs = (timer.nsecsElapsed() - buildNs) / 1e6;
+    result.buildMs = buildNs / 1e6;
+    result.jobs = graph.size();
+    for (int i = 0; i < graph.size(); ++i) {
+        result.edges += graph.dependents(i).size();
+    }
+    result.success = graph.resolvedCount() == graph.size();
+    result.peakRssKb = peakRssKb();
+    return result;
+}
+
+/**
+ * @brief Run one scenario to completion on simulated backends
+ */
+BenchResult runScenario(const core::Workflow& workflow, const BenchOptions& options) {
+    BenchResult result;
+    result.jobs = static_cast<int>(core::MatrixStrategy().expandJobs(workflow.jobs).size());
+
+    core::ResourceBudget budget(options.jobs);
+    core::JobExecutor executor;
+    executor.setMaxParallelJobs(options.jobs);
+    executor.setResourceBudget(&budget);
+
+    quint32 seed = options.seed;
+    backends::SimulationProfile profile = options.profile;
+    executor.setBackendFactory([profile, &seed]() {
+        return std::make_unique<backends::SimulatedBackend>(profile, seed++);
+    });
+
+    QEventLoop loop;
+    QObject::connect(&executor, &core::JobExecutor::executionFinished,
+                     &loop, [&loop, &result](bool success) {
+        result.success = success;
+        loop.quit();
+    });
+    QObject::connect(&executor, &core::JobExecutor::error, [](const QString& message) {
+        QTextStream(stderr) << "Error: " << message << Qt::endl;
+    });
+
+    resetPeakRss();
+    qint64 spinStart = backends::SimulatedBackend::totalSpinNs();
+    double cpuStart = processCpuMs();
+    QElapsedTimer wall;
+    wall.start();
+
+    if (executor.executeWorkflow(workflow, "push")) {
+        loop.exec();
+    }
+
+    result.wallMs = wall.elapsed();
+    result.cpuMs = processCpuMs() - cpuStart;
+    result.peakRssKb = peakRssKb();
+
+    // Spinning stands in for work done by the steps, not by the scheduler
+    double spinMs = (backends::SimulatedBackend::totalSpinNs() - spinStart) / 1e6;
+    result.overheadUs = result.jobs > 0
+        ? qMax(0.0, result.cpuMs - spinMs) * 1000.0 / result.jobs
+        : 0;
+    return result;
+}
+
+void printUsage(QTextStream& out) {
+    out << "Usage: gwt_bench [options]" << Qt::endl;
+    out << Qt::endl;
+    out << "Runs synthetic workflows on simulated backends and reports scheduler cost." << Qt::endl;
+    out << Qt::endl;
+    out << "Options:" << Qt::endl;
+    out << "  --scenario NAME      fanout, chain, random, matrix or all (default: all)" << Qt::endl;
+    out << "  --size N             Approximate number of jobs (default: 1000)" << Qt::endl;
+    out << "  --steps N            Steps per job (default: 3)" << Qt::endl;
+    out << "  --jobs N             Jobs running at the same time (default: 256)" << Qt::endl;
+    out << "  --step-ms MS         Mean simulated step duration (default: 0)" << Qt::endl;
+    out << "  --distribution NAME  fixed, uniform, exponential or lognormal (default: fixed)" << Qt::endl;
+    out << "  --failure-rate P     Probability that a step fails (default: 0)" << Qt::endl;
+    out << "  --spin               Busy-wait during steps instead of sleeping" << Qt::endl;
+    out << "  --seed N             Seed of the random DAG and durations (default: 1)" << Qt::endl;
+    out << "  --graph-only         Only compile and resolve the job graph, without backends" << Qt::endl;
+}
+
+/**
+ * @brief Parse the command line
+ * @return false if an option is invalid
+ */
+bool parseOptions(const QStringList& args, BenchOptions& options, QTextStream& err) {
+    options.scenarios = bench::WorkflowGenerator::scenarios();
+
+    for (int i = 0; i < args.size(); ++i) {
+        const QString& arg = args[i];
+        QString value = args.value(i + 1);
+        bool ok = true;
+
+        if (arg == "--scenario") {
+            if (value != "all") {
+                if (!bench::WorkflowGenerator::scenarios().contains(value)) {
+                    err << "Error: unknown scenario " << value << Qt::endl;
+                    return false;
+                }
+                options.scenarios = QStringList{value};
+            }
+            ++i;
+        } else if (arg == "--size") {
+            options.size = value.toInt(&ok);
+            ok = ok && options.size > 0;
+            ++i;
+        } else if (arg == "--steps") {
+            options.steps = value.toInt(&ok);
+            ok = ok && options.steps > 0;
+            ++i;
+        } else if (arg == "--jobs") {
+            options.jobs = value.toInt(&ok);
+            ok = ok && options.jobs > 0;
+            ++i;
+        } else if (arg == "--step-ms") {
+            options.profile.meanStepMs = value.toDouble(&ok);
+            ok = ok && options.profile.meanStepMs >= 0;
+            ++i;
+        } else if (arg == "--failure-rate") {
+            options.profile.failureRate = value.toDouble(&ok);
+            ok = ok && options.profile.failureRate >= 0 && options.profile.failureRate <= 1;
+            ++i;
+        } else if (arg == "--distribution") {
+            using Distribution = backends::SimulationProfile::Distribution;
+            if (value == "fixed") {
+                options.profile.distribution = Distribution::Fixed;
+            } else if (value == "uniform") {
+                options.profile.distribution = Distribution::Uniform;
+            } else if (value == "exponential") {
+                options.profile.distribution = Distribution::Exponential;
+            } else if (value == "lognormal") {
+                options.profile.distribution = Distribution::LogNormal;
+            } else {
+                ok = false;
+            }
+            ++i;
+        } else if (arg == "--graph-only") {
+            options.graphOnly = true;
+        } else if (arg == "--spin") {
+            options.profile.spin = true;
+        } else if (arg == "--seed") {
+            options.seed = value.toUInt(&ok);
+            ++i;
+        } else {
+            err << "Error: unknown option " << arg << Qt::endl;
+            return false;
+        }
+
+        if (!ok) {
+            err << "Error: invalid value for " << arg << Qt::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // Keep history, journals and config of the benchmark away from the user's
+    QTemporaryDir home;
+    qputenv("XDG_CACHE_HOME", home.filePath("cache").toLocal8Bit());
+    qputenv("XDG_CONFIG_HOME", home.filePath("config").toLocal8Bit());
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("GithubWorkflowTool");
+    app.setApplicationVersion("0.1.0");
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QStringList args = app.arguments();
+    args.removeFirst(); // Remove program name
+
+    if (args.contains("--help") || args.contains("-h")) {
+        printUsage(out);
+        return 0;
+    }
+
+    BenchOptions options;
+    if (!parseOptions(args, options, err)) {
+        return 1;
+    }
+
+    bench::WorkflowGenerator generator(options.steps, options.seed);
+
+    if (options.graphOnly) {
+        out << QString("%1 %2 %3 %4 %5 %6 %7")
+            .arg("scenario", -10).arg("jobs", 8).arg("edges", 8).arg("build ms", 10)
+            .arg("drain ms", 10).arg("ns/job", 10).arg("peak RSS KiB", 14) << Qt::endl;
+
+        bool allResolved = true;
+        for (const QString& scenario : options.scenarios) {
+            GraphResult result = runGraphScenario(generator.generate(scenario, options.size));
+            allResolved = allResolved && result.success;
+            double nsPerJob = result.jobs > 0
+                ? (result.buildMs + result.drainMs) * 1e6 / result.jobs
+                : 0;
+
+            out << QString("%1 %2 %3 %4 %5 %6 %7%8")
+                .arg(scenario, -10).arg(result.jobs, 8).arg(result.edges, 8)
+                .arg(result.buildMs, 10, 'f', 2).arg(result.drainMs, 10, 'f', 2)
+                .arg(nsPerJob, 10, 'f', 0).arg(result.peakRssKb, 14)
+                .arg(result.success ? "" : "  (unresolved)") << Qt::endl;
+        }
+        return allResolved ? 0 : 1;
+    }
+
+    out << QString("%1 %2 %3 %4 %5 %6")
+        .arg("scenario", -10).arg("jobs", 8).arg("wall ms", 10)
+        .arg("cpu ms", 10).arg("us/job", 10).arg("peak RSS KiB", 14) << Qt::endl;
+
+    bool allSucceeded = true;
+    for (const QString& scenario : options.scenarios) {
+        BenchResult result = runScenario(generator.generate(scenario, options.size), options);
+        allSucceeded = allSucceeded && (result.success || options.profile.failureRate > 0);
+
+        out << QString("%1 %2 %3 %4 %5 %6%7")
+            .arg(scenario, -10).arg(result.jobs, 8).arg(result.wallMs, 10)
+            .arg(result.cpuMs, 10, 'f', 1).arg(result.overheadUs, 10, 'f', 1)
+            .arg(result.peakRssKb, 14)
+            .arg(result.success ? "" : "  (failed)") << Qt::endl;
+    }
+
+    return allSucceeded ? 0 : 1;
+}
@@ -1,18 +1,153 @@
 #include "cli/CommandHandler.h"
+#include "backends/ContainerPool.h"
+#include "backends/EngineClient.h"
+#include "backends/ImagePrefetcher.h"
+#include "backends/QemuBackend.h"
+#include "backends/VmPool.h"
 #include "core/RepoManager.h"
 #include "core/JobExecutor.h"
+#include "core/LocalConfig.h"
+#include "core/ResourceBudget.h"
+#include "core/RunJournal.h"
+#include "core/RuntimeCapabilities.h"
+#include "core/WorkerCoordinator.h"
+#include "core/WorkerProtocol.h"
+#include "core/WorkerSession.h"
 #include "core/WorkflowDiscovery.h"
 #include "core/WorkflowParser.h"
 #include <QCoreApplication>
+#include <QEventLoop>
 #include <QTextStream>
 #include <QDebug>
-#include <QProcess>
 #include <QFile>
 #include <QFileInfo>
+#include <QThread>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <QSocketNotifier>
+#include <csignal>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 namespace gwt {
 namespace cli {
 
+namespace {
+
+#ifdef Q_OS_UNIX
+int s_interruptFds[2] = {-1, -1};
+
+void onInterruptSignal(int) {
+    // Only async-signal-safe calls here; the event loop picks the byte up
+    char byte = 1;
+    ssize_t written = ::write(s_interruptFds[0], &byte, 1);
+    Q_UNUSED(written);
+}
+#endif
+
+/**
+ * @brief Call a handler from the event loop on the first SIGINT or SIGTERM
+ *
+ * The signal handlers reset themselves, so a second Ctrl+C terminates the
+ * process right away.
+ */
+void watchInterrupts(QObject* context, const std::function<void()>& onInterrupt) {
+#ifdef Q_OS_UNIX
+    if (s_interruptFds[0] == -1 && ::socketpair(AF_UNIX, SOCK_STREAM, 0, s_interruptFds) != 0) {
+        return;
+    }
+    
+    QSocketNotifier* notifier = new QSocketNotifier(s_interruptFds[1], QSocketNotifier::Read, context);
+    QObject::connect(notifier, &QSocketNotifier::activated, context, [onInterrupt]() {
+        char byte;
+        if (::read(s_interruptFds[1], &byte, 1) == 1) {
+            onInterrupt();
+        }
+    });
+    
+    struct sigaction action = {};
+    action.sa_handler = onInterruptSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART | SA_RESETHAND;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+#else
+    Q_UNUSED(context);
+    Q_UNUSED(onInterrupt);
+#endif
+}
+
+/**
+ * @brief Get the backend selected by --qemu or --namespace
+ */
+backends::BackendType backendTypeFromArgs(const QStringList& args) {
+    if (args.contains("--qemu")) {
+        return backends::BackendType::Qemu;
+    }
+    if (args.contains("--namespace")) {
+        return backends::BackendType::Namespace;
+    }
+    return backends::BackendType::Container;
+}
+
+/**
+ * @brief Print the resources each job used, one row per job
+ */
+void printResourceTable(QTextStream& out, const std::vector<std::pair<QString, core::ResourceUsage>>& jobs) {
+    int nameWidth = 3;
+    for (const auto& job : jobs) {
+        nameWidth = qMax(nameWidth, static_cast<int>(job.first.size()));
+    }
+    
+    out << Qt::endl << "Resources (stall = time tasks waited for CPU, memory or IO):" << Qt::endl;
+    out << QString("  %1 %2 %3 %4 %5 %6 %7 %8")
+        .arg(QString("Job"), -nameWidth).arg(QString("CPU s"), 8).arg(QString("Peak MiB"), 9)
+        .arg(QString("Read MiB"), 9).arg(QString("Write MiB"), 9).arg(QString("CPU stall"), 10)
+        .arg(QString("Mem stall"), 10).arg(QString("IO stall"), 10) << Qt::endl;
+    for (const auto& job : jobs) {
+        const core::ResourceUsage& usage = job.second;
+        out << QString("  %1 %2 %3 %4 %5 %6 %7 %8")
+            .arg(job.first, -nameWidth)
+            .arg(usage.cpuSeconds, 8, 'f', 1)
+            .arg(usage.peakMemoryBytes >> 20, 9)
+            .arg(usage.ioReadBytes >> 20, 9)
+            .arg(usage.ioWriteBytes >> 20, 9)
+            .arg(usage.cpuStallSeconds, 10, 'f', 1)
+            .arg(usage.memoryStallSeconds, 10, 'f', 1)
+            .arg(usage.ioStallSeconds, 10, 'f', 1) << Qt::endl;
+    }
+}
+
+/**
+ * @brief Print how QEMU jobs got their VMs from the pool
+ */
+void printVmPoolStats(QTextStream& out, const backends::VmPool::Stats& stats) {
+    int jobs = stats.hits + stats.partialHits + stats.misses;
+    if (jobs == 0) {
+        return;
+    }
+    out << QString("VM pool: %1 ready, %2 still starting, %3 missed; %4 s waiting for VMs (%5 s per job)")
+        .arg(stats.hits).arg(stats.partialHits).arg(stats.misses)
+        .arg(stats.waitMs / 1000.0, 0, 'f', 1)
+        .arg(stats.waitMs / 1000.0 / jobs, 0, 'f', 1) << Qt::endl;
+}
+
+/**
+ * @brief Restore the default SIGINT and SIGTERM behaviour
+ */
+void unwatchInterrupts() {
+#ifdef Q_OS_UNIX
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+#endif
+}
+
+} // namespace
+
 CommandHandler::CommandHandler(QObject* parent)
     : QObject(parent)
     , m_repoManager(std::make_unique<core::RepoManager>())
@@ -36,6 +171,10 @@ int CommandHandler::execute(const QStringList& args) {
         return handleList(args.mid(1));
     } else if (command == "run") {
         return handleRun(args.mid(1));
+    } else if (command == "run-all") {
+        return handleRunAll(args.mid(1));
+    } else if (command == "worker") {
+        return handleWorker(args.mid(1));
     } else if (command == "workflows") {
         return handleWorkflows(args.mid(1));
     } else if (command == "doctor") {
@@ -59,6 +198,9 @@ void CommandHandler::printHelp() const {
     out << "  list               List cloned repositories" << Qt::endl;
     out << "  workflows <repo>   List workflows in a repository" << Qt::endl;
     out << "  run <repo> <wf>    Run a workflow" << Qt::endl;
+    out << "  run --resume <id>  Re-run the failed and unfinished jobs of a run" << Qt::endl;
+    out << "  run-all <repo>     Run all workflows of a repository concurrently" << Qt::endl;
+    out << "  worker             Run jobs for a `gwt run --workers` coordinator" << Qt::endl;
     out << "  doctor [workflow]  Check system and workflow compatibility" << Qt::endl;
     out << "  help               Show this help message" << Qt::endl;
     out << Qt::endl;
@@ -75,7 +217,22 @@ int CommandHandler::handleClone(const QStringList& args) {
     QTextStream out(stdout);
     out << "Cloning repository: " << repoUrl << Qt::endl;
     
+    QEventLoop loop;
+    bool success = false;
+    connect(m_repoManager.get(), &core::RepoManager::error, &loop, [](const QString& message) {
+        QTextStream err(stderr);
+        err << message << Qt::endl;
+    });
+    connect(m_repoManager.get(), &core::RepoManager::cloneFinished, &loop, [&](bool cloned) {
+        success = cloned;
+        loop.quit();
+    });
+    
     if (m_repoManager->cloneRepository(repoUrl)) {
+        loop.exec();
+    }
+    
+    if (success) {
         out << "Successfully cloned to: " << m_repoManager->getLocalPath(repoUrl) << Qt::endl;
         return 0;
     } else {
@@ -100,15 +257,38 @@ int CommandHandler::handleList(const QStringList& args) {
 }
 
 int CommandHandler::handleRun(const QStringList& args) {
-    if (args.size() < 2) {
+    QString resumeRunId;
+    int resumeIndex = args.indexOf("--resume");
+    if (resumeIndex != -1) {
+        resumeRunId = args.value(resumeIndex + 1);
+        if (resumeRunId.isEmpty() || resumeRunId.startsWith("--")) {
+            QTextStream err(stderr);
+            err << "Error: --resume requires a run id" << Qt::endl;
+            return 1;
+        }
+    }
+    
+    QString repoPath;
+    QString workflowFile;
+    if (args.size() >= 2 && !args[0].startsWith("--") && !args[1].startsWith("--")) {
+        repoPath = args[0];
+        workflowFile = args[1];
+    } else if (!resumeRunId.isEmpty()) {
+        // The journal remembers what the resumed run was started with
+        core::RunJournal journal;
+        if (!journal.load(resumeRunId)) {
+            QTextStream err(stderr);
+            err << "Error: No journal found for run " << resumeRunId << Qt::endl;
+            return 1;
+        }
+        repoPath = journal.repositoryPath();
+        workflowFile = journal.workflowFile();
+    } else {
         QTextStream err(stderr);
         err << "Error: Repository path and workflow file required" << Qt::endl;
         return 1;
     }
     
-    QString repoPath = args[0];
-    QString workflowFile = args[1];
-    
     QTextStream out(stdout);
     out << "Running workflow: " << workflowFile << Qt::endl;
     
@@ -125,16 +305,369 @@ int CommandHandler::handleRun(const QStringList& args) {
         return 1;
     }
     
+    int jobsIndex = args.indexOf("--jobs");
+    if (jobsIndex != -1) {
+        bool ok = false;
+        int jobs = args.value(jobsIndex + 1).toInt(&ok);
+        if (!ok || jobs < 1) {
+            QTextStream err(stderr);
+            err << "Error: --jobs requires a positive number" << Qt::endl;
+            return 1;
+        }
+        m_executor->setMaxParallelJobs(jobs);
+    }
+    
+    m_executor->setRepositoryPath(repoPath);
+    m_executor->setIncremental(args.contains("--incremental"));
+    m_executor->setResumeRunId(resumeRunId);
+    
+    // With --workers, jobs go to `gwt worker` processes whose slots limit concurrency
+    std::unique_ptr<core::WorkerCoordinator> coordinator;
+    if (args.contains("--workers")) {
+        int socketIndex = args.indexOf("--socket");
+        QString socketPath = socketIndex != -1 ? args.value(socketIndex + 1) : core::protocol::defaultSocketPath();
+        
+        coordinator = std::make_unique<core::WorkerCoordinator>();
+        connect(coordinator.get(), &core::WorkerCoordinator::error, this, [](const QString& message) {
+            QTextStream err(stderr);
+            err << "Error: " << message << Qt::endl;
+        });
+        connect(coordinator.get(), &core::WorkerCoordinator::workerConnected, this,
+                [&out](const QString& name, int slotCount) {
+            out << "Worker " << name << " connected with " << slotCount << " slots" << Qt::endl;
+        });
+        connect(coordinator.get(), &core::WorkerCoordinator::workerDisconnected, this,
+                [&out](const QString& name) {
+            out << "Worker " << name << " disconnected" << Qt::endl;
+        });
+        
+        if (!coordinator->listen(socketPath)) {
+            return 1;
+        }
+        out << "Waiting for workers on " << socketPath << Qt::endl;
+        
+        if (jobsIndex == -1) {
+            m_executor->setMaxParallelJobs(std::numeric_limits<int>::max());
+        }
+    }
+    m_executor->setWorkerCoordinator(coordinator.get());
+    
+    // Without --warm the executor keeps the pools configured in config.yml;
+    // with --qemu it sizes the VM pool instead of the container pool
+    backends::BackendType backendType = backendTypeFromArgs(args);
+    std::unique_ptr<backends::ContainerPool> pool;
+    std::unique_ptr<backends::VmPool> vmPool;
+    int warmIndex = args.indexOf("--warm");
+    if (warmIndex != -1) {
+        bool ok = false;
+        int warm = args.value(warmIndex + 1).toInt(&ok);
+        if (!ok || warm < 0) {
+            QTextStream err(stderr);
+            err << "Error: --warm requires a number of containers or VMs" << Qt::endl;
+            return 1;
+        }
+        auto reportError = [](const QString& message) {
+            QTextStream err(stderr);
+            err << "Error: " << message << Qt::endl;
+        };
+        if (backendType == backends::BackendType::Qemu) {
+            vmPool = std::make_unique<backends::VmPool>(warm);
+            connect(vmPool.get(), &backends::VmPool::error, this, reportError);
+        } else {
+            pool = std::make_unique<backends::ContainerPool>(warm);
+            connect(pool.get(), &backends::ContainerPool::error, this, reportError);
+        }
+    }
+    m_executor->setContainerPool(pool.get());
+    m_executor->setVmPool(vmPool.get());
+    
     // Execute workflow
-    bool useQemu = args.contains("--qemu");
-    if (m_executor->executeWorkflow(workflow, "push", useQemu)) {
+    QEventLoop loop;
+    bool success = false;
+    connect(m_executor.get(), &core::JobExecutor::executionFinished, &loop, [&](bool finished) {
+        success = finished;
+        loop.quit();
+    });
+    connect(m_executor.get(), &core::JobExecutor::executionStopped, &loop, [&](qint64 elapsedMs) {
+        out << "Cancelled in " << elapsedMs << " ms" << Qt::endl;
+    });
+    connect(m_executor.get(), &core::JobExecutor::stepOutput, &loop,
+            [&out](const QString& jobId, const QString&, const QString& output) {
+        // Output arrives in line batches while the step runs; blank lines
+        // inside a batch are kept, the newline ending it is not a line
+        QString lines = output.endsWith('\n') ? output.chopped(1) : output;
+        for (const QString& line : lines.split('\n')) {
+            out << "[" << jobId << "] " << line << '\n';
+        }
+        out.flush();
+    });
+    connect(m_executor.get(), &core::JobExecutor::imageProgress, &loop,
+            [&out](const QString& image, const QString& status) {
+        out << "[pull " << image << "] " << status << Qt::endl;
+    });
+    std::vector<std::pair<QString, core::ResourceUsage>> jobResources;
+    connect(m_executor.get(), &core::JobExecutor::jobResources, &loop,
+            [&jobResources](const QString& jobId, const core::ResourceUsage& usage) {
+        jobResources.emplace_back(jobId, usage);
+    });
+    
+    if (!m_executor->executeWorkflow(workflow, "push", backendType)) {
+        QTextStream err(stderr);
+        err << "Workflow execution failed" << Qt::endl;
+        return 1;
+    }
+    
+    out << "Run ID: " << m_executor->runId() << Qt::endl;
+    
+    watchInterrupts(&loop, [&]() {
+        out << "Interrupted, stopping running jobs (press Ctrl+C again to quit now)" << Qt::endl;
+        m_executor->stopExecution();
+    });
+    loop.exec();
+    unwatchInterrupts();
+    
+    if (!jobResources.empty()) {
+        printResourceTable(out, jobResources);
+    }
+    if (backends::VmPool* usedVmPool = m_executor->vmPool()) {
+        printVmPoolStats(out, usedVmPool->stats());
+    }
+    
+    if (success) {
         out << "Workflow execution completed" << Qt::endl;
         return 0;
     } else {
         QTextStream err(stderr);
         err << "Workflow execution failed" << Qt::endl;
+        err << "Re-run failed jobs with: gwt run --resume " << m_executor->runId() << Qt::endl;
+        return 1;
+    }
+}
+
+int CommandHandler::handleRunAll(const QStringList& args) {
+    if (args.isEmpty() || args[0].startsWith("--")) {
+        QTextStream err(stderr);
+        err << "Error: Repository path required" << Qt::endl;
+        return 1;
+    }
+    
+    QString repoPath = args[0];
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    
+    int maxJobs = qMax(1, QThread::idealThreadCount());
+    int jobsIndex = args.indexOf("--jobs");
+    if (jobsIndex != -1) {
+        bool ok = false;
+        maxJobs = args.value(jobsIndex + 1).toInt(&ok);
+        if (!ok || maxJobs < 1) {
+            err << "Error: --jobs requires a positive number" << Qt::endl;
+            return 1;
+        }
+    }
+    
+    // The local config can shrink the host capacity; flags win over both
+    core::LocalConfig config;
+    if (!config.load()) {
+        for (const QString& error : config.getErrors()) {
+            err << "Config: " << error << Qt::endl;
+        }
+    }
+    core::ResourceReservation capacity = config.hostCapacity();
+    
+    int cpusIndex = args.indexOf("--cpus");
+    if (cpusIndex != -1) {
+        bool ok = false;
+        capacity.cpus = args.value(cpusIndex + 1).toDouble(&ok);
+        if (!ok || capacity.cpus <= 0) {
+            err << "Error: --cpus requires a positive number" << Qt::endl;
+            return 1;
+        }
+    }
+    
+    int memoryIndex = args.indexOf("--memory");
+    if (memoryIndex != -1) {
+        capacity.memoryBytes = core::LocalConfig::parseMemorySize(args.value(memoryIndex + 1));
+        if (capacity.memoryBytes <= 0) {
+            err << "Error: --memory requires a size such as 8G or 512M" << Qt::endl;
+            return 1;
+        }
+    }
+    
+    // --warm sizes the pool of the backend the jobs run on
+    backends::BackendType backendType = backendTypeFromArgs(args);
+    bool qemu = backendType == backends::BackendType::Qemu;
+    int warm = qemu ? config.vmPoolSize() : config.containerPoolSize();
+    int warmIndex = args.indexOf("--warm");
+    if (warmIndex != -1) {
+        bool ok = false;
+        warm = args.value(warmIndex + 1).toInt(&ok);
+        if (!ok || warm < 0) {
+            err << "Error: --warm requires a number of containers or VMs" << Qt::endl;
+            return 1;
+        }
+    }
+    
+    core::WorkflowDiscovery discovery;
+    QStringList workflowFiles = discovery.discoverWorkflows(repoPath);
+    if (workflowFiles.isEmpty()) {
+        err << "Error: No workflows found in " << repoPath << Qt::endl;
         return 1;
     }
+    
+    // All workflows draw their jobs from one budget and one pool, and share
+    // the pulls of the images they have in common
+    core::ResourceBudget budget(maxJobs, capacity);
+    backends::ImagePrefetcher prefetcher;
+    backends::ContainerPool pool(qemu ? 0 : warm);
+    backends::VmPool vmPool(qemu ? warm : 0);
+    auto reportError = [&err](const QString& message) {
+        err << "Error: " << message << Qt::endl;
+    };
+    connect(&pool, &backends::ContainerPool::error, this, reportError);
+    connect(&vmPool, &backends::VmPool::error, this, reportError);
+    connect(&prefetcher, &backends::ImagePrefetcher::progress, this,
+            [&out](const QString& image, const QString& status) {
+        out << "[pull " << image << "] " << status << Qt::endl;
+    });
+    out << "Running " << workflowFiles.size() << " workflows with up to " << maxJobs << " concurrent jobs";
+    if (capacity.cpus > 0) {
+        out << ", " << capacity.cpus << " CPUs";
+    }
+    if (capacity.memoryBytes > 0) {
+        out << ", " << (capacity.memoryBytes >> 20) << " MiB of memory";
+    }
+    out << Qt::endl;
+    
+    QEventLoop loop;
+    std::vector<std::unique_ptr<core::JobExecutor>> executors;
+    QMap<QString, bool> results;
+    int remaining = 0;
+    
+    for (const QString& workflowFile : workflowFiles) {
+        QString name = QFileInfo(workflowFile).fileName();
+        
+        core::WorkflowParser parser;
+        core::Workflow workflow = parser.parse(workflowFile);
+        if (parser.hasErrors()) {
+            err << "[" << name << "] Workflow parsing errors:" << Qt::endl;
+            for (const QString& error : parser.getErrors()) {
+                err << "  " << error << Qt::endl;
+            }
+            results[name] = false;
+            continue;
+        }
+        
+        auto executor = std::make_unique<core::JobExecutor>();
+        executor->setMaxParallelJobs(maxJobs);
+        executor->setResourceBudget(&budget);
+        executor->setContainerPool(&pool);
+        executor->setImagePrefetcher(&prefetcher);
+        executor->setVmPool(&vmPool);
+        executor->setRepositoryPath(repoPath);
+        executor->setIncremental(args.contains("--incremental"));
+        
+        connect(executor.get(), &core::JobExecutor::jobFinished, &loop,
+                [&out, name](const QString& jobId, bool success) {
+            out << "[" << name << "] " << jobId << (success ? " succeeded" : " failed") << Qt::endl;
+        });
+        connect(executor.get(), &core::JobExecutor::error, &loop,
+                [&err, name](const QString& message) {
+            err << "[" << name << "] " << message << Qt::endl;
+        });
+        connect(executor.get(), &core::JobExecutor::executionFinished, &loop,
+                [&, name](bool success) {
+            results[name] = success;
+            if (--remaining == 0) {
+                loop.quit();
+            }
+        });
+        
+        ++remaining;
+        if (executor->executeWorkflow(workflow, "push", backendType)) {
+            out << "[" << name << "] Run ID: " << executor->runId() << Qt::endl;
+        } else {
+            --remaining;
+            results[name] = false;
+        }
+        executors.push_back(std::move(executor));
+    }
+    
+    if (remaining > 0) {
+        watchInterrupts(&loop, [&]() {
+            out << "Interrupted, stopping running jobs (press Ctrl+C again to quit now)" << Qt::endl;
+            for (const auto& executor : executors) {
+                executor->stopExecution();
+            }
+        });
+        loop.exec();
+        unwatchInterrupts();
+    }
+    
+    int failed = 0;
+    out << Qt::endl << "Summary:" << Qt::endl;
+    for (auto it = results.begin(); it != results.end(); ++it) {
+        out << "  " << (it.value() ? "PASS  " : "FAIL  ") << it.key() << Qt::endl;
+        if (!it.value()) {
+            ++failed;
+        }
+    }
+    out << Qt::endl << (results.size() - failed) << " passed, " << failed << " failed" << Qt::endl;
+    if (qemu && warm > 0) {
+        printVmPoolStats(out, vmPool.stats());
+    }
+    
+    return failed == 0 ? 0 : 1;
+}
+
+int CommandHandler::handleWorker(const QStringList& args) {
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    
+    int slotCount = 1;
+    int slotsIndex = args.indexOf("--slots");
+    if (slotsIndex != -1) {
+        bool ok = false;
+        slotCount = args.value(slotsIndex + 1).toInt(&ok);
+        if (!ok || slotCount < 1) {
+            err << "Error: --slots requires a positive number" << Qt::endl;
+            return 1;
+        }
+    }
+    
+    int socketIndex = args.indexOf("--socket");
+    QString socketPath = socketIndex != -1 ? args.value(socketIndex + 1) : core::protocol::defaultSocketPath();
+    
+    core::WorkerSession session(slotCount);
+    QEventLoop loop;
+    bool wasConnected = false;
+    
+    connect(&session, &core::WorkerSession::connected, &loop, [&]() {
+        wasConnected = true;
+        out << "Connected to " << socketPath << " with " << slotCount << " slots" << Qt::endl;
+    });
+    connect(&session, &core::WorkerSession::leaseStarted, &loop, [&out](qint64 leaseId, const QString& runsOn) {
+        out << "Lease " << leaseId << ": preparing " << runsOn << Qt::endl;
+    });
+    connect(&session, &core::WorkerSession::leaseFinished, &loop, [&out](qint64 leaseId) {
+        out << "Lease " << leaseId << ": finished" << Qt::endl;
+    });
+    connect(&session, &core::WorkerSession::error, &loop, [&err](const QString& message) {
+        err << "Error: " << message << Qt::endl;
+    });
+    connect(&session, &core::WorkerSession::finished, &loop, &QEventLoop::quit);
+    
+    session.connectToCoordinator(socketPath);
+    
+    // Leaving the loop destroys the session, which removes its environments
+    watchInterrupts(&loop, [&]() {
+        out << "Interrupted, removing environments" << Qt::endl;
+        loop.quit();
+    });
+    loop.exec();
+    unwatchInterrupts();
+    
+    return wasConnected ? 0 : 1;
 }
 
 int CommandHandler::handleWorkflows(const QStringList& args) {
@@ -170,39 +703,28 @@ int CommandHandler::handleDoctor(const QStringList& args) {
     // Check backend availability
     out << "Backend Availability:" << Qt::endl;
     
-    // Check Docker
-    QProcess dockerCheck;
-    dockerCheck.start("docker", QStringList() << "--version");
-    dockerCheck.waitForFinished(3000);
+    // Always probe afresh, which also refreshes the cache the backends use
+    core::RuntimeCapabilities capabilities = core::RuntimeCapabilities::probe();
+    core::ToolInfo docker = capabilities.docker();
+    core::ToolInfo podman = capabilities.podman();
     
-    if (dockerCheck.exitCode() == 0) {
-        QString dockerVersion = QString::fromUtf8(dockerCheck.readAllStandardOutput()).trimmed();
-        out << "✓ Container backend: Docker detected (" << dockerVersion.split(" ").value(2, "").remove(',') << ")" << Qt::endl;
+    if (docker.available || podman.available) {
+        core::ToolInfo runtime = docker.available ? docker : podman;
+        out << "✓ Container backend: " << (docker.available ? "Docker" : "Podman")
+            << " detected (" << runtime.version << (runtime.rootless ? ", rootless" : "") << ")" << Qt::endl;
     } else {
-        // Try Podman
-        QProcess podmanCheck;
-        podmanCheck.start("podman", QStringList() << "--version");
-        podmanCheck.waitForFinished(3000);
-        
-        if (podmanCheck.exitCode() == 0) {
-            QString podmanVersion = QString::fromUtf8(podmanCheck.readAllStandardOutput()).trimmed();
-            out << "✓ Container backend: Podman detected (" << podmanVersion.split(" ").value(2, "") << ")" << Qt::endl;
-        } else {
-            out << "✗ Container backend: Neither Docker nor Podman found" << Qt::endl;
-            out << "  → Install Docker or Podman for container backend support" << Qt::endl;
-            errors++;
-            issues++;
-        }
+        out << "✗ Container backend: Neither Docker nor Podman found" << Qt::endl;
+        out << "  → Install Docker or Podman for container backend support" << Qt::endl;
+        errors++;
+        issues++;
     }
     
     // Check QEMU
-    QProcess qemuCheck;
-    qemuCheck.start("qemu-system-x86_64", QStringList() << "--version");
-    qemuCheck.waitForFinished(3000);
-    
-    if (qemuCheck.exitCode() == 0) {
-        QString qemuVersion = QString::fromUtf8(qemuCheck.readAllStandardOutput()).split('\n').first().trimmed();
-        out << "✓ QEMU backend: Available (" << qemuVersion.split(" ").value(3, "") << ")" << Qt::endl;
+    core::ToolInfo qemu = capabilities.qemu();
+    if (qemu.available) {
+        out << "✓ QEMU backend: Available (" << qemu.version
+            << (capabilities.hasKvm() ? ", KVM" : ", no KVM") << ")" << Qt::endl;
+        out << "  → Base images are read from " << backends::QemuBackend::imageDirectory() << Qt::endl;
     } else {
         out << "⚠ QEMU backend: Not available" << Qt::endl;
         out << "  → Install QEMU for VM-based execution (optional)" << Qt::endl;
@@ -210,6 +732,25 @@ int CommandHandler::handleDoctor(const QStringList& args) {
         issues++;
     }
     
+    if (capabilities.hasUserNamespaces()) {
+        out << "✓ Namespace backend: Available" << Qt::endl;
+    } else {
+        out << "⚠ Namespace backend: Not available" << Qt::endl;
+        out << "  → Needs unshare and unprivileged user namespaces that can mount overlays (Linux 5.11+)"
+            << Qt::endl;
+        warnings++;
+        issues++;
+    }
+    
+    QString engineSocket = backends::EngineClient::findSocket(capabilities.containerRuntime());
+    out << "• Engine API: " << (engineSocket.isEmpty() ? QString("not reachable, using the CLI") : engineSocket)
+        << Qt::endl;
+    out << "• cgroup v2: " << (capabilities.hasCgroupV2() ? "yes" : "no") << Qt::endl;
+    out << "• systemd user scopes: " << (capabilities.hasUserScopes() ? "yes" : "no") << Qt::endl;
+    core::ToolInfo fuseOverlayfs = capabilities.fuseOverlayfs();
+    out << "• fuse-overlayfs: " << (fuseOverlayfs.available ? fuseOverlayfs.version : QString("no"))
+        << Qt::endl;
+    
     out << Qt::endl;
     
     // Check workflow if provided
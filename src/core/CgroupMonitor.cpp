@@ -0,0 +1,170 @@
+#include "core/CgroupMonitor.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTimer>
+
+namespace gwt {
+namespace core {
+
+namespace {
+
+constexpr const char* CGROUP_ROOT = "/sys/fs/cgroup";
+
+/**
+ * @brief Read a small file of the cgroup filesystem
+ */
+QByteArray readFile(const QString& path, bool* ok = nullptr) {
+    QFile file(path);
+    bool opened = file.open(QIODevice::ReadOnly);
+    if (ok) {
+        *ok = opened;
+    }
+    return opened ? file.readAll() : QByteArray();
+}
+
+} // namespace
+
+void ResourceUsage::accumulate(const ResourceUsage& other) {
+    if (!other.valid) {
+        return;
+    }
+    valid = true;
+    cpuSeconds += other.cpuSeconds;
+    peakMemoryBytes = qMax(peakMemoryBytes, other.peakMemoryBytes);
+    ioReadBytes += other.ioReadBytes;
+    ioWriteBytes += other.ioWriteBytes;
+    cpuStallSeconds += other.cpuStallSeconds;
+    memoryStallSeconds += other.memoryStallSeconds;
+    ioStallSeconds += other.ioStallSeconds;
+}
+
+QString ResourceUsage::summary() const {
+    return QString("CPU %1 s, peak memory %2 MiB, IO %3 MiB read, %4 MiB written, "
+                   "stalled on CPU %5 s, memory %6 s, IO %7 s")
+        .arg(cpuSeconds, 0, 'f', 1)
+        .arg(peakMemoryBytes >> 20)
+        .arg(ioReadBytes >> 20)
+        .arg(ioWriteBytes >> 20)
+        .arg(cpuStallSeconds, 0, 'f', 1)
+        .arg(memoryStallSeconds, 0, 'f', 1)
+        .arg(ioStallSeconds, 0, 'f', 1);
+}
+
+CgroupMonitor::CgroupMonitor(QObject* parent)
+    : QObject(parent)
+    , m_sampleTimer(new QTimer(this))
+    , m_sampledPeak(0)
+{
+    connect(m_sampleTimer, &QTimer::timeout, this, &CgroupMonitor::sampleMemory);
+}
+
+CgroupMonitor::~CgroupMonitor() = default;
+
+void CgroupMonitor::start(const QString& cgroupPath) {
+    m_path = cgroupPath;
+    m_last = readCounters();
+    m_sampledPeak = 0;
+    sampleMemory();
+    m_sampleTimer->start(SAMPLE_INTERVAL_MS);
+}
+
+QString CgroupMonitor::cgroupPath() const {
+    return m_path;
+}
+
+ResourceUsage CgroupMonitor::take() {
+    ResourceUsage usage;
+    if (m_path.isEmpty()) {
+        return usage;
+    }
+
+    sampleMemory();
+    Counters now = readCounters();
+    if (!now.valid || !m_last.valid) {
+        // The cgroup went away with its environment
+        m_sampleTimer->stop();
+        m_last = now;
+        return usage;
+    }
+
+    usage.valid = true;
+    usage.cpuSeconds = (now.cpuUsec - m_last.cpuUsec) / 1e6;
+    usage.ioReadBytes = now.ioReadBytes - m_last.ioReadBytes;
+    usage.ioWriteBytes = now.ioWriteBytes - m_last.ioWriteBytes;
+    usage.cpuStallSeconds = (now.cpuStallUsec - m_last.cpuStallUsec) / 1e6;
+    usage.memoryStallSeconds = (now.memoryStallUsec - m_last.memoryStallUsec) / 1e6;
+    usage.ioStallSeconds = (now.ioStallUsec - m_last.ioStallUsec) / 1e6;
+
+    // A new high-water mark was set in this interval, so it is this interval's peak
+    usage.peakMemoryBytes = now.memoryPeak > m_last.memoryPeak ? now.memoryPeak : m_sampledPeak;
+
+    m_last = now;
+    m_sampledPeak = 0;
+    sampleMemory();
+    return usage;
+}
+
+QString CgroupMonitor::cgroupOfProcess(qint64 pid) {
+    // The unified hierarchy is the "0::" line
+    QByteArray content = readFile(QString("/proc/%1/cgroup").arg(pid));
+    for (const QByteArray& line : content.split('\n')) {
+        if (line.startsWith("0::")) {
+            QString path = QString(CGROUP_ROOT) + QString::fromUtf8(line.mid(3));
+            return QFileInfo::exists(path + "/cgroup.procs") ? path : QString();
+        }
+    }
+    return QString();
+}
+
+CgroupMonitor::Counters CgroupMonitor::readCounters() const {
+    Counters counters;
+
+    QByteArray cpuStat = readFile(m_path + "/cpu.stat", &counters.valid);
+    for (const QByteArray& line : cpuStat.split('\n')) {
+        if (line.startsWith("usage_usec ")) {
+            counters.cpuUsec = line.mid(11).toLongLong();
+        }
+    }
+
+    // One line per device: "8:0 rbytes=... wbytes=... rios=... ..."
+    for (const QByteArray& line : readFile(m_path + "/io.stat").split('\n')) {
+        for (const QByteArray& field : line.split(' ')) {
+            if (field.startsWith("rbytes=")) {
+                counters.ioReadBytes += field.mid(7).toLongLong();
+            } else if (field.startsWith("wbytes=")) {
+                counters.ioWriteBytes += field.mid(7).toLongLong();
+            }
+        }
+    }
+
+    counters.cpuStallUsec = readStallUsec("cpu.pressure");
+    counters.memoryStallUsec = readStallUsec("memory.pressure");
+    counters.ioStallUsec = readStallUsec("io.pressure");
+    counters.memoryPeak = readValue("memory.peak");
+    return counters;
+}
+
+void CgroupMonitor::sampleMemory() {
+    if (!m_path.isEmpty()) {
+        m_sampledPeak = qMax(m_sampledPeak, readValue("memory.current"));
+    }
+}
+
+qint64 CgroupMonitor::readValue(const QString& fileName) const {
+    return readFile(m_path + "/" + fileName).trimmed().toLongLong();
+}
+
+qint64 CgroupMonitor::readStallUsec(const QString& fileName) const {
+    // "some avg10=0.00 avg60=0.00 avg300=0.00 total=12345"
+    for (const QByteArray& line : readFile(m_path + "/" + fileName).split('\n')) {
+        if (!line.startsWith("some ")) {
+            continue;
+        }
+        int total = line.indexOf("total=");
+        return total < 0 ? 0 : line.mid(total + 6).trimmed().toLongLong();
+    }
+    return 0;
+}
+
+} // namespace core
+} // namespace gwt
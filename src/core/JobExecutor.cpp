@@ -1,17 +1,104 @@
 #include "core/JobExecutor.h"
+#include "core/JobHistory.h"
+#include "core/JobLog.h"
+#include "core/JobResultCache.h"
+#include "core/LocalConfig.h"
+#include "core/MatrixStrategy.h"
+#include "core/RepoSnapshot.h"
+#include "core/ResourceBudget.h"
+#include "core/RunJournal.h"
+#include "core/WorkerCoordinator.h"
+#include "core/WorkerProtocol.h"
 #include "backends/ContainerBackend.h"
+#include "backends/ContainerPool.h"
+#include "backends/ImagePrefetcher.h"
+#include "backends/NamespaceBackend.h"
 #include "backends/QemuBackend.h"
+#include "backends/VmPool.h"
+#include "backends/RemoteBackend.h"
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QMap>
 #include <QSet>
 #include <QStringList>
+#include <QThread>
+#include <vector>
 
 namespace gwt {
 namespace core {
 
+namespace {
+
+/**
+ * @brief Rank jobs by the longest path from the job to the end of the graph
+ *
+ * Each job weighs its recorded average duration. Jobs without history weigh
+ * the mean of the known durations, or 1 when nothing is known at all, which
+ * turns the rank into plain DAG depth.
+ */
+std::vector<double> computePriorities(const JobGraph& graph, const JobHistory& history) {
+    std::vector<double> weights(graph.size(), -1.0);
+    double knownTotal = 0.0;
+    int knownCount = 0;
+    for (int i = 0; i < graph.size(); ++i) {
+        qint64 duration = history.averageDuration(graph.jobId(i));
+        if (duration >= 0) {
+            weights[i] = qMax<double>(1.0, duration);
+            knownTotal += duration;
+            ++knownCount;
+        }
+    }
+    const double defaultWeight = knownCount > 0 ? qMax(1.0, knownTotal / knownCount) : 1.0;
+    for (double& weight : weights) {
+        if (weight < 0) {
+            weight = defaultWeight;
+        }
+    }
+
+    // Dependents come later in topological order, so walking it backwards
+    // ranks every job after all of its dependents. Jobs on cycles are not
+    // ordered and keep their own weight; the scheduler reports them.
+    std::vector<double> priorities = weights;
+    std::vector<int> order = graph.topologicalOrder();
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        double downstream = 0.0;
+        for (int dependent : graph.dependents(*it)) {
+            downstream = qMax(downstream, priorities[dependent]);
+        }
+        priorities[*it] = weights[*it] + downstream;
+    }
+
+    return priorities;
+}
+
+} // namespace
+
+struct JobExecutor::JobRun {
+    WorkflowJob job;
+    std::unique_ptr<backends::ExecutionBackend> backend;
+    int stepIndex = 0;
+    bool success = false;
+    bool cancelled = false;
+    bool cleaningUp = false;
+    ResourceReservation reservation;
+    ResourceUsage usage;
+    QString currentStep;
+    JobLog log;
+    QElapsedTimer timer;
+};
+
 JobExecutor::JobExecutor(QObject* parent)
     : QObject(parent)
     , m_running(false)
+    , m_stopRequested(false)
+    , m_success(true)
+    , m_backendType(backends::BackendType::Container)
+    , m_incremental(false)
+    , m_useResultCache(false)
+    , m_maxParallelJobs(qMax(1, QThread::idealThreadCount()))
+    , m_readySequence(0)
+    , m_resultCache(std::make_unique<JobResultCache>())
 {
 }
 
@@ -19,158 +106,713 @@ JobExecutor::~JobExecutor() = default;
 
 bool JobExecutor::executeWorkflow(const Workflow& workflow, 
                                   const QString& triggerEvent,
-                                  bool useQemu) {
+                                  backends::BackendType backendType) {
     if (m_running) {
         emit error("Execution already in progress");
         return false;
     }
     
+    m_readyQueue = std::priority_queue<ReadyJob>();
+    m_jobKeys.clear();
+
+    expandMatrixJobs(workflow);
+
+    // Compile the dependency graph once, so that completing a job only
+    // touches its direct dependents
+    m_graph.build(m_workflow.jobs);
+    std::vector<int> roots = m_graph.roots();
+    if (roots.empty()) {
+        emit error("No runnable jobs found. Check for circular or missing dependencies.");
+        return false;
+    }
+
+    if (m_incremental && m_repositoryPath.isEmpty()) {
+        emit error("Incremental execution requires a repository path");
+        return false;
+    }
+
+    // Resuming appends to the journal of the earlier run
+    m_journal = std::make_unique<RunJournal>();
+    m_resumedJobs.clear();
+    QString runId = m_resumeRunId;
+    m_resumeRunId.clear();
+    if (!runId.isEmpty()) {
+        if (!m_journal->load(runId)) {
+            emit error("No journal found for run " + runId);
+            return false;
+        }
+        if (m_journal->workflowFile() != QFileInfo(workflow.filePath).absoluteFilePath()) {
+            emit error("Run " + runId + " belongs to workflow " + m_journal->workflowFile());
+            return false;
+        }
+        for (const QString& jobId : m_journal->succeededJobs().keys()) {
+            if (m_workflow.jobs.contains(jobId)) {
+                m_resumedJobs.insert(jobId);
+            }
+        }
+    } else {
+        runId = RunJournal::createRunId();
+    }
+
+    if (!m_journal->open(runId)) {
+        emit error("Could not open the journal of run " + runId + ", the run cannot be resumed");
+    }
+    m_journal->recordRunStarted(workflow.filePath, m_repositoryPath, triggerEvent);
+
+    // Job reservations and the host budget may be tuned in the local config
+    m_config = std::make_unique<LocalConfig>();
+    if (!m_config->load()) {
+        for (const QString& message : m_config->getErrors()) {
+            emit error("Config: " + message);
+        }
+    }
+    if (!m_budget) {
+        // Workers admit jobs by their own slots, so only the job count applies
+        ResourceReservation capacity = m_coordinator ? ResourceReservation() : m_config->hostCapacity();
+        m_hostBudget = std::make_unique<ResourceBudget>(m_maxParallelJobs, capacity);
+    }
+
     m_running = true;
-    
-    // Create appropriate backend
-    if (useQemu) {
-        m_backend = std::make_unique<backends::QemuBackend>(this);
+    m_stopRequested = false;
+    m_success = true;
+    m_backendType = backendType;
+    prefetchImages();
+    warmContainerPool();
+    warmVmPool();
+
+    // Start the jobs on the longest remaining path first
+    m_history = std::make_unique<JobHistory>();
+    m_history->load(workflow.filePath);
+    m_priorities = computePriorities(m_graph, *m_history);
+    for (int index : roots) {
+        enqueueJob(index);
+    }
+
+    // Incremental runs need the working tree hashed before any job is keyed,
+    // and cached layers before any job looks one up
+    m_useResultCache = false;
+    bool layerCache = usesLayerCache() && !m_repositoryPath.isEmpty();
+    if (m_incremental || layerCache) {
+        m_snapshot = std::make_unique<RepoSnapshot>();
+        connect(m_snapshot.get(), &RepoSnapshot::error, this, &JobExecutor::error);
+        connect(m_snapshot.get(), &RepoSnapshot::finished, this, [this](bool success) {
+            m_useResultCache = success && m_incremental;
+            if (!success) {
+                emit error(m_incremental ? "Could not snapshot the repository, running all jobs"
+                                         : "Could not snapshot the repository, not using the layer cache");
+            }
+            scheduleJobs();
+        });
+        m_snapshot->capture(m_repositoryPath);
     } else {
-        m_backend = std::make_unique<backends::ContainerBackend>(this);
+        scheduleJobs();
     }
     
-    // Connect backend signals
-    connect(m_backend.get(), &backends::ExecutionBackend::output,
-            [this](const QString& text) {
-        emit stepOutput("", "", text);
-    });
-    
-    // Build dependency graph for gated execution
-    QMap<QString, QStringList> dependencies;
-    QMap<QString, QStringList> dependents;
-    QStringList readyQueue;
-    QSet<QString> queued;
+    return true;
+}
+
+void JobExecutor::stopExecution() {
+    if (!m_running || m_stopRequested) {
+        return;
+    }
+
+    m_stopTimer.start();
+    m_stopRequested = true;
+    m_success = false;
+    m_readyQueue = std::priority_queue<ReadyJob>();
+    for (MatrixGroup& group : m_matrixGroups) {
+        group.parked.clear();
+    }
+
+    // Each killed step fails its job, whose cleanup then runs concurrently
+    // with the others. Copy the runs, as a backend may complete synchronously.
+    std::vector<JobRun*> runs;
+    for (auto& active : m_activeJobs) {
+        runs.push_back(active.second.get());
+    }
+    for (JobRun* run : runs) {
+        cancelRun(*run);
+    }
+
+    if (m_activeJobs.empty()) {
+        finishExecution();
+    }
+}
+
+bool JobExecutor::isRunning() const {
+    return m_running;
+}
+
+void JobExecutor::setMaxParallelJobs(int jobs) {
+    m_maxParallelJobs = qMax(1, jobs);
+}
+
+int JobExecutor::maxParallelJobs() const {
+    return m_maxParallelJobs;
+}
+
+void JobExecutor::setResourceBudget(ResourceBudget* budget) {
+    if (m_budget) {
+        disconnect(m_budget, nullptr, this, nullptr);
+    }
+
+    m_budget = budget;
+    if (m_budget) {
+        connect(m_budget, &ResourceBudget::released, this, [this]() {
+            if (m_running) {
+                scheduleJobs();
+            }
+        });
+    }
+}
+
+void JobExecutor::setBackendFactory(BackendFactory factory) {
+    m_backendFactory = std::move(factory);
+}
+
+void JobExecutor::setContainerPool(backends::ContainerPool* pool) {
+    m_pool = pool;
+}
+
+void JobExecutor::setImagePrefetcher(backends::ImagePrefetcher* prefetcher) {
+    m_prefetcher = prefetcher;
+}
+
+void JobExecutor::setVmPool(backends::VmPool* pool) {
+    m_vmPool = pool;
+}
+
+backends::VmPool* JobExecutor::vmPool() const {
+    if (m_backendFactory || m_coordinator || m_backendType != backends::BackendType::Qemu) {
+        return nullptr;
+    }
+    backends::VmPool* pool = m_vmPool ? m_vmPool.data() : m_ownVmPool.get();
+    return pool && pool->size() > 0 ? pool : nullptr;
+}
+
+void JobExecutor::setWorkerCoordinator(WorkerCoordinator* coordinator) {
+    m_coordinator = coordinator;
+}
+
+ResourceBudget* JobExecutor::activeBudget() const {
+    return m_budget ? m_budget.data() : m_hostBudget.get();
+}
+
+void JobExecutor::setRepositoryPath(const QString& repoPath) {
+    m_repositoryPath = repoPath;
+}
+
+void JobExecutor::setIncremental(bool incremental) {
+    m_incremental = incremental;
+}
+
+void JobExecutor::setResumeRunId(const QString& runId) {
+    m_resumeRunId = runId;
+}
+
+QString JobExecutor::runId() const {
+    return m_journal ? m_journal->runId() : QString();
+}
+
+std::unique_ptr<backends::ExecutionBackend> JobExecutor::createBackend() const {
+    if (m_backendFactory) {
+        return m_backendFactory();
+    }
+    if (m_coordinator) {
+        return std::make_unique<backends::RemoteBackend>(m_coordinator, m_backendType);
+    }
+    if (m_backendType == backends::BackendType::Qemu) {
+        return std::make_unique<backends::QemuBackend>(vmPool());
+    }
+    if (m_backendType == backends::BackendType::Namespace) {
+        return std::make_unique<backends::NamespaceBackend>();
+    }
+    auto backend = std::make_unique<backends::ContainerBackend>(activeContainerPool());
+    backend->setLayerCacheBudget(m_config->layerCacheBudget());
+    return backend;
+}
+
+backends::ContainerPool* JobExecutor::activeContainerPool() const {
+    if (m_backendFactory || m_coordinator || m_backendType != backends::BackendType::Container) {
+        return nullptr;
+    }
+    backends::ContainerPool* pool = m_pool ? m_pool.data() : m_ownPool.get();
+    return pool && pool->size() > 0 ? pool : nullptr;
+}
+
+void JobExecutor::prefetchImages() {
+    // Workers and VMs fetch their own images; namespaces unpack them once
+    if (m_backendFactory || m_coordinator || m_backendType != backends::BackendType::Container) {
+        return;
+    }
+
+    QStringList images;
+    for (const WorkflowJob& job : m_workflow.jobs) {
+        QString image = backends::ContainerBackend::mapRunsOnToImage(job.runsOn);
+        if (!images.contains(image)) {
+            images.append(image);
+        }
+    }
+
+    if (m_prefetcher) {
+        m_prefetcher->prefetch(images);
+        return;
+    }
+
+    // Kept across runs, so a run started while a pull is in flight joins it
+    if (!m_ownPrefetcher) {
+        m_ownPrefetcher = std::make_unique<backends::ImagePrefetcher>();
+        connect(m_ownPrefetcher.get(), &backends::ImagePrefetcher::progress,
+                this, &JobExecutor::imageProgress);
+    }
+    m_ownPrefetcher->prefetch(images);
+}
+
+void JobExecutor::warmContainerPool() {
+    // A private pool outlives the run, so later runs start on warm containers
+    if (!m_pool && m_config->containerPoolSize() > 0
+        && (!m_ownPool || m_ownPool->size() != m_config->containerPoolSize())) {
+        m_ownPool = std::make_unique<backends::ContainerPool>(m_config->containerPoolSize());
+        connect(m_ownPool.get(), &backends::ContainerPool::error, this, &JobExecutor::error);
+    } else if (m_config->containerPoolSize() == 0) {
+        m_ownPool.reset();
+    }
+
+    backends::ContainerPool* pool = activeContainerPool();
+    if (!pool) {
+        return;
+    }
+
+    // Same image, limits and workspace as prepareEnvironment() asks for
+    for (const WorkflowJob& job : m_workflow.jobs) {
+        pool->warm(backends::ContainerBackend::mapRunsOnToImage(job.runsOn),
+                   m_config->jobResources(m_groupOf.value(job.id, job.id), job.runsOn),
+                   m_repositoryPath);
+    }
+}
 
-    for (auto it = workflow.jobs.begin(); it != workflow.jobs.end(); ++it) {
-        const QString& jobId = it.key();
-        const QStringList& needs = it.value().needs;
-        dependencies[jobId] = needs;
+void JobExecutor::warmVmPool() {
+    // Like the container pool, a private pool outlives the run
+    if (!m_vmPool && m_config->vmPoolSize() > 0
+        && (!m_ownVmPool || m_ownVmPool->size() != m_config->vmPoolSize())) {
+        m_ownVmPool = std::make_unique<backends::VmPool>(m_config->vmPoolSize());
+        connect(m_ownVmPool.get(), &backends::VmPool::error, this, &JobExecutor::error);
+    } else if (m_config->vmPoolSize() == 0) {
+        m_ownVmPool.reset();
+    }
+
+    backends::VmPool* pool = vmPool();
+    if (!pool) {
+        return;
+    }
+
+    // Same guest as prepareEnvironment() asks for
+    for (const WorkflowJob& job : m_workflow.jobs) {
+        pool->warm(backends::QemuBackend::guestConfig(
+            job.runsOn, m_config->jobResources(m_groupOf.value(job.id, job.id), job.runsOn), m_repositoryPath));
+    }
+}
 
-        if (needs.isEmpty()) {
-            readyQueue << jobId;
-            queued.insert(jobId);
+void JobExecutor::expandMatrixJobs(const Workflow& workflow) {
+    QMap<QString, QStringList> variantsOf;
+    m_workflow = workflow;
+    m_workflow.jobs = MatrixStrategy().expandJobs(workflow.jobs, &variantsOf);
+    m_matrixGroups.clear();
+    m_groupOf.clear();
+
+    for (auto it = variantsOf.begin(); it != variantsOf.end(); ++it) {
+        const WorkflowJob& job = workflow.jobs[it.key()];
+        MatrixGroup group;
+        group.maxParallel = job.strategy.value("max-parallel", 0).toInt();
+        group.failFast = job.strategy.value("fail-fast", true).toBool();
+        group.variants = it.value();
+        for (const QString& variantId : group.variants) {
+            m_groupOf[variantId] = it.key();
         }
+        m_matrixGroups[it.key()] = group;
+    }
+}
+
+void JobExecutor::enqueueJob(int index) {
+    m_readyQueue.push(ReadyJob{m_priorities[index], m_readySequence++, index});
+}
+
+int JobExecutor::takeNextJob() {
+    while (!m_readyQueue.empty()) {
+        const int index = m_readyQueue.top().index;
+        m_readyQueue.pop();
 
-        for (const QString& dep : needs) {
-            dependents[dep] << jobId;
+        // Cancelled matrix variants stay queued until they surface here
+        if (m_graph.isResolved(index)) {
+            continue;
         }
+
+        auto group = m_matrixGroups.find(m_groupOf.value(m_graph.jobId(index)));
+        if (group != m_matrixGroups.end() && group->maxParallel > 0
+            && group->running >= group->maxParallel) {
+            group->parked.push_back(index);
+            continue;
+        }
+
+        return index;
     }
 
-    if (readyQueue.isEmpty()) {
-        emit error("No runnable jobs found. Check for circular or missing dependencies.");
-        m_running = false;
-        return false;
+    return -1;
+}
+
+void JobExecutor::cancelMatrixSiblings(const QString& groupId) {
+    MatrixGroup& group = m_matrixGroups[groupId];
+    group.cancelled = true;
+
+    for (const QString& variantId : group.variants) {
+        auto active = m_activeJobs.find(variantId);
+        if (active != m_activeJobs.end()) {
+            cancelRun(*active->second);
+            continue;
+        }
+
+        if (m_graph.isResolved(m_graph.indexOf(variantId))) {
+            continue;
+        }
+
+        emit error(QStringLiteral("Cancelling %1 because a matrix sibling failed").arg(variantId));
+        emit jobFinished(variantId, false);
+        resolveJob(variantId, false);
     }
+}
 
-    QSet<QString> processed;
-    QSet<QString> failed;
-    bool success = true;
+void JobExecutor::cancelRun(JobRun& run) {
+    // A job that is already tearing down must not have its cleanup killed;
+    // the job finishes through its regular failure path
+    if (run.cancelled || run.cleaningUp) {
+        return;
+    }
+    run.cancelled = true;
+    run.backend->cancel();
+}
 
-    while (!readyQueue.isEmpty()) {
-        QString jobId = readyQueue.takeFirst();
-        queued.remove(jobId);
+void JobExecutor::scheduleJobs() {
+    // A job that becomes ready later can still overtake lower-ranked waiting
+    // ones, because jobs only leave the queue when a slot is free.
+    while (static_cast<int>(m_activeJobs.size()) < m_maxParallelJobs) {
+        const int index = takeNextJob();
+        if (index == -1) {
+            break;
+        }
+        const QString jobId = m_graph.jobId(index);
 
-        const WorkflowJob& job = workflow.jobs[jobId];
+        // Dependents hash this key even when the job itself is replayed
+        if (m_useResultCache) {
+            m_jobKeys[jobId] = computeJobKey(m_workflow.jobs[jobId]);
+        }
 
-        emit jobStarted(jobId);
+        if (m_resumedJobs.contains(jobId)) {
+            m_resumedJobs.remove(jobId);
+            replayJobResult(jobId, m_journal->succeededJobs().value(jobId),
+                            "Succeeded in run " + m_journal->runId() + ", replaying its output");
+            continue;
+        }
 
-        bool jobSuccess = executeJob(job);
-        emit jobFinished(jobId, jobSuccess);
+        if (m_useResultCache && replayCachedJob(jobId)) {
+            continue;
+        }
 
-        processed.insert(jobId);
-        if (!jobSuccess) {
-            failed.insert(jobId);
-            success = false;
+        // Wait for capacity freed by this or another executor sharing the
+        // budget rather than letting a smaller job overtake a higher-ranked one
+        const WorkflowJob& job = m_workflow.jobs[jobId];
+        ResourceReservation reservation = m_config->jobResources(m_groupOf.value(jobId, jobId), job.runsOn);
+        if (!activeBudget()->tryAcquire(reservation)) {
+            enqueueJob(index);
+            break;
         }
 
-        // Evaluate dependents and gate execution based on dependency outcomes
-        for (const QString& dependentId : dependents[jobId]) {
-            if (processed.contains(dependentId) || queued.contains(dependentId)) {
-                continue;
-            }
+        startJob(jobId, reservation);
+    }
 
-            const QStringList& needs = dependencies[dependentId];
-
-            bool depsProcessed = true;
-            bool depsFailed = false;
-            for (const QString& dep : needs) {
-                if (!processed.contains(dep)) {
-                    depsProcessed = false;
-                    break;
-                }
-                if (failed.contains(dep)) {
-                    depsFailed = true;
-                }
-            }
+    if (m_activeJobs.empty() && m_readyQueue.empty()) {
+        finishExecution();
+    }
+}
 
-            if (!depsProcessed) {
-                continue;
-            }
+QStringList JobExecutor::workspaceTreeHashes(const WorkflowJob& job) const {
+    // A failed capture leaves even the root without a hash
+    QStringList treeHashes;
+    if (!m_snapshot || m_snapshot->treeHash("").isEmpty()) {
+        return treeHashes;
+    }
+    for (const QString& path : JobResultCache::relevantPaths(job)) {
+        treeHashes << path + ":" + m_snapshot->treeHash(path);
+    }
+    return treeHashes;
+}
+
+bool JobExecutor::usesLayerCache() const {
+    return !m_backendFactory && !m_coordinator && m_backendType == backends::BackendType::Container
+        && m_config->layerCacheBudget() > 0;
+}
+
+QString JobExecutor::computeJobKey(const WorkflowJob& job) const {
+    QStringList treeHashes = workspaceTreeHashes(job);
+
+    QStringList upstreamKeys;
+    for (const QString& dep : job.needs) {
+        upstreamKeys << m_jobKeys.value(dep);
+    }
 
-            if (depsFailed) {
-                emit error(QStringLiteral("Skipping %1 because a dependency failed").arg(dependentId));
-                emit jobFinished(dependentId, false);
-                processed.insert(dependentId);
-                failed.insert(dependentId);
-                success = false;
-            } else {
-                readyQueue << dependentId;
-                queued.insert(dependentId);
+    // A custom factory may run anything, so its results are kept apart
+    QString backend = m_backendFactory ? QString("custom") : protocol::backendTypeName(m_backendType);
+    return m_resultCache->computeKey(job, backend, m_workflow.env, treeHashes, upstreamKeys);
+}
+
+bool JobExecutor::replayCachedJob(const QString& jobId) {
+    JobResult result;
+    if (!m_resultCache->lookup(m_jobKeys.value(jobId), result)) {
+        return false;
+    }
+
+    replayJobResult(jobId, result, "Inputs unchanged, replaying recorded result");
+    return true;
+}
+
+void JobExecutor::replayJobResult(const QString& jobId, const JobResult& result, const QString& reason) {
+    emit jobStarted(jobId);
+    emit stepOutput(jobId, "", reason);
+
+    for (const JobLogEntry& entry : result.log) {
+        if (entry.stepName.isEmpty()) {
+            emit stepOutput(jobId, "", entry.text);
+        }
+    }
+
+    for (const QString& stepName : result.stepNames) {
+        emit stepStarted(jobId, stepName);
+        for (const JobLogEntry& entry : result.log) {
+            if (entry.stepName == stepName) {
+                emit stepOutput(jobId, stepName, entry.text);
             }
         }
+        emit stepFinished(jobId, stepName, true);
     }
 
-    if (processed.size() != workflow.jobs.size()) {
-        emit error("Workflow contains unresolved dependencies or cycles");
-        success = false;
+    m_journal->recordJobFinished(jobId, true, result);
+    emit jobFinished(jobId, true);
+    resolveJob(jobId, true);
+}
+
+void JobExecutor::startJob(const QString& jobId, const ResourceReservation& reservation) {
+    auto run = std::make_unique<JobRun>();
+    run->job = m_workflow.jobs[jobId];
+    run->backend = createBackend();
+    run->reservation = reservation;
+    run->backend->setResourceLimits(reservation);
+    run->backend->setWorkspace(m_repositoryPath);
+    run->backend->setJob(run->job);
+    run->backend->setWorkspaceHash(workspaceTreeHashes(run->job).join(','));
+    if (!run->log.open(JobLog::logPath(m_journal->runId(), jobId))) {
+        emit error("Could not write the log of job " + jobId + ", keeping only its last output");
     }
+    run->timer.start();
 
-    m_running = false;
-    emit executionFinished(success);
-    
-    return success;
+    JobRun* runPtr = run.get();
+    backends::ExecutionBackend* backend = run->backend.get();
+    m_activeJobs[jobId] = std::move(run);
+
+    if (m_groupOf.contains(jobId)) {
+        ++m_matrixGroups[m_groupOf[jobId]].running;
+    }
+
+    connect(backend, &backends::ExecutionBackend::output, this,
+            [this, runPtr](const QString& text) {
+        runPtr->log.append(runPtr->currentStep, text);
+        emit stepOutput(runPtr->job.id, runPtr->currentStep, text);
+    });
+
+    connect(backend, &backends::ExecutionBackend::environmentPrepared, this,
+            [this, runPtr](bool success) {
+        runPtr->usage.accumulate(runPtr->backend->takeResourceUsage());
+        if (!success) {
+            emit error("Failed to prepare environment for: " + runPtr->job.runsOn);
+            finishJob(*runPtr, false);
+            return;
+        }
+        runNextStep(*runPtr);
+    });
+
+    connect(backend, &backends::ExecutionBackend::stepCompleted, this,
+            [this, runPtr](bool success) {
+        const WorkflowStep& step = runPtr->job.steps[runPtr->stepIndex];
+        
+        // The environment's cgroup is gone after cleanup, so account every step as it ends
+        ResourceUsage usage = runPtr->backend->takeResourceUsage();
+        if (usage.valid) {
+            runPtr->usage.accumulate(usage);
+            runPtr->log.append(step.name, "Resources: " + usage.summary());
+            emit stepResources(runPtr->job.id, step.name, usage);
+        }
+        runPtr->currentStep.clear();
+        m_journal->recordStepFinished(runPtr->job.id, step.name, success);
+        emit stepFinished(runPtr->job.id, step.name, success);
+
+        if (!success) {
+            finishJob(*runPtr, false);
+            return;
+        }
+
+        ++runPtr->stepIndex;
+        runNextStep(*runPtr);
+    });
+
+    connect(backend, &backends::ExecutionBackend::cleanupFinished, this,
+            [this, jobId]() {
+        completeJob(jobId);
+    });
+
+    m_journal->recordJobStarted(jobId);
+    emit jobStarted(jobId);
+    backend->prepareEnvironment(runPtr->job.runsOn);
 }
 
-void JobExecutor::stopExecution() {
-    if (m_running && m_backend) {
-        m_backend->cleanup();
-        m_running = false;
+void JobExecutor::runNextStep(JobRun& run) {
+    if (run.stepIndex >= run.job.steps.size()) {
+        finishJob(run, true);
+        return;
+    }
+
+    const WorkflowStep& step = run.job.steps[run.stepIndex];
+
+    if (m_stopRequested) {
+        emit error("Execution stopped before step: " + step.name);
+        finishJob(run, false);
+        return;
+    }
+
+    if (run.cancelled) {
+        emit error("Job cancelled before step: " + step.name);
+        finishJob(run, false);
+        return;
     }
+
+    run.currentStep = step.name;
+    m_journal->recordStepStarted(run.job.id, step.name);
+    emit stepStarted(run.job.id, step.name);
+
+    QVariantMap context;
+    context["env"] = run.job.env;
+    context["workingDirectory"] = step.workingDirectory;
+    context["matrix"] = run.job.matrixValues;
+
+    run.backend->executeStep(step, context);
 }
 
-bool JobExecutor::isRunning() const {
-    return m_running;
+void JobExecutor::finishJob(JobRun& run, bool success) {
+    run.success = success;
+    run.cleaningUp = true;
+    run.backend->cleanup();
 }
 
-bool JobExecutor::executeJob(const WorkflowJob& job) {
-    // Prepare environment
-    if (!m_backend->prepareEnvironment(job.runsOn)) {
-        emit error("Failed to prepare environment for: " + job.runsOn);
-        return false;
+void JobExecutor::completeJob(const QString& jobId) {
+    auto it = m_activeJobs.find(jobId);
+    if (it == m_activeJobs.end()) {
+        return;
     }
 
-    // Execute steps
-    for (const WorkflowStep& step : job.steps) {
-        emit stepStarted(job.id, step.name);
+    std::unique_ptr<JobRun> run = std::move(it->second);
+    m_activeJobs.erase(it);
 
-        QVariantMap context;
-        context["env"] = job.env;
-        context["workingDirectory"] = step.workingDirectory;
+    // We are inside a signal of this backend, so it must outlive the handler
+    run->backend->disconnect(this);
+    run->backend.release()->deleteLater();
 
-        if (!m_backend->executeStep(step, context)) {
-            emit stepFinished(job.id, step.name, false);
-            return false;
+    activeBudget()->release(run->reservation);
+
+    const bool jobSuccess = run->success;
+    JobResult result;
+    if (jobSuccess) {
+        m_history->recordDuration(jobId, run->timer.elapsed());
+
+        for (const WorkflowStep& step : run->job.steps) {
+            result.stepNames << step.name;
         }
+        result.log = run->log.entries();
 
-        emit stepFinished(job.id, step.name, true);
+        if (m_useResultCache) {
+            m_resultCache->store(m_jobKeys.value(jobId), result);
+        }
     }
 
-    return true;
+    m_journal->recordJobFinished(jobId, jobSuccess, result);
+    if (run->usage.valid) {
+        emit jobResources(jobId, run->usage);
+    }
+    emit jobFinished(jobId, jobSuccess);
+
+    const QString groupId = m_groupOf.value(jobId);
+    if (!groupId.isEmpty()) {
+        MatrixGroup& group = m_matrixGroups[groupId];
+        --group.running;
+        for (int index : group.parked) {
+            enqueueJob(index);
+        }
+        group.parked.clear();
+        if (!jobSuccess && group.failFast && !group.cancelled) {
+            cancelMatrixSiblings(groupId);
+        }
+    }
+
+    resolveJob(jobId, jobSuccess);
+    scheduleJobs();
+}
+
+void JobExecutor::resolveJob(const QString& jobId, bool success) {
+    if (!success) {
+        m_success = false;
+    }
+
+    // Dependents whose needs are all resolved now either become ready or,
+    // if a need failed, are skipped; skips propagate transitively
+    std::vector<int> ready;
+    std::vector<int> skipped;
+    m_graph.resolve(m_graph.indexOf(jobId), success, ready, skipped);
+    if (m_stopRequested) {
+        return;
+    }
+
+    for (int index : skipped) {
+        const QString& dependentId = m_graph.jobId(index);
+        emit error(QStringLiteral("Skipping %1 because a dependency failed").arg(dependentId));
+        emit jobFinished(dependentId, false);
+        m_success = false;
+    }
+
+    for (int index : ready) {
+        enqueueJob(index);
+    }
+}
+
+void JobExecutor::finishExecution() {
+    if (!m_running) {
+        return;
+    }
+
+    if (m_graph.resolvedCount() != m_graph.size()) {
+        if (!m_stopRequested) {
+            emit error("Workflow contains unresolved dependencies or cycles");
+        }
+        m_success = false;
+    }
+
+    m_history->save();
+    m_journal->recordRunFinished(m_success);
+    if (m_snapshot) {
+        // May be inside the snapshot's finished signal when every job was replayed
+        m_snapshot.release()->deleteLater();
+    }
+
+    m_running = false;
+    if (m_stopRequested) {
+        emit executionStopped(m_stopTimer.elapsed());
+    }
+    emit executionFinished(m_success);
 }
 
 } // namespace core
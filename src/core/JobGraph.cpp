@@ -0,0 +1,155 @@
+#include "core/JobGraph.h"
+#include <QSet>
+
+namespace gwt {
+namespace core {
+
+JobGraph::JobGraph()
+    : m_resolvedCount(0)
+{
+}
+
+JobGraph::~JobGraph() = default;
+
+void JobGraph::build(const QMap<QString, WorkflowJob>& jobs) {
+    const int count = static_cast<int>(jobs.size());
+    m_ids = jobs.keys();
+    m_indices.clear();
+    m_indices.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        m_indices.insert(m_ids[i], i);
+    }
+
+    // Resolve needs to indices once; duplicates count as one need and
+    // unknown jobs as a need that is never met
+    std::vector<std::vector<int>> needs(count);
+    m_needCounts.assign(count, 0);
+    m_dependentOffsets.assign(count + 1, 0);
+    int index = 0;
+    for (auto it = jobs.begin(); it != jobs.end(); ++it, ++index) {
+        QSet<QString> seen;
+        for (const QString& dep : it.value().needs) {
+            if (seen.contains(dep)) {
+                continue;
+            }
+            seen.insert(dep);
+            ++m_needCounts[index];
+
+            int depIndex = m_indices.value(dep, -1);
+            if (depIndex != -1) {
+                needs[index].push_back(depIndex);
+                ++m_dependentOffsets[depIndex + 1];
+            }
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        m_dependentOffsets[i + 1] += m_dependentOffsets[i];
+    }
+
+    m_dependents.assign(m_dependentOffsets[count], 0);
+    std::vector<int> fill(m_dependentOffsets.begin(), m_dependentOffsets.end() - 1);
+    for (int i = 0; i < count; ++i) {
+        for (int dep : needs[i]) {
+            m_dependents[fill[dep]++] = i;
+        }
+    }
+
+    m_unresolvedNeeds = m_needCounts;
+    m_resolved = QBitArray(count);
+    m_failed = QBitArray(count);
+    m_needFailed = QBitArray(count);
+    m_resolvedCount = 0;
+}
+
+int JobGraph::size() const {
+    return static_cast<int>(m_ids.size());
+}
+
+int JobGraph::indexOf(const QString& jobId) const {
+    return m_indices.value(jobId, -1);
+}
+
+const QString& JobGraph::jobId(int index) const {
+    return m_ids[index];
+}
+
+JobGraph::IndexRange JobGraph::dependents(int index) const {
+    const int* data = m_dependents.data();
+    return IndexRange{data + m_dependentOffsets[index], data + m_dependentOffsets[index + 1]};
+}
+
+std::vector<int> JobGraph::roots() const {
+    std::vector<int> roots;
+    for (int i = 0; i < size(); ++i) {
+        if (m_needCounts[i] == 0) {
+            roots.push_back(i);
+        }
+    }
+    return roots;
+}
+
+std::vector<int> JobGraph::topologicalOrder() const {
+    std::vector<int> remaining = m_needCounts;
+    std::vector<int> order = roots();
+    order.reserve(size());
+
+    // The order doubles as the work list
+    for (size_t next = 0; next < order.size(); ++next) {
+        for (int dependent : dependents(order[next])) {
+            if (--remaining[dependent] == 0) {
+                order.push_back(dependent);
+            }
+        }
+    }
+    return order;
+}
+
+void JobGraph::resolve(int index, bool success, std::vector<int>& ready, std::vector<int>& skipped) {
+    if (m_resolved.testBit(index)) {
+        return;
+    }
+    m_resolved.setBit(index);
+    m_failed.setBit(index, !success);
+    ++m_resolvedCount;
+
+    std::vector<int> resolved{index};
+    for (size_t next = 0; next < resolved.size(); ++next) {
+        const int resolvedIndex = resolved[next];
+        const bool failed = m_failed.testBit(resolvedIndex);
+
+        for (int dependent : dependents(resolvedIndex)) {
+            if (failed) {
+                m_needFailed.setBit(dependent);
+            }
+            if (--m_unresolvedNeeds[dependent] > 0 || m_resolved.testBit(dependent)) {
+                continue;
+            }
+
+            if (m_needFailed.testBit(dependent)) {
+                m_resolved.setBit(dependent);
+                m_failed.setBit(dependent);
+                ++m_resolvedCount;
+                skipped.push_back(dependent);
+                resolved.push_back(dependent);
+            } else {
+                ready.push_back(dependent);
+            }
+        }
+    }
+}
+
+bool JobGraph::isResolved(int index) const {
+    return m_resolved.testBit(index);
+}
+
+bool JobGraph::isFailed(int index) const {
+    return m_failed.testBit(index);
+}
+
+int JobGraph::resolvedCount() const {
+    return m_resolvedCount;
+}
+
+} // namespace core
+} // namespace gwt
@@ -0,0 +1,84 @@
+#include "core/JobHistory.h"
+#include "core/StorageProvider.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+namespace gwt {
+namespace core {
+
+namespace {
+// Weight of the newest sample in the moving average
+constexpr double SMOOTHING = 0.5;
+}
+
+JobHistory::JobHistory() = default;
+
+JobHistory::~JobHistory() = default;
+
+bool JobHistory::load(const QString& workflowFile) {
+    m_historyPath = getHistoryPath(workflowFile);
+    m_durations.clear();
+    
+    QFile file(m_historyPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    QJsonObject jobs = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = jobs.begin(); it != jobs.end(); ++it) {
+        qint64 duration = it.value().toInteger(-1);
+        if (duration >= 0) {
+            m_durations[it.key()] = duration;
+        }
+    }
+    
+    return true;
+}
+
+bool JobHistory::save() const {
+    if (m_historyPath.isEmpty()) {
+        return false;
+    }
+    
+    QJsonObject jobs;
+    for (auto it = m_durations.begin(); it != m_durations.end(); ++it) {
+        jobs.insert(it.key(), it.value());
+    }
+    
+    QDir().mkpath(QFileInfo(m_historyPath).path());
+    
+    QSaveFile file(m_historyPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(jobs).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+qint64 JobHistory::averageDuration(const QString& jobId) const {
+    return m_durations.value(jobId, -1);
+}
+
+void JobHistory::recordDuration(const QString& jobId, qint64 durationMs) {
+    auto it = m_durations.find(jobId);
+    if (it == m_durations.end()) {
+        m_durations.insert(jobId, durationMs);
+    } else {
+        it.value() = qRound64(SMOOTHING * durationMs + (1.0 - SMOOTHING) * it.value());
+    }
+}
+
+QString JobHistory::getHistoryPath(const QString& workflowFile) const {
+    QByteArray hashData = QFileInfo(workflowFile).absoluteFilePath().toUtf8();
+    QString hash = QString(QCryptographicHash::hash(hashData, QCryptographicHash::Sha256).toHex());
+    
+    return StorageProvider::instance().getCacheRoot() + "/history/" + hash + ".json";
+}
+
+} // namespace core
+} // namespace gwt
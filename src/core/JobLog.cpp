@@ -0,0 +1,85 @@
+#include "core/JobLog.h"
+#include "core/StorageProvider.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+namespace gwt {
+namespace core {
+
+JobLog::JobLog(qint64 maxBufferedChars)
+    : m_maxBufferedChars(maxBufferedChars)
+    , m_bufferedChars(0)
+    , m_droppedChars(0)
+{
+}
+
+JobLog::~JobLog() {
+    close();
+}
+
+QString JobLog::logPath(const QString& runId, const QString& jobId) {
+    // Matrix variant ids contain spaces, parentheses and values of any kind
+    QString fileName = jobId;
+    fileName.replace(QRegularExpression("[^A-Za-z0-9._-]"), "_");
+    return StorageProvider::instance().getCacheRoot() + "/runs/" + runId + "/" + fileName + ".log";
+}
+
+bool JobLog::open(const QString& filePath) {
+    close();
+    QDir().mkpath(QFileInfo(filePath).path());
+    m_file.setFileName(filePath);
+    return m_file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+}
+
+QString JobLog::filePath() const {
+    return m_file.isOpen() ? m_file.fileName() : QString();
+}
+
+void JobLog::append(const QString& stepName, const QString& text) {
+    if (m_file.isOpen()) {
+        if (stepName != m_lastStep && !stepName.isEmpty()) {
+            m_file.write("##[step] " + stepName.toUtf8() + '\n');
+        }
+        m_file.write(text.toUtf8());
+        if (!text.endsWith('\n')) {
+            m_file.write("\n");
+        }
+    }
+    m_lastStep = stepName;
+
+    m_entries.push_back(JobLogEntry{stepName, text});
+    m_bufferedChars += text.size();
+
+    // Always keep the newest chunk, however large
+    while (m_bufferedChars > m_maxBufferedChars && m_entries.size() > 1) {
+        m_bufferedChars -= m_entries.front().text.size();
+        m_droppedChars += m_entries.front().text.size();
+        m_entries.pop_front();
+    }
+}
+
+QList<JobLogEntry> JobLog::entries() const {
+    QList<JobLogEntry> entries;
+    if (m_droppedChars > 0) {
+        QString note = QStringLiteral("... %1 characters of earlier output omitted").arg(m_droppedChars);
+        if (m_file.isOpen()) {
+            note += ", full log: " + m_file.fileName();
+        }
+        entries.append(JobLogEntry{QString(), note});
+    }
+
+    for (const JobLogEntry& entry : m_entries) {
+        entries.append(entry);
+    }
+    return entries;
+}
+
+void JobLog::close() {
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+} // namespace core
+} // namespace gwt
@@ -0,0 +1,162 @@
+#include "core/JobResultCache.h"
+#include "core/StorageProvider.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+namespace gwt {
+namespace core {
+
+JobResultCache::JobResultCache()
+    : m_pruned(false)
+{
+}
+
+JobResultCache::~JobResultCache() = default;
+
+QString JobResultCache::computeKey(const WorkflowJob& job,
+                                   const QString& backend,
+                                   const QVariantMap& workflowEnv,
+                                   const QStringList& treeHashes,
+                                   const QStringList& upstreamKeys) const {
+    // QJsonObject keeps keys sorted, which makes the serialization canonical
+    QJsonArray steps;
+    for (const WorkflowStep& step : job.steps) {
+        QJsonObject stepObject;
+        stepObject["name"] = step.name;
+        stepObject["id"] = step.id;
+        stepObject["run"] = step.run;
+        stepObject["uses"] = step.uses;
+        stepObject["with"] = QJsonObject::fromVariantMap(step.with);
+        stepObject["env"] = QJsonObject::fromVariantMap(step.env);
+        stepObject["workingDirectory"] = step.workingDirectory;
+        stepObject["shell"] = step.shell;
+        stepObject["if"] = step.ifCondition;
+        steps.append(stepObject);
+    }
+    
+    QStringList sortedUpstream = upstreamKeys;
+    sortedUpstream.sort();
+    
+    QJsonObject inputs;
+    inputs["id"] = job.id;
+    inputs["runsOn"] = job.runsOn;
+    inputs["backend"] = backend;
+    inputs["env"] = QJsonObject::fromVariantMap(job.env);
+    inputs["workflowEnv"] = QJsonObject::fromVariantMap(workflowEnv);
+    inputs["outputs"] = QJsonObject::fromVariantMap(job.outputs);
+    inputs["matrix"] = QJsonObject::fromVariantMap(job.matrixValues);
+    inputs["if"] = job.ifCondition;
+    inputs["steps"] = steps;
+    inputs["trees"] = QJsonArray::fromStringList(treeHashes);
+    inputs["upstream"] = QJsonArray::fromStringList(sortedUpstream);
+    
+    QByteArray hashData = QJsonDocument(inputs).toJson(QJsonDocument::Compact);
+    return QString(QCryptographicHash::hash(hashData, QCryptographicHash::Sha256).toHex());
+}
+
+bool JobResultCache::lookup(const QString& key, JobResult& result) const {
+    QFile file(getResultPath(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject()) {
+        return false;
+    }
+    
+    // Pruning goes by modification time, so a hit keeps the result
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    
+    QJsonObject record = doc.object();
+    result.stepNames.clear();
+    for (const QJsonValue& value : record["steps"].toArray()) {
+        result.stepNames << value.toString();
+    }
+    result.log.clear();
+    for (const QJsonValue& value : record["log"].toArray()) {
+        QJsonObject entry = value.toObject();
+        result.log.append(JobLogEntry{entry["step"].toString(), entry["text"].toString()});
+    }
+    
+    return true;
+}
+
+bool JobResultCache::store(const QString& key, const JobResult& result) {
+    if (!m_pruned) {
+        m_pruned = true;
+        prune();
+    }
+    
+    QJsonObject record;
+    record["steps"] = QJsonArray::fromStringList(result.stepNames);
+    
+    QJsonArray log;
+    for (const JobLogEntry& entry : result.log) {
+        QJsonObject entryObject;
+        entryObject["step"] = entry.stepName;
+        entryObject["text"] = entry.text;
+        log.append(entryObject);
+    }
+    record["log"] = log;
+    
+    QString path = getResultPath(key);
+    QDir().mkpath(QFileInfo(path).path());
+    
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(record).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+void JobResultCache::prune() const {
+    // Most recently used first
+    QFileInfoList results = QDir(getResultDir()).entryInfoList(QStringList() << "*.json", QDir::Files,
+                                                               QDir::Time);
+    QDateTime oldest = QDateTime::currentDateTime().addDays(-MAX_AGE_DAYS);
+    qint64 total = 0;
+    for (const QFileInfo& result : results) {
+        total += result.size();
+        if (total > MAX_TOTAL_BYTES || result.lastModified() < oldest) {
+            QFile::remove(result.filePath());
+        }
+    }
+}
+
+QStringList JobResultCache::relevantPaths(const WorkflowJob& job) {
+    // A step without an explicit working directory may read anything
+    QStringList paths;
+    for (const WorkflowStep& step : job.steps) {
+        if (step.workingDirectory.isEmpty()) {
+            return QStringList{QString()};
+        }
+        if (!paths.contains(step.workingDirectory)) {
+            paths << step.workingDirectory;
+        }
+    }
+    
+    if (paths.isEmpty()) {
+        paths << QString();
+    }
+    return paths;
+}
+
+QString JobResultCache::getResultDir() const {
+    return StorageProvider::instance().getCacheRoot() + "/results";
+}
+
+QString JobResultCache::getResultPath(const QString& key) const {
+    return getResultDir() + "/" + key + ".json";
+}
+
+} // namespace core
+} // namespace gwt
@@ -0,0 +1,163 @@
+#include "core/LayerCache.h"
+#include "core/StorageProvider.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLockFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <vector>
+
+namespace gwt {
+namespace core {
+
+LayerCache::LayerCache() = default;
+
+LayerCache::~LayerCache() = default;
+
+QStringList LayerCache::prefixKeys(const QString& baseImage, const WorkflowJob& job,
+                                   const QString& workspaceHash) {
+    // QJsonObject keeps keys sorted, which makes the serialization canonical
+    QJsonObject base;
+    base["image"] = baseImage;
+    base["workspace"] = workspaceHash;
+    base["env"] = QJsonObject::fromVariantMap(job.env);
+    base["matrix"] = QJsonObject::fromVariantMap(job.matrixValues);
+    QByteArray key = QCryptographicHash::hash(QJsonDocument(base).toJson(QJsonDocument::Compact),
+                                              QCryptographicHash::Sha256).toHex();
+
+    // Each key covers the previous one, like the layers of a container build
+    QStringList keys;
+    for (const WorkflowStep& step : job.steps) {
+        QJsonObject stepObject;
+        stepObject["parent"] = QString(key);
+        stepObject["run"] = step.run;
+        stepObject["uses"] = step.uses;
+        stepObject["with"] = QJsonObject::fromVariantMap(step.with);
+        stepObject["env"] = QJsonObject::fromVariantMap(step.env);
+        stepObject["workingDirectory"] = step.workingDirectory;
+        stepObject["shell"] = step.shell;
+        key = QCryptographicHash::hash(QJsonDocument(stepObject).toJson(QJsonDocument::Compact),
+                                       QCryptographicHash::Sha256).toHex();
+        keys << QString(key);
+    }
+    return keys;
+}
+
+QString LayerCache::imageTag(const QString& key) {
+    return "gwt-layer:" + key.left(32);
+}
+
+int LayerCache::lookup(const QStringList& keys) const {
+    int steps = 0;
+    updateIndex([&keys, &steps](QJsonObject& layers) {
+        for (int i = keys.size() - 1; i >= 0; --i) {
+            if (layers.contains(keys[i])) {
+                QJsonObject layer = layers[keys[i]].toObject();
+                layer["lastUsed"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+                layers[keys[i]] = layer;
+                steps = i + 1;
+                return true;
+            }
+        }
+        return false;
+    });
+    return steps;
+}
+
+bool LayerCache::contains(const QString& key) const {
+    return readIndex().contains(key);
+}
+
+bool LayerCache::record(const QString& key, qint64 sizeBytes) const {
+    return updateIndex([&key, sizeBytes](QJsonObject& layers) {
+        QJsonObject layer;
+        layer["size"] = sizeBytes;
+        layer["lastUsed"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+        layers[key] = layer;
+        return true;
+    });
+}
+
+bool LayerCache::remove(const QString& key) const {
+    return updateIndex([&key](QJsonObject& layers) {
+        if (!layers.contains(key)) {
+            return false;
+        }
+        layers.remove(key);
+        return true;
+    });
+}
+
+QStringList LayerCache::evict(qint64 budgetBytes) const {
+    struct Layer {
+        QString key;
+        QString lastUsed;
+        qint64 size;
+    };
+    std::vector<Layer> byAge;
+    qint64 total = 0;
+    QJsonObject layers = readIndex();
+    for (auto it = layers.begin(); it != layers.end(); ++it) {
+        QJsonObject layer = it.value().toObject();
+        byAge.push_back({it.key(), layer["lastUsed"].toString(), layer["size"].toInteger()});
+        total += byAge.back().size;
+    }
+
+    // ISO timestamps in UTC sort chronologically as strings
+    std::sort(byAge.begin(), byAge.end(), [](const Layer& a, const Layer& b) {
+        return a.lastUsed < b.lastUsed;
+    });
+
+    QStringList keys;
+    for (const Layer& layer : byAge) {
+        if (total <= budgetBytes) {
+            break;
+        }
+        keys << layer.key;
+        total -= layer.size;
+    }
+    return keys;
+}
+
+QString LayerCache::getIndexPath() {
+    return StorageProvider::instance().getCacheRoot() + "/layers.json";
+}
+
+bool LayerCache::updateIndex(const std::function<bool(QJsonObject& layers)>& update) const {
+    QString path = getIndexPath();
+    QDir().mkpath(QFileInfo(path).path());
+
+    // Jobs of other gwt processes update the same index
+    QLockFile lock(path + ".lock");
+    if (!lock.lock()) {
+        return false;
+    }
+
+    QJsonObject layers = readIndex();
+    if (!update(layers)) {
+        return false;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(layers).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+QJsonObject LayerCache::readIndex() const {
+    QFile file(getIndexPath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QJsonObject();
+    }
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+} // namespace core
+} // namespace gwt
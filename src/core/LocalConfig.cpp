@@ -0,0 +1,209 @@
+#include "core/LocalConfig.h"
+#include "core/StorageProvider.h"
+#include <yaml-cpp/yaml.h>
+#include <QFileInfo>
+
+namespace gwt {
+namespace core {
+
+namespace {
+
+/**
+ * @brief Read cpus and memory keys of a node on top of a base reservation
+ */
+ResourceReservation readReservation(const YAML::Node& node,
+                                    const ResourceReservation& base,
+                                    const QString& context,
+                                    QStringList& errors) {
+    ResourceReservation reservation = base;
+    if (!node.IsMap()) {
+        errors << context + ": expected a map with cpus and memory";
+        return reservation;
+    }
+    
+    if (node["cpus"]) {
+        double cpus = node["cpus"].as<double>();
+        if (cpus > 0) {
+            reservation.cpus = cpus;
+        } else {
+            errors << context + ": cpus must be positive";
+        }
+    }
+    
+    if (node["memory"]) {
+        qint64 memory = LocalConfig::parseMemorySize(QString::fromStdString(node["memory"].as<std::string>()));
+        if (memory > 0) {
+            reservation.memoryBytes = memory;
+        } else {
+            errors << context + ": memory must be a size such as 4G or 512M";
+        }
+    }
+    
+    return reservation;
+}
+
+/**
+ * @brief Reservation of a GitHub-hosted runner label when nothing is configured
+ */
+ResourceReservation builtinResources(const QString& runsOn) {
+    ResourceReservation reservation;
+    if (runsOn.contains("alpine")) {
+        reservation.cpus = 1;
+        reservation.memoryBytes = qint64(1) << 30;
+    } else {
+        // Matches the ubuntu/debian containers and the QEMU guests
+        reservation.cpus = 2;
+        reservation.memoryBytes = qint64(4) << 30;
+    }
+    return reservation;
+}
+
+} // namespace
+
+LocalConfig::LocalConfig()
+    : m_host(ResourceBudget::hostCapacity())
+    , m_containerPoolSize(0)
+    , m_vmPoolSize(0)
+    , m_layerCacheBudget(0)
+{
+}
+
+LocalConfig::~LocalConfig() = default;
+
+bool LocalConfig::load(const QString& filePath) {
+    QString path = filePath.isEmpty() ? defaultPath() : filePath;
+    m_errors.clear();
+    m_host = ResourceBudget::hostCapacity();
+    m_runnerResources.clear();
+    m_jobResources.clear();
+    m_containerPoolSize = 0;
+    m_vmPoolSize = 0;
+    m_layerCacheBudget = 0;
+    
+    if (!QFileInfo::exists(path)) {
+        return true;
+    }
+    
+    try {
+        YAML::Node root = YAML::LoadFile(path.toStdString());
+        
+        if (root["host"]) {
+            m_host = readReservation(root["host"], m_host, "host", m_errors);
+        }
+        
+        YAML::Node resources = root["resources"];
+        if (resources && resources["runners"]) {
+            for (auto it = resources["runners"].begin(); it != resources["runners"].end(); ++it) {
+                QString label = QString::fromStdString(it->first.as<std::string>());
+                m_runnerResources[label] = readReservation(it->second, builtinResources(label),
+                                                           "resources.runners." + label, m_errors);
+            }
+        }
+        if (resources && resources["jobs"]) {
+            for (auto it = resources["jobs"].begin(); it != resources["jobs"].end(); ++it) {
+                QString jobId = QString::fromStdString(it->first.as<std::string>());
+                // Unset fields fall back to the runner setting in jobResources()
+                m_jobResources[jobId] = readReservation(it->second, ResourceReservation(),
+                                                        "resources.jobs." + jobId, m_errors);
+            }
+        }
+        
+        YAML::Node pool = root["pool"];
+        if (pool && pool["containers"]) {
+            int containers = pool["containers"].as<int>();
+            if (containers >= 0) {
+                m_containerPoolSize = containers;
+            } else {
+                m_errors << "pool.containers must not be negative";
+            }
+        }
+        if (pool && pool["vms"]) {
+            int vms = pool["vms"].as<int>();
+            if (vms >= 0) {
+                m_vmPoolSize = vms;
+            } else {
+                m_errors << "pool.vms must not be negative";
+            }
+        }
+        
+        YAML::Node layerCache = root["layer_cache"];
+        if (layerCache && layerCache["budget"]) {
+            qint64 budget = parseMemorySize(QString::fromStdString(layerCache["budget"].as<std::string>()));
+            if (budget >= 0) {
+                m_layerCacheBudget = budget;
+            } else {
+                m_errors << "layer_cache.budget must be a size such as 20G";
+            }
+        }
+    } catch (const YAML::Exception& e) {
+        m_errors << QString("%1: %2").arg(path, QString::fromStdString(e.what()));
+    }
+    
+    return m_errors.isEmpty();
+}
+
+QStringList LocalConfig::getErrors() const {
+    return m_errors;
+}
+
+QString LocalConfig::defaultPath() {
+    return StorageProvider::instance().getConfigRoot() + "/config.yml";
+}
+
+ResourceReservation LocalConfig::hostCapacity() const {
+    return m_host;
+}
+
+ResourceReservation LocalConfig::jobResources(const QString& jobId, const QString& runsOn) const {
+    ResourceReservation reservation = m_runnerResources.value(runsOn, builtinResources(runsOn));
+    
+    auto job = m_jobResources.constFind(jobId);
+    if (job != m_jobResources.constEnd()) {
+        if (job->cpus > 0) {
+            reservation.cpus = job->cpus;
+        }
+        if (job->memoryBytes > 0) {
+            reservation.memoryBytes = job->memoryBytes;
+        }
+    }
+    
+    return reservation;
+}
+
+int LocalConfig::containerPoolSize() const {
+    return m_containerPoolSize;
+}
+
+int LocalConfig::vmPoolSize() const {
+    return m_vmPoolSize;
+}
+
+qint64 LocalConfig::layerCacheBudget() const {
+    return m_layerCacheBudget;
+}
+
+qint64 LocalConfig::parseMemorySize(const QString& text) {
+    QString number = text.trimmed().toUpper();
+    if (number.endsWith('B')) {
+        number.chop(1);
+    }
+    
+    qint64 unit = 1;
+    if (number.endsWith('K')) {
+        unit = qint64(1) << 10;
+    } else if (number.endsWith('M')) {
+        unit = qint64(1) << 20;
+    } else if (number.endsWith('G')) {
+        unit = qint64(1) << 30;
+    }
+    if (unit != 1) {
+        number.chop(1);
+    }
+    
+    bool ok = false;
+    double value = number.toDouble(&ok);
+    return ok && value >= 0 ? qint64(value * unit) : -1;
+}
+
+} // namespace core
+} // namespace gwt
@@ -1,6 +1,7 @@
 #include "core/MatrixStrategy.h"
 #include "core/WorkflowParser.h"
 #include <QMetaType>
+#include <QRegularExpression>
 #include <QDebug>
 
 namespace gwt {
@@ -10,6 +11,39 @@ MatrixStrategy::MatrixStrategy() = default;
 
 MatrixStrategy::~MatrixStrategy() = default;
 
+QMap<QString, WorkflowJob> MatrixStrategy::expandJobs(const QMap<QString, WorkflowJob>& jobs,
+                                                      QMap<QString, QStringList>* variantsOf) const {
+    QMap<QString, WorkflowJob> expanded;
+    QMap<QString, QStringList> expandedIds;
+    for (auto it = jobs.begin(); it != jobs.end(); ++it) {
+        if (!hasMatrix(it.value())) {
+            expanded[it.key()] = it.value();
+            expandedIds[it.key()] = QStringList{it.key()};
+            continue;
+        }
+
+        QStringList variants;
+        for (const WorkflowJob& variant : expandMatrix(it.value())) {
+            expanded[variant.id] = variant;
+            variants << variant.id;
+        }
+        expandedIds[it.key()] = variants;
+        if (variantsOf) {
+            (*variantsOf)[it.key()] = variants;
+        }
+    }
+
+    // Needs name the matrix job; a dependent waits for every one of its variants
+    for (auto it = expanded.begin(); it != expanded.end(); ++it) {
+        QStringList needs;
+        for (const QString& dep : it.value().needs) {
+            needs << expandedIds.value(dep, QStringList{dep});
+        }
+        it.value().needs = needs;
+    }
+    return expanded;
+}
+
 QList<WorkflowJob> MatrixStrategy::expandMatrix(const WorkflowJob& job) const {
     QList<WorkflowJob> expandedJobs;
     
@@ -37,13 +71,22 @@ QList<WorkflowJob> MatrixStrategy::expandMatrix(const WorkflowJob& job) const {
         matrixSuffix += ")";
         
         expandedJob.id = job.id + matrixSuffix;
-        expandedJob.name = job.name + " " + matrixSuffix;
+        expandedJob.name = (job.name.isEmpty() ? job.id : job.name) + " " + matrixSuffix;
+        expandedJob.matrixValues = combo;
+        expandedJob.strategy.remove("matrix");
         
         // Add matrix variables to environment
         for (auto it = combo.begin(); it != combo.end(); ++it) {
             expandedJob.env["matrix." + it.key()] = it.value();
         }
         
+        // Resolve ${{ matrix.* }} references that decide where and what runs
+        expandedJob.runsOn = substituteMatrixValues(job.runsOn, combo);
+        for (WorkflowStep& step : expandedJob.steps) {
+            step.name = substituteMatrixValues(step.name, combo);
+            step.run = substituteMatrixValues(step.run, combo);
+        }
+        
         expandedJobs << expandedJob;
     }
     
@@ -54,6 +97,29 @@ bool MatrixStrategy::hasMatrix(const WorkflowJob& job) const {
     return job.strategy.contains("matrix") && !job.strategy["matrix"].toMap().isEmpty();
 }
 
+QString MatrixStrategy::substituteMatrixValues(const QString& text, const QVariantMap& values) const {
+    if (!text.contains("matrix.")) {
+        return text;
+    }
+    
+    static const QRegularExpression pattern(R"(\$\{\{\s*matrix\.([A-Za-z0-9_-]+)\s*\}\})");
+    
+    QString result;
+    qsizetype last = 0;
+    QRegularExpressionMatchIterator it = pattern.globalMatch(text);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        result += text.mid(last, match.capturedStart() - last);
+        
+        QString key = match.captured(1);
+        result += values.contains(key) ? values[key].toString() : match.captured(0);
+        last = match.capturedEnd();
+    }
+    result += text.mid(last);
+    
+    return result;
+}
+
 QList<QVariantMap> MatrixStrategy::generateCombinations(const QVariantMap& matrix) const {
     QList<QVariantMap> results;
     
@@ -1,9 +1,11 @@
 #include "core/RepoManager.h"
 #include "core/StorageProvider.h"
 #include <QProcess>
+#include <QTimer>
 #include <QDir>
 #include <QFileInfo>
 #include <QDebug>
+#include <memory>
 
 namespace gwt {
 namespace core {
@@ -26,7 +28,6 @@ bool RepoManager::cloneRepository(const QString& repoUrl, const QString& branch)
     
     QDir().mkpath(QFileInfo(localPath).path());
     
-    QProcess git;
     QStringList args;
     args << "clone";
     
@@ -36,30 +37,51 @@ bool RepoManager::cloneRepository(const QString& repoUrl, const QString& branch)
     
     args << repoUrl << localPath;
     
-    git.start("git", args);
-    
-    if (!git.waitForStarted()) {
-        emit error("Failed to start git process");
-        return false;
-    }
-    
-    emit cloneProgress(10, "Cloning repository...");
+    QProcess* git = new QProcess(this);
+    QTimer* timer = new QTimer(git);
+    timer->setSingleShot(true);
+    auto timedOut = std::make_shared<bool>(false);
     
-    // Wait for completion with timeout
-    if (!git.waitForFinished(300000)) { // 5 minutes timeout
+    connect(timer, &QTimer::timeout, git, [this, git, timedOut]() {
+        *timedOut = true;
         emit error("Git clone timeout");
-        git.kill();
-        return false;
-    }
+        git->kill();
+    });
+    
+    connect(git, &QProcess::finished, this,
+            [this, git, timer, timedOut](int exitCode, QProcess::ExitStatus) {
+        timer->stop();
+        git->deleteLater();
+        
+        if (*timedOut) {
+            emit cloneFinished(false);
+            return;
+        }
+        
+        if (exitCode != 0) {
+            QString errorMsg = QString::fromUtf8(git->readAllStandardError());
+            emit error("Git clone failed: " + errorMsg);
+            emit cloneFinished(false);
+            return;
+        }
+        
+        emit cloneProgress(100, "Clone completed");
+        emit cloneFinished(true);
+    });
+    
+    connect(git, &QProcess::errorOccurred, this,
+            [this, git](QProcess::ProcessError processError) {
+        if (processError == QProcess::FailedToStart) {
+            git->deleteLater();
+            emit error("Failed to start git: " + git->errorString());
+            emit cloneFinished(false);
+        }
+    });
     
-    if (git.exitCode() != 0) {
-        QString errorMsg = QString::fromUtf8(git.readAllStandardError());
-        emit error("Git clone failed: " + errorMsg);
-        return false;
-    }
+    git->start("git", args);
+    timer->start(CLONE_TIMEOUT_MS);
     
-    emit cloneProgress(100, "Clone completed");
-    emit cloneFinished(true);
+    emit cloneProgress(10, "Cloning repository...");
     return true;
 }
 
@@ -0,0 +1,167 @@
+#include "core/RepoSnapshot.h"
+#include "core/StorageProvider.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QTimer>
+#include <QUuid>
+
+namespace gwt {
+namespace core {
+
+RepoSnapshot::RepoSnapshot(QObject* parent)
+    : QObject(parent)
+{
+}
+
+RepoSnapshot::~RepoSnapshot() {
+    removeScratch();
+}
+
+void RepoSnapshot::capture(const QString& repoPath) {
+    m_repoPath = repoPath;
+    m_rootTree.clear();
+    m_trees.clear();
+    
+    QString snapshotDir = StorageProvider::instance().getCacheRoot() + "/snapshots";
+    QDir().mkpath(snapshotDir);
+    QString id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    m_indexPath = snapshotDir + "/index-" + id;
+    m_objectsPath.clear();
+    m_alternatePath.clear();
+    
+    // Start from a copy of the real index so unchanged files are not rehashed
+    runGit(QStringList() << "rev-parse" << "--git-path" << "index" << "--git-path" << "objects",
+           [this, snapshotDir, id](bool success, const QByteArray& output) {
+        QStringList paths = QString::fromUtf8(output).trimmed().split('\n');
+        if (!success || paths.size() != 2) {
+            emit error("Not a Git repository: " + m_repoPath);
+            finish(false);
+            return;
+        }
+        for (QString& path : paths) {
+            if (QFileInfo(path).isRelative()) {
+                path = m_repoPath + "/" + path;
+            }
+        }
+        QFile::copy(paths[0], m_indexPath);
+        
+        // Hashing modified and untracked files writes their blobs; keep them,
+        // and the trees, out of the repository
+        m_alternatePath = paths[1];
+        m_objectsPath = snapshotDir + "/objects-" + id;
+        if (!QDir().mkpath(m_objectsPath)) {
+            emit error("Could not create " + m_objectsPath);
+            finish(false);
+            return;
+        }
+        
+        runGit(QStringList() << "add" << "-A", [this](bool success, const QByteArray&) {
+            if (!success) {
+                emit error("Failed to stage working tree of: " + m_repoPath);
+                finish(false);
+                return;
+            }
+            
+            runGit(QStringList() << "write-tree", [this](bool success, const QByteArray& output) {
+                m_rootTree = QString::fromUtf8(output).trimmed();
+                if (!success || m_rootTree.isEmpty()) {
+                    emit error("Failed to hash working tree of: " + m_repoPath);
+                    finish(false);
+                    return;
+                }
+                
+                runGit(QStringList() << "ls-tree" << "-r" << "-d" << m_rootTree,
+                       [this](bool success, const QByteArray& output) {
+                    if (!success) {
+                        emit error("Failed to list trees of: " + m_repoPath);
+                        finish(false);
+                        return;
+                    }
+                    
+                    // Each line reads "<mode> tree <hash>\t<path>"
+                    for (const QByteArray& line : output.split('\n')) {
+                        int tab = line.indexOf('\t');
+                        QList<QByteArray> fields = line.left(tab).split(' ');
+                        if (tab < 0 || fields.size() != 3) {
+                            continue;
+                        }
+                        m_trees[QString::fromUtf8(line.mid(tab + 1))] = QString::fromUtf8(fields[2]);
+                    }
+                    
+                    finish(true);
+                });
+            });
+        });
+    });
+}
+
+QString RepoSnapshot::treeHash(const QString& relativePath) const {
+    QString path = QDir::cleanPath(relativePath);
+    if (path.isEmpty() || path == ".") {
+        return m_rootTree;
+    }
+    if (path.startsWith("./")) {
+        path = path.mid(2);
+    }
+    return m_trees.value(path);
+}
+
+void RepoSnapshot::runGit(const QStringList& args,
+                          std::function<void(bool success, const QByteArray& output)> onFinished) {
+    QProcess* git = new QProcess(this);
+    git->setWorkingDirectory(m_repoPath);
+    
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert("GIT_INDEX_FILE", m_indexPath);
+    if (!m_objectsPath.isEmpty()) {
+        env.insert("GIT_OBJECT_DIRECTORY", m_objectsPath);
+        env.insert("GIT_ALTERNATE_OBJECT_DIRECTORIES", m_alternatePath);
+    }
+    git->setProcessEnvironment(env);
+    
+    QTimer* timer = new QTimer(git);
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, git, [git]() {
+        git->kill();
+    });
+    
+    connect(git, &QProcess::finished, this,
+            [git, timer, onFinished](int exitCode, QProcess::ExitStatus exitStatus) {
+        timer->stop();
+        git->deleteLater();
+        onFinished(exitStatus == QProcess::NormalExit && exitCode == 0, git->readAllStandardOutput());
+    });
+    
+    connect(git, &QProcess::errorOccurred, this,
+            [git, onFinished](QProcess::ProcessError processError) {
+        if (processError == QProcess::FailedToStart) {
+            git->deleteLater();
+            onFinished(false, QByteArray());
+        }
+    });
+    
+    git->start("git", args);
+    timer->start(GIT_TIMEOUT_MS);
+}
+
+void RepoSnapshot::removeScratch() {
+    if (!m_indexPath.isEmpty()) {
+        QFile::remove(m_indexPath);
+        m_indexPath.clear();
+    }
+    if (!m_objectsPath.isEmpty()) {
+        QDir(m_objectsPath).removeRecursively();
+        m_objectsPath.clear();
+    }
+}
+
+void RepoSnapshot::finish(bool success) {
+    removeScratch();
+    emit finished(success);
+}
+
+} // namespace core
+} // namespace gwt
@@ -0,0 +1,102 @@
+#include "core/ResourceBudget.h"
+#include <QFile>
+#include <QMetaObject>
+#include <QRegularExpression>
+#include <QThread>
+
+namespace gwt {
+namespace core {
+
+ResourceBudget::ResourceBudget(int maxJobs, const ResourceReservation& capacity, QObject* parent)
+    : QObject(parent)
+    , m_maxJobs(qMax(1, maxJobs))
+    , m_capacity(capacity)
+    , m_runningJobs(0)
+    , m_releasePending(false)
+{
+}
+
+ResourceBudget::~ResourceBudget() = default;
+
+bool ResourceBudget::tryAcquire(const ResourceReservation& reservation) {
+    if (m_runningJobs >= m_maxJobs) {
+        return false;
+    }
+    
+    ResourceReservation needed = effective(reservation);
+    if (m_capacity.cpus > 0 && m_reserved.cpus + needed.cpus > m_capacity.cpus) {
+        return false;
+    }
+    if (m_capacity.memoryBytes > 0 && m_reserved.memoryBytes + needed.memoryBytes > m_capacity.memoryBytes) {
+        return false;
+    }
+    
+    ++m_runningJobs;
+    m_reserved.cpus += needed.cpus;
+    m_reserved.memoryBytes += needed.memoryBytes;
+    return true;
+}
+
+void ResourceBudget::release(const ResourceReservation& reservation) {
+    ResourceReservation returned = effective(reservation);
+    m_runningJobs = qMax(0, m_runningJobs - 1);
+    m_reserved.cpus = qMax(0.0, m_reserved.cpus - returned.cpus);
+    m_reserved.memoryBytes = qMax<qint64>(0, m_reserved.memoryBytes - returned.memoryBytes);
+    
+    // Waiters are woken from the event loop, so the releasing executor can
+    // first hand the capacity to its own newly ready jobs
+    if (!m_releasePending) {
+        m_releasePending = true;
+        QMetaObject::invokeMethod(this, [this]() {
+            m_releasePending = false;
+            emit released();
+        }, Qt::QueuedConnection);
+    }
+}
+
+int ResourceBudget::maxJobs() const {
+    return m_maxJobs;
+}
+
+ResourceReservation ResourceBudget::capacity() const {
+    return m_capacity;
+}
+
+int ResourceBudget::runningJobs() const {
+    return m_runningJobs;
+}
+
+ResourceReservation ResourceBudget::reserved() const {
+    return m_reserved;
+}
+
+ResourceReservation ResourceBudget::hostCapacity() {
+    ResourceReservation host;
+    host.cpus = qMax(0, QThread::idealThreadCount());
+    
+#ifdef Q_OS_LINUX
+    QFile meminfo("/proc/meminfo");
+    if (meminfo.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QRegularExpression memTotal("^MemTotal:\\s+(\\d+)\\s+kB", QRegularExpression::MultilineOption);
+        QRegularExpressionMatch match = memTotal.match(QString::fromLatin1(meminfo.readAll()));
+        if (match.hasMatch()) {
+            host.memoryBytes = match.captured(1).toLongLong() * 1024;
+        }
+    }
+#endif
+    return host;
+}
+
+ResourceReservation ResourceBudget::effective(const ResourceReservation& reservation) const {
+    ResourceReservation clamped = reservation;
+    if (m_capacity.cpus > 0) {
+        clamped.cpus = qMin(clamped.cpus, m_capacity.cpus);
+    }
+    if (m_capacity.memoryBytes > 0) {
+        clamped.memoryBytes = qMin(clamped.memoryBytes, m_capacity.memoryBytes);
+    }
+    return clamped;
+}
+
+} // namespace core
+} // namespace gwt
@@ -0,0 +1,164 @@
+#include "core/RunJournal.h"
+#include "core/StorageProvider.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+
+namespace gwt {
+namespace core {
+
+RunJournal::RunJournal() = default;
+
+RunJournal::~RunJournal() = default;
+
+QString RunJournal::createRunId() {
+    return QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss") + "-"
+        + QString::number(QRandomGenerator::global()->bounded(0x10000), 16).rightJustified(4, '0');
+}
+
+bool RunJournal::load(const QString& runId) {
+    m_runId = runId;
+    m_workflowFile.clear();
+    m_repositoryPath.clear();
+    m_triggerEvent.clear();
+    m_succeeded.clear();
+
+    if (runId.isEmpty() || runId.contains('/') || runId.contains('\\')) {
+        return false;
+    }
+
+    QFile file(getJournalPath(runId));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // A killed run can leave a truncated last line, which is skipped
+    while (!file.atEnd()) {
+        QJsonObject record = QJsonDocument::fromJson(file.readLine()).object();
+        QString type = record["type"].toString();
+        QString jobId = record["job"].toString();
+
+        if (type == "run" && m_workflowFile.isEmpty()) {
+            m_workflowFile = record["workflow"].toString();
+            m_repositoryPath = record["repo"].toString();
+            m_triggerEvent = record["event"].toString();
+        } else if (type == "job-finished" && record["success"].toBool()) {
+            JobResult result;
+            for (const QJsonValue& value : record["steps"].toArray()) {
+                result.stepNames << value.toString();
+            }
+            m_succeeded[jobId] = result;
+        } else if (type == "job-started") {
+            m_succeeded.remove(jobId);
+        }
+    }
+
+    return !m_workflowFile.isEmpty();
+}
+
+bool RunJournal::open(const QString& runId) {
+    m_runId = runId;
+
+    QString path = getJournalPath(runId);
+    QDir().mkpath(QFileInfo(path).path());
+
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    m_file.setFileName(path);
+    return m_file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+QString RunJournal::runId() const {
+    return m_runId;
+}
+
+QString RunJournal::workflowFile() const {
+    return m_workflowFile;
+}
+
+QString RunJournal::repositoryPath() const {
+    return m_repositoryPath;
+}
+
+QString RunJournal::triggerEvent() const {
+    return m_triggerEvent;
+}
+
+QMap<QString, JobResult> RunJournal::succeededJobs() const {
+    return m_succeeded;
+}
+
+void RunJournal::recordRunStarted(const QString& workflowFile,
+                                  const QString& repoPath,
+                                  const QString& triggerEvent) {
+    QJsonObject record;
+    record["type"] = "run";
+    record["workflow"] = QFileInfo(workflowFile).absoluteFilePath();
+    record["repo"] = repoPath.isEmpty() ? QString() : QFileInfo(repoPath).absoluteFilePath();
+    record["event"] = triggerEvent;
+    append(record);
+}
+
+void RunJournal::recordJobStarted(const QString& jobId) {
+    QJsonObject record;
+    record["type"] = "job-started";
+    record["job"] = jobId;
+    append(record);
+}
+
+void RunJournal::recordStepStarted(const QString& jobId, const QString& stepName) {
+    QJsonObject record;
+    record["type"] = "step-started";
+    record["job"] = jobId;
+    record["step"] = stepName;
+    append(record);
+}
+
+void RunJournal::recordStepFinished(const QString& jobId, const QString& stepName, bool success) {
+    QJsonObject record;
+    record["type"] = "step-finished";
+    record["job"] = jobId;
+    record["step"] = stepName;
+    record["success"] = success;
+    append(record);
+}
+
+void RunJournal::recordJobFinished(const QString& jobId, bool success, const JobResult& result) {
+    QJsonObject record;
+    record["type"] = "job-finished";
+    record["job"] = jobId;
+    record["success"] = success;
+    if (success) {
+        record["steps"] = QJsonArray::fromStringList(result.stepNames);
+    }
+    append(record);
+}
+
+void RunJournal::recordRunFinished(bool success) {
+    QJsonObject record;
+    record["type"] = "run-finished";
+    record["success"] = success;
+    append(record);
+}
+
+QString RunJournal::getJournalPath(const QString& runId) const {
+    return StorageProvider::instance().getCacheRoot() + "/runs/" + runId + ".jsonl";
+}
+
+void RunJournal::append(QJsonObject record) {
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    record["time"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    m_file.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+    m_file.flush();
+}
+
+} // namespace core
+} // namespace gwt
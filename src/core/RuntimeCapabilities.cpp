@@ -0,0 +1,251 @@
+#include "core/RuntimeCapabilities.h"
+#include "core/StorageProvider.h"
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSaveFile>
+
+namespace gwt {
+namespace core {
+
+namespace {
+
+/**
+ * @brief A probe process, started on construction and collected later
+ */
+struct Probe {
+    QProcess process;
+
+    Probe(const QString& program, const QStringList& args) {
+        process.start(program, args);
+    }
+
+    /**
+     * @brief Wait for the probe to exit
+     * @return true if it exited successfully in time
+     */
+    bool succeeded(int timeoutMs) {
+        if (!process.waitForFinished(timeoutMs)) {
+            process.kill();
+            process.waitForFinished(1000);
+            return false;
+        }
+        return process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+    }
+
+    QString output() {
+        return QString::fromUtf8(process.readAllStandardOutput()).trimmed();
+    }
+};
+
+/**
+ * @brief Get a word of the first line of a --version output
+ */
+QString versionWord(const QString& output, int index) {
+    return output.section('\n', 0, 0).split(' ').value(index).remove(',');
+}
+
+// What the namespace backend does on start, on empty directories
+const char* USER_NAMESPACE_PROBE =
+    "d=$(mktemp -d) && mkdir \"$d/l\" \"$d/u\" \"$d/w\" \"$d/m\" \"$d/p\""
+    " && mount -t overlay overlay -o \"lowerdir=$d/l,upperdir=$d/u,workdir=$d/w\" \"$d/m\""
+    " && mount -t proc proc \"$d/p\"; s=$?; umount \"$d/p\" \"$d/m\" 2>/dev/null; rm -rf \"$d\"; exit $s";
+
+} // namespace
+
+RuntimeCapabilities::RuntimeCapabilities()
+    : m_cgroupV2(false)
+    , m_kvm(false)
+    , m_userNamespaces(false)
+    , m_userScopes(false)
+    , m_fromCache(false)
+{
+}
+
+RuntimeCapabilities::~RuntimeCapabilities() = default;
+
+const RuntimeCapabilities& RuntimeCapabilities::instance() {
+    static const RuntimeCapabilities capabilities = []() {
+        RuntimeCapabilities cached;
+        return cached.load() ? cached : probe();
+    }();
+    return capabilities;
+}
+
+RuntimeCapabilities RuntimeCapabilities::probe() {
+    // All probes run at the same time, so the slowest one sets the total time
+    Probe dockerVersion("docker", {"--version"});
+    Probe dockerInfo("docker", {"info", "--format", "{{json .SecurityOptions}}"});
+    Probe podmanVersion("podman", {"--version"});
+    Probe podmanInfo("podman", {"info", "--format", "{{.Host.Security.Rootless}}"});
+    Probe qemuVersion("qemu-system-x86_64", {"--version"});
+    Probe fuseOverlayfsVersion("fuse-overlayfs", {"--version"});
+    Probe userNamespaces("unshare", {"--user", "--map-root-user", "--mount", "--pid", "--fork",
+                                     "sh", "-c", USER_NAMESPACE_PROBE});
+    Probe userScopes("systemd-run", {"--user", "--scope", "--quiet", "--collect", "true"});
+
+    QDeadlineTimer deadline(PROBE_TIMEOUT_MS);
+    auto remaining = [&deadline]() {
+        return static_cast<int>(qMax<qint64>(0, deadline.remainingTime()));
+    };
+
+    RuntimeCapabilities capabilities;
+    capabilities.m_docker.available = dockerVersion.succeeded(remaining());
+    capabilities.m_docker.version = versionWord(dockerVersion.output(), 2);
+    capabilities.m_docker.rootless = dockerInfo.succeeded(remaining())
+        && dockerInfo.output().contains("rootless");
+
+    capabilities.m_podman.available = podmanVersion.succeeded(remaining());
+    capabilities.m_podman.version = versionWord(podmanVersion.output(), 2);
+    capabilities.m_podman.rootless = podmanInfo.succeeded(remaining())
+        && podmanInfo.output() == "true";
+
+    capabilities.m_qemu.available = qemuVersion.succeeded(remaining());
+    capabilities.m_qemu.version = versionWord(qemuVersion.output(), 3);
+
+    capabilities.m_fuseOverlayfs.available = fuseOverlayfsVersion.succeeded(remaining());
+    capabilities.m_fuseOverlayfs.version = versionWord(fuseOverlayfsVersion.output(), 2);
+
+    capabilities.m_userNamespaces = userNamespaces.succeeded(remaining());
+    capabilities.m_userScopes = userScopes.succeeded(remaining());
+
+    capabilities.m_cgroupV2 = QFileInfo::exists("/sys/fs/cgroup/cgroup.controllers");
+    QFileInfo kvm("/dev/kvm");
+    capabilities.m_kvm = kvm.exists() && kvm.isReadable() && kvm.isWritable();
+    capabilities.m_probedAt = QDateTime::currentDateTimeUtc();
+
+    capabilities.save();
+    return capabilities;
+}
+
+QString RuntimeCapabilities::containerRuntime() const {
+    if (m_docker.available) {
+        return "docker";
+    }
+    if (m_podman.available) {
+        return "podman";
+    }
+    return QString();
+}
+
+ToolInfo RuntimeCapabilities::docker() const {
+    return m_docker;
+}
+
+ToolInfo RuntimeCapabilities::podman() const {
+    return m_podman;
+}
+
+ToolInfo RuntimeCapabilities::qemu() const {
+    return m_qemu;
+}
+
+ToolInfo RuntimeCapabilities::fuseOverlayfs() const {
+    return m_fuseOverlayfs;
+}
+
+bool RuntimeCapabilities::hasCgroupV2() const {
+    return m_cgroupV2;
+}
+
+bool RuntimeCapabilities::hasKvm() const {
+    return m_kvm;
+}
+
+bool RuntimeCapabilities::hasUserNamespaces() const {
+    return m_userNamespaces;
+}
+
+bool RuntimeCapabilities::hasUserScopes() const {
+    return m_userScopes;
+}
+
+QDateTime RuntimeCapabilities::probedAt() const {
+    return m_probedAt;
+}
+
+bool RuntimeCapabilities::isFromCache() const {
+    return m_fromCache;
+}
+
+QString RuntimeCapabilities::getCachePath() {
+    return StorageProvider::instance().getCacheRoot() + "/capabilities.json";
+}
+
+bool RuntimeCapabilities::load() {
+    QFile file(getCachePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+
+    // Installing a tool usually goes along with a new PATH or a fresh shell;
+    // the TTL covers the rest
+    QDateTime probedAt = QDateTime::fromString(root["probedAt"].toString(), Qt::ISODate);
+    if (!probedAt.isValid()
+        || probedAt.secsTo(QDateTime::currentDateTimeUtc()) > CACHE_TTL_SECONDS
+        || probedAt > QDateTime::currentDateTimeUtc()
+        || root["path"].toString() != qEnvironmentVariable("PATH")) {
+        return false;
+    }
+
+    m_docker = toolFromJson(root["docker"].toObject());
+    m_podman = toolFromJson(root["podman"].toObject());
+    m_qemu = toolFromJson(root["qemu"].toObject());
+    m_fuseOverlayfs = toolFromJson(root["fuseOverlayfs"].toObject());
+    m_cgroupV2 = root["cgroupV2"].toBool();
+    m_kvm = root["kvm"].toBool();
+    m_userNamespaces = root["userNamespaces"].toBool();
+    m_userScopes = root["userScopes"].toBool();
+    m_probedAt = probedAt;
+    m_fromCache = true;
+    return true;
+}
+
+bool RuntimeCapabilities::save() const {
+    QJsonObject root;
+    root["probedAt"] = m_probedAt.toString(Qt::ISODate);
+    root["path"] = qEnvironmentVariable("PATH");
+    root["docker"] = toolToJson(m_docker);
+    root["podman"] = toolToJson(m_podman);
+    root["qemu"] = toolToJson(m_qemu);
+    root["fuseOverlayfs"] = toolToJson(m_fuseOverlayfs);
+    root["cgroupV2"] = m_cgroupV2;
+    root["kvm"] = m_kvm;
+    root["userNamespaces"] = m_userNamespaces;
+    root["userScopes"] = m_userScopes;
+
+    QString path = getCachePath();
+    QDir().mkpath(QFileInfo(path).path());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    return file.commit();
+}
+
+QJsonObject RuntimeCapabilities::toolToJson(const ToolInfo& tool) {
+    QJsonObject object;
+    object["available"] = tool.available;
+    object["version"] = tool.version;
+    object["rootless"] = tool.rootless;
+    return object;
+}
+
+ToolInfo RuntimeCapabilities::toolFromJson(const QJsonObject& object) {
+    ToolInfo tool;
+    tool.available = object["available"].toBool();
+    tool.version = object["version"].toString();
+    tool.rootless = object["rootless"].toBool();
+    return tool;
+}
+
+} // namespace core
+} // namespace gwt
@@ -20,6 +20,7 @@ StorageProvider::StorageProvider() {
     QString appData = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     m_repoRoot = appData + "/repos";
     m_cacheRoot = appData + "/cache";
+    m_configRoot = appData + "/config";
 #else
     // Linux: XDG directories
     QString dataHome = qEnvironmentVariable("XDG_DATA_HOME");
@@ -33,6 +34,12 @@ StorageProvider::StorageProvider() {
         cacheHome = QDir::homePath() + "/.cache";
     }
     m_cacheRoot = cacheHome + "/githubworkflowtool";
+
+    QString configHome = qEnvironmentVariable("XDG_CONFIG_HOME");
+    if (configHome.isEmpty()) {
+        configHome = QDir::homePath() + "/.config";
+    }
+    m_configRoot = configHome + "/githubworkflowtool";
 #endif
 
     ensureDirectoriesExist();
@@ -46,6 +53,10 @@ QString StorageProvider::getCacheRoot() const {
     return m_cacheRoot;
 }
 
+QString StorageProvider::getConfigRoot() const {
+    return m_configRoot;
+}
+
 QString StorageProvider::getRepoDirectory(const QString& repoUrl) const {
     QString key = generateRepoKey(repoUrl);
     return m_repoRoot + "/" + key;
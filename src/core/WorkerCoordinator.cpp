@@ -0,0 +1,208 @@
+#include "core/WorkerCoordinator.h"
+#include "core/WorkerProtocol.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+
+namespace gwt {
+namespace core {
+
+WorkerLease::WorkerLease(WorkerCoordinator* coordinator, qint64 id, QObject* parent)
+    : QObject(parent)
+    , m_coordinator(coordinator)
+    , m_id(id)
+    , m_worker(nullptr)
+    , m_released(false)
+{
+}
+
+WorkerLease::~WorkerLease() {
+    release();
+}
+
+qint64 WorkerLease::id() const {
+    return m_id;
+}
+
+bool WorkerLease::isGranted() const {
+    return m_worker != nullptr;
+}
+
+QString WorkerLease::workerName() const {
+    if (!m_coordinator || !m_worker) {
+        return QString();
+    }
+    return m_coordinator->m_workers.value(m_worker).name;
+}
+
+void WorkerLease::send(QJsonObject message) {
+    if (m_coordinator && m_worker && !m_released) {
+        message["lease"] = m_id;
+        m_coordinator->sendToWorker(this, message);
+    }
+}
+
+void WorkerLease::release() {
+    if (m_released) {
+        return;
+    }
+    m_released = true;
+    if (m_coordinator) {
+        m_coordinator->releaseLease(this);
+    }
+}
+
+WorkerCoordinator::WorkerCoordinator(QObject* parent)
+    : QObject(parent)
+    , m_server(new QLocalServer(this))
+    , m_nextLeaseId(1)
+{
+    connect(m_server, &QLocalServer::newConnection, this, &WorkerCoordinator::acceptWorkers);
+}
+
+WorkerCoordinator::~WorkerCoordinator() = default;
+
+bool WorkerCoordinator::listen(const QString& socketPath) {
+    // A coordinator that crashed leaves its socket file behind
+    QLocalServer::removeServer(socketPath);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    
+    if (!m_server->listen(socketPath)) {
+        emit error("Cannot listen on " + socketPath + ": " + m_server->errorString());
+        return false;
+    }
+    return true;
+}
+
+WorkerLease* WorkerCoordinator::requestLease(QObject* parent) {
+    WorkerLease* lease = new WorkerLease(this, m_nextLeaseId++, parent);
+    m_pending << lease;
+    
+    // Grant from the event loop, so the caller can connect to granted() first
+    QMetaObject::invokeMethod(this, &WorkerCoordinator::assignLeases, Qt::QueuedConnection);
+    return lease;
+}
+
+int WorkerCoordinator::workerCount() const {
+    return m_workers.size();
+}
+
+void WorkerCoordinator::acceptWorkers() {
+    while (m_server->hasPendingConnections()) {
+        QLocalSocket* socket = m_server->nextPendingConnection();
+        
+        // A worker gets slots only after its hello message
+        Worker worker;
+        worker.channel = new MessageChannel(socket, socket);
+        m_workers.insert(socket, worker);
+        
+        connect(worker.channel, &MessageChannel::messageReceived, this,
+                [this, socket](const QJsonObject& message) {
+            handleMessage(socket, message);
+        });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            removeWorker(socket);
+        });
+    }
+}
+
+void WorkerCoordinator::handleMessage(QLocalSocket* socket, const QJsonObject& message) {
+    auto worker = m_workers.find(socket);
+    if (worker == m_workers.end()) {
+        return;
+    }
+    
+    if (message["type"].toString() == "hello") {
+        if (message["protocol"].toInt() != protocol::VERSION) {
+            emit error("Rejecting worker with protocol version " + QString::number(message["protocol"].toInt()));
+            socket->disconnectFromServer();
+            return;
+        }
+        worker->name = message["name"].toString();
+        worker->slotCount = qMax(1, message["slots"].toInt(1));
+        emit workerConnected(worker->name, worker->slotCount);
+        assignLeases();
+        return;
+    }
+    
+    // The receiver may release the lease, so find it before emitting
+    qint64 leaseId = message["lease"].toInteger();
+    QPointer<WorkerLease> target;
+    for (const QPointer<WorkerLease>& lease : worker->leases) {
+        if (lease && lease->id() == leaseId) {
+            target = lease;
+            break;
+        }
+    }
+    if (target) {
+        emit target->messageReceived(message);
+    }
+}
+
+void WorkerCoordinator::removeWorker(QLocalSocket* socket) {
+    auto worker = m_workers.find(socket);
+    if (worker == m_workers.end()) {
+        return;
+    }
+    
+    QString name = worker->name;
+    QList<QPointer<WorkerLease>> leases = worker->leases;
+    m_workers.erase(worker);
+    socket->deleteLater();
+    
+    // The jobs on this worker fail; their owners see the lease as lost
+    for (const QPointer<WorkerLease>& lease : leases) {
+        if (lease) {
+            lease->m_worker = nullptr;
+            lease->m_released = true;
+            emit lease->lost();
+        }
+    }
+    
+    emit workerDisconnected(name);
+}
+
+void WorkerCoordinator::releaseLease(WorkerLease* lease) {
+    m_pending.removeAll(lease);
+    
+    auto worker = m_workers.find(lease->m_worker);
+    if (worker != m_workers.end()) {
+        worker->leases.removeAll(lease);
+        lease->m_worker = nullptr;
+        QMetaObject::invokeMethod(this, &WorkerCoordinator::assignLeases, Qt::QueuedConnection);
+    }
+}
+
+void WorkerCoordinator::sendToWorker(WorkerLease* lease, const QJsonObject& message) {
+    auto worker = m_workers.find(lease->m_worker);
+    if (worker != m_workers.end()) {
+        worker->channel->send(message);
+    }
+}
+
+void WorkerCoordinator::assignLeases() {
+    m_pending.removeAll(QPointer<WorkerLease>());
+    
+    while (!m_pending.isEmpty()) {
+        // Spread jobs by picking the worker with the most free slots
+        QLocalSocket* best = nullptr;
+        int bestFree = 0;
+        for (auto it = m_workers.begin(); it != m_workers.end(); ++it) {
+            int free = it->slotCount - it->leases.size();
+            if (free > bestFree) {
+                best = it.key();
+                bestFree = free;
+            }
+        }
+        if (!best) {
+            return;
+        }
+        
+        QPointer<WorkerLease> lease = m_pending.takeFirst();
+        lease->m_worker = best;
+        m_workers[best].leases << lease;
+        emit lease->granted();
+    }
+}
+
+} // namespace core
+} // namespace gwt
@@ -0,0 +1,126 @@
+#include "core/WorkerProtocol.h"
+#include "core/StorageProvider.h"
+#include <QIODevice>
+#include <QJsonDocument>
+
+namespace gwt {
+namespace core {
+
+namespace protocol {
+
+QString defaultSocketPath() {
+    return StorageProvider::instance().getCacheRoot() + "/coordinator.sock";
+}
+
+QJsonObject stepToJson(const WorkflowStep& step) {
+    QJsonObject object;
+    object["name"] = step.name;
+    object["id"] = step.id;
+    object["run"] = step.run;
+    object["uses"] = step.uses;
+    object["with"] = QJsonObject::fromVariantMap(step.with);
+    object["env"] = QJsonObject::fromVariantMap(step.env);
+    object["workingDirectory"] = step.workingDirectory;
+    object["shell"] = step.shell;
+    object["if"] = step.ifCondition;
+    return object;
+}
+
+WorkflowStep stepFromJson(const QJsonObject& object) {
+    WorkflowStep step;
+    step.name = object["name"].toString();
+    step.id = object["id"].toString();
+    step.run = object["run"].toString();
+    step.uses = object["uses"].toString();
+    step.with = object["with"].toObject().toVariantMap();
+    step.env = object["env"].toObject().toVariantMap();
+    step.workingDirectory = object["workingDirectory"].toString();
+    step.shell = object["shell"].toString();
+    step.ifCondition = object["if"].toString();
+    return step;
+}
+
+QString backendTypeName(backends::BackendType type) {
+    switch (type) {
+    case backends::BackendType::Qemu:
+        return "qemu";
+    case backends::BackendType::Namespace:
+        return "namespace";
+    case backends::BackendType::Container:
+        break;
+    }
+    return "container";
+}
+
+backends::BackendType backendTypeFromName(const QString& name) {
+    if (name == "qemu") {
+        return backends::BackendType::Qemu;
+    }
+    if (name == "namespace") {
+        return backends::BackendType::Namespace;
+    }
+    return backends::BackendType::Container;
+}
+
+QJsonObject usageToJson(const ResourceUsage& usage) {
+    QJsonObject object;
+    if (!usage.valid) {
+        return object;
+    }
+    object["cpuSeconds"] = usage.cpuSeconds;
+    object["peakMemory"] = usage.peakMemoryBytes;
+    object["ioRead"] = usage.ioReadBytes;
+    object["ioWrite"] = usage.ioWriteBytes;
+    object["cpuStall"] = usage.cpuStallSeconds;
+    object["memoryStall"] = usage.memoryStallSeconds;
+    object["ioStall"] = usage.ioStallSeconds;
+    return object;
+}
+
+ResourceUsage usageFromJson(const QJsonObject& object) {
+    ResourceUsage usage;
+    usage.valid = !object.isEmpty();
+    usage.cpuSeconds = object["cpuSeconds"].toDouble();
+    usage.peakMemoryBytes = object["peakMemory"].toInteger();
+    usage.ioReadBytes = object["ioRead"].toInteger();
+    usage.ioWriteBytes = object["ioWrite"].toInteger();
+    usage.cpuStallSeconds = object["cpuStall"].toDouble();
+    usage.memoryStallSeconds = object["memoryStall"].toDouble();
+    usage.ioStallSeconds = object["ioStall"].toDouble();
+    return usage;
+}
+
+} // namespace protocol
+
+MessageChannel::MessageChannel(QIODevice* device, QObject* parent)
+    : QObject(parent)
+    , m_device(device)
+{
+    connect(device, &QIODevice::readyRead, this, &MessageChannel::readMessages);
+}
+
+MessageChannel::~MessageChannel() = default;
+
+void MessageChannel::send(const QJsonObject& message) {
+    if (m_device && m_device->isOpen()) {
+        m_device->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+    }
+}
+
+void MessageChannel::readMessages() {
+    m_buffer += m_device->readAll();
+    
+    int newline;
+    while ((newline = m_buffer.indexOf('\n')) != -1) {
+        QByteArray line = m_buffer.left(newline);
+        m_buffer.remove(0, newline + 1);
+        
+        QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (doc.isObject()) {
+            emit messageReceived(doc.object());
+        }
+    }
+}
+
+} // namespace core
+} // namespace gwt
@@ -0,0 +1,150 @@
+#include "core/WorkerSession.h"
+#include "core/WorkerProtocol.h"
+#include "backends/ContainerBackend.h"
+#include "backends/NamespaceBackend.h"
+#include "backends/QemuBackend.h"
+#include <QCoreApplication>
+#include <QLocalSocket>
+#include <QSysInfo>
+
+namespace gwt {
+namespace core {
+
+WorkerSession::WorkerSession(int slotCount, QObject* parent)
+    : QObject(parent)
+    , m_slotCount(qMax(1, slotCount))
+    , m_socket(new QLocalSocket(this))
+    , m_channel(new MessageChannel(m_socket, this))
+    , m_connected(false)
+{
+    connect(m_channel, &MessageChannel::messageReceived, this, &WorkerSession::handleMessage);
+    
+    connect(m_socket, &QLocalSocket::connected, this, [this]() {
+        m_connected = true;
+        QJsonObject hello;
+        hello["type"] = "hello";
+        hello["protocol"] = protocol::VERSION;
+        hello["name"] = QSysInfo::machineHostName() + ":" + QString::number(QCoreApplication::applicationPid());
+        hello["slots"] = m_slotCount;
+        m_channel->send(hello);
+        emit connected();
+    });
+    
+    connect(m_socket, &QLocalSocket::errorOccurred, this, [this](QLocalSocket::LocalSocketError) {
+        // Once connected, the end of the session is handled on disconnected()
+        if (!m_connected) {
+            emit error("Coordinator connection failed: " + m_socket->errorString());
+            emit finished();
+        }
+    });
+    
+    connect(m_socket, &QLocalSocket::disconnected, this, [this]() {
+        // Destroying a backend removes its environment without blocking
+        m_backends.clear();
+        emit finished();
+    });
+}
+
+WorkerSession::~WorkerSession() = default;
+
+void WorkerSession::connectToCoordinator(const QString& socketPath) {
+    m_socket->connectToServer(socketPath);
+}
+
+int WorkerSession::activeLeases() const {
+    return static_cast<int>(m_backends.size());
+}
+
+void WorkerSession::handleMessage(const QJsonObject& message) {
+    QString type = message["type"].toString();
+    qint64 leaseId = message["lease"].toInteger();
+    
+    if (type == "prepare") {
+        prepare(leaseId, message);
+        return;
+    }
+    
+    auto it = m_backends.find(leaseId);
+    if (it == m_backends.end()) {
+        if (type == "cleanup") {
+            send(leaseId, QJsonObject{{"type", "cleanupFinished"}});
+        }
+        return;
+    }
+    backends::ExecutionBackend* backend = it->second.get();
+    
+    if (type == "execute") {
+        backend->executeStep(protocol::stepFromJson(message["step"].toObject()),
+                             message["context"].toObject().toVariantMap());
+    } else if (type == "cancel") {
+        backend->cancel();
+    } else if (type == "cleanup") {
+        backend->cleanup();
+    }
+}
+
+void WorkerSession::prepare(qint64 leaseId, const QJsonObject& message) {
+    std::unique_ptr<backends::ExecutionBackend> backend;
+    switch (protocol::backendTypeFromName(message["backend"].toString())) {
+    case backends::BackendType::Qemu:
+        backend = std::make_unique<backends::QemuBackend>();
+        break;
+    case backends::BackendType::Namespace:
+        backend = std::make_unique<backends::NamespaceBackend>();
+        break;
+    case backends::BackendType::Container:
+        backend = std::make_unique<backends::ContainerBackend>();
+        break;
+    }
+    
+    ResourceReservation limits;
+    limits.cpus = message["cpus"].toDouble();
+    limits.memoryBytes = message["memory"].toInteger();
+    backend->setResourceLimits(limits);
+    backend->setWorkspace(message["workspace"].toString());
+    
+    backends::ExecutionBackend* backendPtr = backend.get();
+    m_backends[leaseId] = std::move(backend);
+    
+    connect(backendPtr, &backends::ExecutionBackend::output, this, [this, leaseId](const QString& text) {
+        send(leaseId, QJsonObject{{"type", "output"}, {"text", text}});
+    });
+    connect(backendPtr, &backends::ExecutionBackend::error, this, [this, leaseId](const QString& text) {
+        send(leaseId, QJsonObject{{"type", "error"}, {"message", text}});
+    });
+    // Usage is measured here and travels with the completion it belongs to
+    connect(backendPtr, &backends::ExecutionBackend::environmentPrepared, this,
+            [this, leaseId, backendPtr](bool success) {
+        send(leaseId, QJsonObject{{"type", "prepared"}, {"success", success},
+                                  {"usage", protocol::usageToJson(backendPtr->takeResourceUsage())}});
+    });
+    connect(backendPtr, &backends::ExecutionBackend::stepCompleted, this,
+            [this, leaseId, backendPtr](bool success) {
+        send(leaseId, QJsonObject{{"type", "stepCompleted"}, {"success", success},
+                                  {"usage", protocol::usageToJson(backendPtr->takeResourceUsage())}});
+    });
+    connect(backendPtr, &backends::ExecutionBackend::cleanupFinished, this, [this, leaseId]() {
+        send(leaseId, QJsonObject{{"type", "cleanupFinished"}});
+        
+        // We are inside a signal of this backend, so it must outlive the handler
+        auto it = m_backends.find(leaseId);
+        if (it != m_backends.end()) {
+            it->second->disconnect(this);
+            it->second.release()->deleteLater();
+            m_backends.erase(it);
+        }
+        emit leaseFinished(leaseId);
+    });
+    
+    QString runsOn = message["runsOn"].toString();
+    emit leaseStarted(leaseId, runsOn);
+    backendPtr->prepareEnvironment(runsOn);
+}
+
+void WorkerSession::send(qint64 leaseId, QJsonObject message) {
+    message["lease"] = leaseId;
+    m_channel->send(message);
+}
+
+} // namespace core
+} // namespace gwt
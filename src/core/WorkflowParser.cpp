@@ -138,6 +138,16 @@ Workflow WorkflowParser::parse(const QString& filePath) {
                         
                         job.strategy["matrix"] = matrixMap;
                     }
+                    
+                    // Either may be a ${{ }} expression, which gets the
+                    // default: fail fast, no limit on parallel variants
+                    if (strategyNode["fail-fast"]) {
+                        job.strategy["fail-fast"] = strategyNode["fail-fast"].as<bool>(true);
+                    }
+                    
+                    if (strategyNode["max-parallel"]) {
+                        job.strategy["max-parallel"] = strategyNode["max-parallel"].as<int>(0);
+                    }
                 }
                 
                 workflow.jobs[jobId] = job;
@@ -2,9 +2,11 @@
 #include "core/RepoManager.h"
 #include "core/JobExecutor.h"
 #include "core/WorkflowDiscovery.h"
+#include "core/WorkflowParser.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QTreeWidget>
+#include <QTextDocument>
 #include <QTextEdit>
 #include <QPushButton>
 #include <QComboBox>
@@ -28,6 +30,18 @@ MainWindow::MainWindow(QWidget* parent)
     // Connect signals
     connect(m_executor.get(), &core::JobExecutor::stepOutput,
             this, &MainWindow::onJobOutput);
+    connect(m_executor.get(), &core::JobExecutor::imageProgress,
+            this, &MainWindow::onImageProgress);
+    connect(m_executor.get(), &core::JobExecutor::executionFinished,
+            this, &MainWindow::onExecutionFinished);
+    connect(m_executor.get(), &core::JobExecutor::executionStopped,
+            this, &MainWindow::onExecutionStopped);
+    connect(m_executor.get(), &core::JobExecutor::error,
+            this, &MainWindow::onError);
+    connect(m_repoManager.get(), &core::RepoManager::cloneFinished,
+            this, &MainWindow::onCloneFinished);
+    connect(m_repoManager.get(), &core::RepoManager::error,
+            this, &MainWindow::onError);
 }
 
 MainWindow::~MainWindow() = default;
@@ -73,13 +87,17 @@ void MainWindow::setupUI() {
     // Execution controls
     QHBoxLayout* execLayout = new QHBoxLayout();
     m_runButton = new QPushButton("Run Workflow", this);
+    m_stopButton = new QPushButton("Stop", this);
+    m_stopButton->setEnabled(false);
     m_backendCombo = new QComboBox(this);
     m_backendCombo->addItem("Container Backend");
     m_backendCombo->addItem("QEMU Backend");
+    m_backendCombo->addItem("Namespace Backend");
     
     execLayout->addWidget(new QLabel("Backend:", this));
     execLayout->addWidget(m_backendCombo);
     execLayout->addWidget(m_runButton);
+    execLayout->addWidget(m_stopButton);
     execLayout->addStretch();
     
     mainLayout->addLayout(execLayout);
@@ -90,6 +108,8 @@ void MainWindow::setupUI() {
     
     m_outputView = new QTextEdit(this);
     m_outputView->setReadOnly(true);
+    // Full job logs are on disk; keep the view from growing without bound
+    m_outputView->document()->setMaximumBlockCount(MAX_OUTPUT_LINES);
     mainLayout->addWidget(m_outputView);
     
     // Connect signals
@@ -97,6 +117,7 @@ void MainWindow::setupUI() {
     connect(refreshButton, &QPushButton::clicked, this, &MainWindow::onRefreshRepositories);
     connect(m_repoTree, &QTreeWidget::itemSelectionChanged, this, &MainWindow::onRepositorySelected);
     connect(m_runButton, &QPushButton::clicked, this, &MainWindow::onRunWorkflow);
+    connect(m_stopButton, &QPushButton::clicked, this, &MainWindow::onStopWorkflow);
 }
 
 void MainWindow::loadRepositories() {
@@ -122,14 +143,24 @@ void MainWindow::onCloneRepository() {
         m_outputView->append("Cloning: " + repoUrl);
         
         if (m_repoManager->cloneRepository(repoUrl)) {
-            m_outputView->append("Successfully cloned");
-            loadRepositories();
+            m_cloneButton->setEnabled(false);
         } else {
             QMessageBox::warning(this, "Clone Failed", "Failed to clone repository");
         }
     }
 }
 
+void MainWindow::onCloneFinished(bool success) {
+    m_cloneButton->setEnabled(true);
+    
+    if (success) {
+        m_outputView->append("Successfully cloned");
+        loadRepositories();
+    } else {
+        QMessageBox::warning(this, "Clone Failed", "Failed to clone repository");
+    }
+}
+
 void MainWindow::onRefreshRepositories() {
     loadRepositories();
 }
@@ -175,14 +206,45 @@ void MainWindow::onRunWorkflow() {
         return;
     }
     
-    bool useQemu = m_backendCombo->currentIndex() == 1;
-    m_executor->executeWorkflow(workflow, "push", useQemu);
+    // Jobs see the selected repository as their workspace
+    QList<QTreeWidgetItem*> repos = m_repoTree->selectedItems();
+    m_executor->setRepositoryPath(repos.isEmpty() ? QString() : repos[0]->data(0, Qt::UserRole).toString());
+    
+    // Combo entries follow the order of BackendType
+    auto backendType = static_cast<backends::BackendType>(m_backendCombo->currentIndex());
+    if (m_executor->executeWorkflow(workflow, "push", backendType)) {
+        m_runButton->setEnabled(false);
+        m_stopButton->setEnabled(true);
+    }
+}
+
+void MainWindow::onStopWorkflow() {
+    m_stopButton->setEnabled(false);
+    m_outputView->append("Stopping workflow...");
+    m_executor->stopExecution();
+}
+
+void MainWindow::onExecutionFinished(bool success) {
+    m_runButton->setEnabled(true);
+    m_stopButton->setEnabled(false);
+    m_outputView->append(success ? "\n=== Workflow succeeded ===\n" : "\n=== Workflow failed ===\n");
+}
+
+void MainWindow::onExecutionStopped(qint64 elapsedMs) {
+    m_outputView->append(QString("Cancelled in %1 ms").arg(elapsedMs));
+}
+
+void MainWindow::onError(const QString& errorMessage) {
+    m_outputView->append("Error: " + errorMessage);
 }
 
 void MainWindow::onJobOutput(const QString& jobId, const QString& stepName, const QString& output) {
-    Q_UNUSED(jobId);
     Q_UNUSED(stepName);
-    m_outputView->append(output);
+    m_outputView->append("[" + jobId + "] " + output);
+}
+
+void MainWindow::onImageProgress(const QString& image, const QString& status) {
+    m_outputView->append("[pull " + image + "] " + status);
 }
 
 } // namespace gui
@@ -0,0 +1,306 @@
+#include "FakeEngine.h"
+#include "backends/EngineClient.h"
+#include "backends/EngineStream.h"
+#include "core/ResourceBudget.h"
+#include <QJsonDocument>
+#include <QHash>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QTest>
+#include <QTimer>
+#include <memory>
+
+using gwt::backends::EngineClient;
+using gwt::backends::EngineReply;
+using gwt::backends::EngineStream;
+using gwt::tests::FakeEngine;
+using gwt::tests::FakeRequest;
+
+namespace {
+
+constexpr int TIMEOUT_MS = 5000;
+
+} // namespace
+
+/**
+ * @brief EngineClient and EngineStream against a fake engine socket
+ */
+class EngineClientTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void chunkedBody();
+    void closeDelimitedBody();
+    void keepAliveReuse();
+    void retryClosedIdleConnection();
+    void createPullCreate();
+    void execAttachHijack_data();
+    void execAttachHijack();
+    void frameDemuxSplitReads();
+
+private:
+    EngineReply get(const QString& path);
+
+    std::unique_ptr<FakeEngine> m_engine;
+    std::unique_ptr<EngineClient> m_client;
+};
+
+void EngineClientTest::init() {
+    m_engine = std::make_unique<FakeEngine>();
+    QVERIFY(m_engine->listen());
+    m_client = std::make_unique<EngineClient>(m_engine->socketPath());
+}
+
+void EngineClientTest::cleanup() {
+    m_client.reset();
+    m_engine.reset();
+}
+
+EngineReply EngineClientTest::get(const QString& path) {
+    // The client times out first, so a missing reply shows up as this error
+    EngineReply result;
+    result.transportError = "EngineClient never answered";
+    bool done = false;
+    m_client->request("GET", path, QJsonDocument(), TIMEOUT_MS, [&](const EngineReply& reply) {
+        result = reply;
+        done = true;
+    });
+    QTest::qWaitFor([&]() { return done; }, 2 * TIMEOUT_MS);
+    return result;
+}
+
+void EngineClientTest::chunkedBody() {
+    m_engine->setHandler([](QLocalSocket* socket, const FakeRequest&) {
+        QByteArray response = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                            + FakeEngine::chunked({"hello", " world"});
+        // Split inside a chunk size line, a payload and the final CRLF
+        int headers = response.indexOf("\r\n\r\n") + 4;
+        FakeEngine::writeInPieces(socket, {response.left(headers + 4), response.mid(headers + 4, 10),
+                                           response.mid(headers + 14, 3), response.mid(headers + 17)});
+    });
+
+    EngineReply reply = get("/chunked");
+    QVERIFY2(reply.transportError.isEmpty(), qPrintable(reply.transportError));
+    QCOMPARE(reply.status, 200);
+    QCOMPARE(reply.body, QByteArray("hello world"));
+
+    // The connection was kept alive and is reused
+    QVERIFY(get("/chunked").isSuccess());
+    QCOMPARE(m_engine->connectionCount(), 1);
+}
+
+void EngineClientTest::closeDelimitedBody() {
+    m_engine->setHandler([](QLocalSocket* socket, const FakeRequest&) {
+        QPointer<QLocalSocket> target = socket;
+        FakeEngine::writeInPieces(socket, {"HTTP/1.1 200 OK\r\nConnection: close\r\n\r\nfirst ", "second"},
+                                  [target]() {
+            if (target) {
+                target->disconnectFromServer();
+            }
+        });
+    });
+
+    EngineReply reply = get("/close-delimited");
+    QVERIFY2(reply.transportError.isEmpty(), qPrintable(reply.transportError));
+    QCOMPARE(reply.status, 200);
+    QCOMPARE(reply.body, QByteArray("first second"));
+
+    // Connection: close is not reused
+    QVERIFY(get("/close-delimited").isSuccess());
+    QCOMPARE(m_engine->connectionCount(), 2);
+}
+
+void EngineClientTest::keepAliveReuse() {
+    m_engine->setHandler([](QLocalSocket* socket, const FakeRequest& request) {
+        socket->write(FakeEngine::response(200, "{\"path\":\"" + request.path + "\"}"));
+    });
+
+    EngineReply first = get("/first");
+    EngineReply second = get("/second");
+    QCOMPARE(first.json().object()["path"].toString(), QString("/first"));
+    QCOMPARE(second.json().object()["path"].toString(), QString("/second"));
+
+    QCOMPARE(m_engine->connectionCount(), 1);
+    QList<FakeRequest> requests = m_engine->requests();
+    QCOMPARE(requests.size(), qsizetype(2));
+    QCOMPARE(requests[1].connection, 1);
+}
+
+void EngineClientTest::retryClosedIdleConnection() {
+    // The engine answers once per connection and drops the next request,
+    // like an engine whose keep-alive timeout expired as the request went out
+    QHash<int, int> served;
+    m_engine->setHandler([&served](QLocalSocket* socket, const FakeRequest& request) {
+        if (served[request.connection]++ > 0) {
+            socket->abort();
+            return;
+        }
+        socket->write(FakeEngine::response(200, "{}"));
+    });
+
+    QVERIFY(get("/first").isSuccess());
+    EngineReply reply = get("/second");
+    QVERIFY2(reply.transportError.isEmpty(), qPrintable(reply.transportError));
+    QCOMPARE(reply.status, 200);
+
+    QCOMPARE(m_engine->connectionCount(), 2);
+    QCOMPARE(m_engine->paths(), QList<QByteArray>({"/first", "/second", "/second"}));
+}
+
+void EngineClientTest::createPullCreate() {
+    bool pulled = false;
+    m_engine->setHandler([&pulled](QLocalSocket* socket, const FakeRequest& request) {
+        if (request.path.startsWith("/containers/create")) {
+            socket->write(pulled ? FakeEngine::response(201, "{\"Id\":\"c0ffee\"}")
+                                 : FakeEngine::response(404, "{\"message\":\"No such image: alpine:latest\"}"));
+        } else if (request.path.startsWith("/images/create")) {
+            pulled = true;
+            socket->write("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                          + FakeEngine::chunked({"{\"status\":\"Pulling from library/alpine\"}\n",
+                                                 "{\"status\":\"Downloaded newer image\"}\n"}));
+        } else if (request.path == "/containers/c0ffee/start") {
+            socket->write("HTTP/1.1 204 No Content\r\n\r\n");
+        } else {
+            socket->write(FakeEngine::response(500, "{\"message\":\"unexpected request\"}"));
+        }
+    });
+
+    QString containerId;
+    QString error;
+    bool done = false;
+    m_client->runContainer("gwt-test", "alpine", gwt::core::ResourceReservation(), QString(), TIMEOUT_MS,
+                           [&](const QString& id, const QString& errorMessage) {
+        containerId = id;
+        error = errorMessage;
+        done = true;
+    });
+    QTRY_VERIFY_WITH_TIMEOUT(done, TIMEOUT_MS);
+
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+    QCOMPARE(containerId, QString("c0ffee"));
+    QList<QByteArray> paths = m_engine->paths();
+    QCOMPARE(paths.size(), qsizetype(4));
+    QCOMPARE(paths[0], QByteArray("/containers/create?name=gwt-test"));
+    QCOMPARE(paths[1], QByteArray("/images/create?fromImage=alpine%3Alatest"));
+    QCOMPARE(paths[2], QByteArray("/containers/create?name=gwt-test"));
+    QCOMPARE(paths[3], QByteArray("/containers/c0ffee/start"));
+    QCOMPARE(QJsonDocument::fromJson(m_engine->requests()[2].body).object()["Image"].toString(),
+             QString("alpine"));
+}
+
+void EngineClientTest::execAttachHijack_data() {
+    QTest::addColumn<QByteArray>("statusLine");
+
+    // Docker answers the upgrade with 101; older engines and Podman with 200
+    QTest::newRow("101") << QByteArray("HTTP/1.1 101 UPGRADED");
+    QTest::newRow("200") << QByteArray("HTTP/1.1 200 OK");
+}
+
+void EngineClientTest::execAttachHijack() {
+    QFETCH(QByteArray, statusLine);
+
+    QPointer<QLocalSocket> hijacked;
+    m_engine->setHandler([&](QLocalSocket* socket, const FakeRequest& request) {
+        if (request.path == "/containers/c1/exec") {
+            socket->write(FakeEngine::response(201, "{\"Id\":\"e1\"}"));
+        } else if (request.path == "/exec/e1/start") {
+            m_engine->hijack(socket);
+            hijacked = socket;
+            // The first frame arrives together with the headers
+            QByteArray stderrFrame = FakeEngine::frame(2, "err1\n");
+            FakeEngine::writeInPieces(socket, {statusLine + "\r\nContent-Type: application/vnd.docker.raw-stream\r\n"
+                                               "Connection: Upgrade\r\nUpgrade: tcp\r\n\r\n"
+                                               + FakeEngine::frame(1, "out1\n"),
+                                               stderrFrame.left(6), stderrFrame.mid(6)});
+        } else {
+            socket->write(FakeEngine::response(500, "{\"message\":\"unexpected request\"}"));
+        }
+    });
+
+    EngineStream* stream = nullptr;
+    QString error;
+    bool done = false;
+    m_client->execAttached("c1", {"sh"}, TIMEOUT_MS, [&](EngineStream* attached, const QString& errorMessage) {
+        stream = attached;
+        error = errorMessage;
+        done = true;
+    });
+    QTRY_VERIFY_WITH_TIMEOUT(done, TIMEOUT_MS);
+    QVERIFY2(stream, qPrintable(error));
+    std::unique_ptr<EngineStream> owner(stream);
+
+    QByteArray output;
+    bool finished = false;
+    connect(stream, &QIODevice::readyRead, this, [&]() {
+        output += stream->readAll();
+    });
+    connect(stream, &QIODevice::readChannelFinished, this, [&]() {
+        finished = true;
+    });
+    // Frames may have been unpacked while we waited for the attach
+    output += stream->readAll();
+
+    // stdin goes to the hijacked connection unframed
+    QVERIFY(stream->write("echo hi\n") > 0);
+    QTRY_COMPARE_WITH_TIMEOUT(m_engine->rawInput(), QByteArray("echo hi\n"), TIMEOUT_MS);
+
+    // stdout and stderr are merged in arrival order
+    QTRY_COMPARE_WITH_TIMEOUT(output, QByteArray("out1\nerr1\n"), TIMEOUT_MS);
+
+    QVERIFY(hijacked);
+    hijacked->disconnectFromServer();
+    QTRY_VERIFY_WITH_TIMEOUT(finished, TIMEOUT_MS);
+}
+
+void EngineClientTest::frameDemuxSplitReads() {
+    auto* socket = new QLocalSocket;
+    socket->connectToServer(m_engine->socketPath());
+    QVERIFY(socket->waitForConnected(TIMEOUT_MS));
+    QTRY_VERIFY_WITH_TIMEOUT(m_engine->lastConnection(), TIMEOUT_MS);
+    QLocalSocket* server = m_engine->lastConnection();
+    m_engine->hijack(server);
+
+    QByteArray frames = FakeEngine::frame(1, "hello ") + FakeEngine::frame(2, "world")
+                      + FakeEngine::frame(1, QByteArray(70000, 'x'));
+
+    // Part of the first header came with the response headers
+    EngineStream stream(socket, frames.left(5));
+    QByteArray output;
+    connect(&stream, &QIODevice::readyRead, this, [&]() {
+        output += stream.readAll();
+    });
+    QTest::qWait(50);
+    QCOMPARE(output, QByteArray());
+
+    auto deliver = [&](const QByteArray& piece) {
+        server->write(piece);
+        server->flush();
+        QTest::qWait(50);
+    };
+
+    // Rest of the header, no payload yet
+    deliver(frames.mid(5, 3));
+    QCOMPARE(output, QByteArray());
+
+    // Half a payload is held back
+    deliver(frames.mid(8, 4));
+    QCOMPARE(output, QByteArray());
+
+    // The first frame completes together with half of the second header
+    deliver(frames.mid(12, 6));
+    QCOMPARE(output, QByteArray("hello "));
+
+    // The second frame, then a payload larger than a single read
+    deliver(frames.mid(18, 15));
+    QCOMPARE(output, QByteArray("hello world"));
+    deliver(frames.mid(33));
+    QTRY_COMPARE_WITH_TIMEOUT(output.size(), qsizetype(11 + 70000), TIMEOUT_MS);
+    QVERIFY(output.endsWith('x'));
+}
+
+QTEST_GUILESS_MAIN(EngineClientTest)
+#include "EngineClientTest.moc"
@@ -0,0 +1,190 @@
+#include "FakeEngine.h"
+#include <QLocalSocket>
+#include <QTimer>
+
+namespace gwt {
+namespace tests {
+
+namespace {
+
+constexpr int PIECE_DELAY_MS = 20;
+
+QByteArray reasonPhrase(int status) {
+    switch (status) {
+    case 101: return "UPGRADED";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 404: return "Not Found";
+    default: return "Status";
+    }
+}
+
+} // namespace
+
+FakeEngine::FakeEngine(QObject* parent)
+    : QObject(parent)
+{
+    connect(&m_server, &QLocalServer::newConnection, this, [this]() {
+        while (QLocalSocket* socket = m_server.nextPendingConnection()) {
+            Connection connection;
+            connection.index = ++m_connectionCount;
+            m_connections.insert(socket, connection);
+            m_lastConnection = socket;
+
+            connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+                readRequests(socket);
+            });
+            connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+                m_connections.remove(socket);
+                socket->deleteLater();
+            });
+        }
+    });
+}
+
+FakeEngine::~FakeEngine() {
+    m_server.close();
+}
+
+bool FakeEngine::listen() {
+    return m_dir.isValid() && m_server.listen(m_dir.filePath("engine.sock"));
+}
+
+QString FakeEngine::socketPath() const {
+    return m_server.fullServerName();
+}
+
+void FakeEngine::setHandler(Handler handler) {
+    m_handler = std::move(handler);
+}
+
+void FakeEngine::hijack(QLocalSocket* socket) {
+    auto it = m_connections.find(socket);
+    if (it == m_connections.end()) {
+        return;
+    }
+    it->hijacked = true;
+    m_rawInput += it->buffer;
+    it->buffer.clear();
+}
+
+QList<FakeRequest> FakeEngine::requests() const {
+    return m_requests;
+}
+
+QList<QByteArray> FakeEngine::paths() const {
+    QList<QByteArray> paths;
+    for (const FakeRequest& request : m_requests) {
+        paths << request.path;
+    }
+    return paths;
+}
+
+int FakeEngine::connectionCount() const {
+    return m_connectionCount;
+}
+
+QLocalSocket* FakeEngine::lastConnection() const {
+    return m_lastConnection;
+}
+
+QByteArray FakeEngine::rawInput() const {
+    return m_rawInput;
+}
+
+QByteArray FakeEngine::response(int status, const QByteArray& body, const QByteArray& extraHeaders) {
+    return "HTTP/1.1 " + QByteArray::number(status) + ' ' + reasonPhrase(status) + "\r\n"
+         + "Content-Type: application/json\r\n" + extraHeaders
+         + "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n" + body;
+}
+
+QByteArray FakeEngine::chunked(const QList<QByteArray>& pieces) {
+    QByteArray body;
+    for (const QByteArray& piece : pieces) {
+        body += QByteArray::number(piece.size(), 16) + "\r\n" + piece + "\r\n";
+    }
+    return body + "0\r\n\r\n";
+}
+
+QByteArray FakeEngine::frame(char stream, const QByteArray& payload) {
+    QByteArray header(8, '\0');
+    header[0] = stream;
+    quint32 size = static_cast<quint32>(payload.size());
+    for (int i = 0; i < 4; ++i) {
+        header[7 - i] = static_cast<char>((size >> (8 * i)) & 0xff);
+    }
+    return header + payload;
+}
+
+void FakeEngine::writeInPieces(QLocalSocket* socket, const QList<QByteArray>& pieces,
+                               std::function<void()> onWritten) {
+    QPointer<QLocalSocket> target = socket;
+    if (!target) {
+        return;
+    }
+    if (pieces.isEmpty()) {
+        if (onWritten) {
+            onWritten();
+        }
+        return;
+    }
+
+    target->write(pieces.first());
+    target->flush();
+    QList<QByteArray> rest = pieces.mid(1);
+    QTimer::singleShot(PIECE_DELAY_MS, target, [target, rest, onWritten]() {
+        writeInPieces(target, rest, onWritten);
+    });
+}
+
+void FakeEngine::readRequests(QLocalSocket* socket) {
+    auto it = m_connections.find(socket);
+    if (it == m_connections.end()) {
+        return;
+    }
+    if (it->hijacked) {
+        m_rawInput += socket->readAll();
+        return;
+    }
+    it->buffer += socket->readAll();
+
+    // The handler may hijack the connection, so look it up on every pass
+    while (true) {
+        it = m_connections.find(socket);
+        if (it == m_connections.end() || it->hijacked) {
+            return;
+        }
+        QByteArray& buffer = it->buffer;
+        int end = buffer.indexOf("\r\n\r\n");
+        if (end == -1) {
+            return;
+        }
+
+        FakeRequest request;
+        request.connection = it->index;
+        QList<QByteArray> lines = buffer.left(end).split('\n');
+        QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+        request.method = requestLine.value(0);
+        request.path = requestLine.value(1);
+        for (int i = 1; i < lines.size(); ++i) {
+            int colon = lines[i].indexOf(':');
+            request.headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+        }
+
+        qsizetype length = request.headers.value("content-length").toLongLong();
+        if (buffer.size() < end + 4 + length) {
+            return;
+        }
+        request.body = buffer.mid(end + 4, length);
+        buffer.remove(0, end + 4 + length);
+
+        m_requests.append(request);
+        if (m_handler) {
+            m_handler(socket, request);
+        }
+    }
+}
+
+} // namespace tests
+} // namespace gwt
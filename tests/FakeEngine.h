@@ -0,0 +1,134 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QLocalServer>
+#include <QObject>
+#include <QPointer>
+#include <QTemporaryDir>
+#include <functional>
+
+class QLocalSocket;
+
+namespace gwt {
+namespace tests {
+
+/**
+ * @brief One HTTP request as the fake engine received it
+ */
+struct FakeRequest {
+    QByteArray method;
+    QByteArray path;
+    QHash<QByteArray, QByteArray> headers;  // Lower-case names
+    QByteArray body;
+    int connection = 0;                     // 1-based index of the accepting connection
+};
+
+/**
+ * @brief Scriptable stand-in for the Docker/Podman API socket
+ *
+ * Listens on a QLocalServer in a temporary directory, parses the requests
+ * EngineClient sends and hands each one to a test-supplied handler, which
+ * answers by writing raw HTTP to the socket. A hijacked connection stops
+ * being parsed and collects whatever the client writes as stdin.
+ */
+class FakeEngine : public QObject {
+    Q_OBJECT
+
+public:
+    using Handler = std::function<void(QLocalSocket* socket, const FakeRequest& request)>;
+
+    explicit FakeEngine(QObject* parent = nullptr);
+    ~FakeEngine() override;
+
+    /**
+     * @brief Start listening
+     * @return true on success
+     */
+    bool listen();
+
+    /**
+     * @brief Path to pass to EngineClient
+     */
+    QString socketPath() const;
+
+    /**
+     * @brief Set the handler that answers every request
+     */
+    void setHandler(Handler handler);
+
+    /**
+     * @brief Stop parsing a connection and collect its raw input instead
+     */
+    void hijack(QLocalSocket* socket);
+
+    /**
+     * @brief Requests received so far, in order
+     */
+    QList<FakeRequest> requests() const;
+
+    /**
+     * @brief Paths of the requests received so far, in order
+     */
+    QList<QByteArray> paths() const;
+
+    /**
+     * @brief Number of connections accepted so far
+     */
+    int connectionCount() const;
+
+    /**
+     * @brief Most recently accepted connection, if it is still open
+     */
+    QLocalSocket* lastConnection() const;
+
+    /**
+     * @brief Bytes written to hijacked connections
+     */
+    QByteArray rawInput() const;
+
+    /**
+     * @brief A complete response with a Content-Length
+     */
+    static QByteArray response(int status, const QByteArray& body, const QByteArray& extraHeaders = QByteArray());
+
+    /**
+     * @brief Body encoded as one chunk per piece, with the terminating chunk
+     */
+    static QByteArray chunked(const QList<QByteArray>& pieces);
+
+    /**
+     * @brief One multiplexed stream frame (1 = stdout, 2 = stderr)
+     */
+    static QByteArray frame(char stream, const QByteArray& payload);
+
+    /**
+     * @brief Write pieces with event loop turns in between, so the client
+     * sees them in separate reads
+     * @param onWritten Called after the last piece
+     */
+    static void writeInPieces(QLocalSocket* socket, const QList<QByteArray>& pieces,
+                              std::function<void()> onWritten = nullptr);
+
+private:
+    struct Connection {
+        int index = 0;
+        QByteArray buffer;
+        bool hijacked = false;
+    };
+
+    void readRequests(QLocalSocket* socket);
+
+    QTemporaryDir m_dir;
+    QLocalServer m_server;
+    Handler m_handler;
+    QHash<QLocalSocket*, Connection> m_connections;
+    QList<FakeRequest> m_requests;
+    QPointer<QLocalSocket> m_lastConnection;
+    QByteArray m_rawInput;
+    int m_connectionCount = 0;
+};
+
+} // namespace tests
+} // namespace gwt